@@ -1,3 +1,22 @@
 #pragma once
 
-#define PRINT_SEPARATOR "-------------------------------------------------------"
\ No newline at end of file
+#define PRINT_SEPARATOR "-------------------------------------------------------"
+
+#define BATCH_REGION_LIMIT 256 // 批量核心维护时K层连通区域的搜索上限，超过上限视为占用整层
+#define BATCH_WINDOW_PER_THREAD 16 // 批量核心维护每轮每个线程最多扫描的待处理边数
+#define SNAPSHOT_RETAIN_NUM 8 // 保留最近发布的IndexSnapshot数量，客户端可以按版本重新获取VO
+#define SNAPSHOT_CHUNK_BITS 10 // IndexSnapshot按2^SNAPSHOT_CHUNK_BITS个节点编号（或shell node句柄）分块，发布时只复制改变的块
+#define QUERY_CACHE_SIZE 64 // 按(shell node, k)缓存的查询结果数量
+#define VO_SINK_BUFFER_SIZE 65536 // ByteVOSink每攒够这么多字节写出一次
+#define VO_PACKED_PAYLOAD 1 // VO中的节点信息使用打包格式（PACKEDDATA），为0时使用文本格式（NODEDATA）
+#define UPDATE_PIPELINE_DEPTH 2 // 更新流水线相邻阶段之间最多积压的批数
+#define EDGE_BINARY_MAGIC "SIEBIN01" // 二进制边文件的文件头，EdgeReader据此区分文本和二进制格式
+#define UPDATE_BINARY_MAGIC "SIEUPD01" // 二进制更新日志的文件头
+#define CHECKPOINT_MAGIC "SIECKP02" // 索引检查点文件的文件头和文件尾
+#define CHECKPOINT_BUFFER_SIZE (1 << 20) // 写检查点时MbpTree节点攒够这么多字节写出一次
+#define UPDATE_LOG_MAGIC "SIEWAL01" // 更新批次预写日志的文件头
+#define HUB_DEGREE_THRESHOLD 1024 // 邻居数超过这个值的节点改用分块的邻居表
+#define NEIGHBOR_BLOCK_SIZE 256 // 分块邻居表中每块的初始大小，块超过两倍时分裂
+#define ADJACENCY_CHUNK_SIZE (1 << 18) // AdjacencyPool每次向系统申请的块大小，须为2的幂
+#define PACKED_MIN_DEGREE 32 // 开启邻接压缩时，邻居数不小于这个值的节点使用差分varint编码
+#define PACKED_BLOCK_SIZE 64 // 压缩邻居表每隔这么多个邻居在索引中记录一次块首
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "../configuration/types.h"
+#include "../configuration/config.h"
+
+// Graph的节点表和邻居表使用的内存池，每个Graph拥有一个，只在这个图的节点和邻居表之间复用。
+// 不超过MAX_SLOT_SIZE字节的分配按大小类从ADJACENCY_CHUNK_SIZE字节的块中切分，
+// 一块只切分一种大小类，释放的槽位挂到该大小类的空闲链表上；更大的分配直接使用operator new。
+// beginCompaction之后的分配只使用新块，旧块释放的槽位不再复用，endCompaction释放已经用空的旧块，其余旧块在最后一个槽位释放时归还
+class AdjacencyPool
+{
+    private:
+        struct Chunk
+        {
+            uint sizeClass;
+            uint liveNum; // 正在使用的槽位数
+            bool retired; // beginCompaction之前分配的块
+            char* next; // 尚未切分部分的起点
+        };
+        struct FreeSlot
+        {
+            FreeSlot* next;
+        };
+
+        static const uint SMALL_CLASS_NUM = 16; // 16到256字节，按16字节分级
+        static const uint CLASS_NUM = SMALL_CLASS_NUM + 4; // 512到4096字节，按2的幂分级
+        static const size_t MAX_SLOT_SIZE = 4096;
+        static const size_t SLOT_ALIGN = 16;
+
+        std::mutex mtx;
+        FreeSlot* freeSlots[CLASS_NUM];
+        Chunk* currentChunks[CLASS_NUM]; // 各大小类正在切分的块
+        std::vector<Chunk*> chunks; // 未退役的块
+        std::vector<Chunk*> retiredChunks;
+        bool compacting;
+        size_t reservedBytes;
+
+        static uint sizeClassOf(size_t bytes);
+        static size_t slotSizeOf(uint sizeClass);
+        static Chunk* chunkOf(void* p); // 块按ADJACENCY_CHUNK_SIZE对齐，块头就在块的起点
+        Chunk* newChunk(uint sizeClass);
+        void freeChunk(Chunk* chunk);
+
+    public:
+        AdjacencyPool();
+        ~AdjacencyPool(); // 归还所有块，从池中分配的对象须已经全部释放
+
+        AdjacencyPool(const AdjacencyPool&) = delete;
+        AdjacencyPool& operator=(const AdjacencyPool&) = delete;
+
+        void* allocate(size_t bytes);
+        void deallocate(void* p, size_t bytes); // bytes须与allocate时相同
+
+        void beginCompaction();
+        void endCompaction();
+
+        size_t getReservedBytes(); // 块和大分配占用的总字节数
+};
+
+// 从AdjacencyPool分配的STL分配器，pool为nullptr时直接使用operator new。
+// 容器交换和赋值时分配器随内容一起传递，复制出的容器与原容器使用同一个池
+template <typename T>
+class PoolAllocator
+{
+    private:
+        template <typename U> friend class PoolAllocator;
+
+        AdjacencyPool* pool;
+
+    public:
+        typedef T value_type;
+        typedef std::true_type propagate_on_container_copy_assignment;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        PoolAllocator() : pool(nullptr) {}
+        explicit PoolAllocator(AdjacencyPool* _pool) : pool(_pool) {}
+        template <typename U> PoolAllocator(const PoolAllocator<U>& other) : pool(other.pool) {}
+
+        AdjacencyPool* getPool() const { return pool; }
+
+        T* allocate(size_t n)
+        {
+            static_assert(alignof(T) <= 16, "PoolAllocator: alignment of T exceeds the pool slot alignment");
+            return static_cast<T*>(pool != nullptr ? pool->allocate(n * sizeof(T)) : ::operator new(n * sizeof(T)));
+        }
+        void deallocate(T* p, size_t n)
+        {
+            if(pool != nullptr)
+            {
+                pool->deallocate(p, n * sizeof(T));
+            }
+            else
+            {
+                ::operator delete(p);
+            }
+        }
+
+        template <typename U> bool operator==(const PoolAllocator<U>& other) const { return pool == other.pool; }
+        template <typename U> bool operator!=(const PoolAllocator<U>& other) const { return pool != other.pool; }
+};
@@ -15,22 +15,38 @@
 #include <algorithm>
 #include <map>
 #include <array>
+#include <memory>
 #include "../configuration/types.h"
 #include "../configuration/config.h"
 #include "vertex.h"
+#include "adjacencyPool.h"
 
 class Vertex;
 
+// 节点表的树节点也从所属图的AdjacencyPool分配
+typedef std::map<VertexID, Vertex, std::less<VertexID>, PoolAllocator<std::pair<const VertexID, Vertex>>> VertexMap;
+
 class Graph 
 {
     private:
         uint vertex_num;
         uint edge_num; // 因为是无向图，所以一条边只算一次，边（0，1）和边（1，0）不会重复计算，只添加一次
-        std::map<VertexID, Vertex> nodes;
+        std::unique_ptr<AdjacencyPool> pool; // 节点表和邻居表的内存池，只属于这个图，须在nodes之后析构
+        VertexMap nodes;
         std::map<uint, std::list<VertexID>> invertedIndex;
+        bool compressedAdjacency; // 新增和恢复的节点是否压缩邻居表
+        uint vertexOrder; // convertToLocalID的编号顺序，见VertexOrder
+
+        Vertex& findOrAddVertex(const VertexID& vid, bool& added); // 只查找一次，不存在时添加没有邻居的节点
+        void rcmOrder(const std::vector<VertexID>& vids, std::vector<VertexID>& local2global) const;
 
     public:
+        // 稠密局部编号的分配顺序。只影响核心分解和shell tree构建内部的数组布局，摘要、VO和对外的节点编号始终是原始编号
+        // 查询路径不使用局部编号：IndexSnapshot按原始编号分块，以便相邻版本共享没有改变的块，候选生成因此也按原始编号访问
+        enum VertexOrder {ID_ORDER, DEGREE_ORDER, RCM_ORDER};
+
         Graph();
+        Graph(Graph&& other) = default; // 内存池随节点表一起转移
         ~Graph();
 
         VertexID getMinDegreeVertexID();
@@ -40,13 +56,16 @@ class Graph
         uint getEdgeNum() const;
         uint getVertexDegree(const VertexID& vid) const;
         
-        Vertex getVertex(const VertexID& vid) const;
-        const std::vector<VertexID>& getVertexNeighbors(const VertexID& vid) const;
-        std::array<unsigned char, SHA256_DIGEST_LENGTH> getVertexDigest(const VertexID& vid) const;
+        // 以下返回的引用和指针在节点被删除前有效，不复制邻居表和摘要
+        const Vertex& getVertex(const VertexID& vid) const;
+        const Vertex* findVertex(const VertexID& vid) const; // 节点不存在时返回nullptr
+        const NeighborList& getVertexNeighbors(const VertexID& vid) const;
+        const unsigned char* getVertexDigest(const VertexID& vid) const;
 
-        const std::map<uint, Vertex>& getNodes() const;
+        const VertexMap& getNodes() const;
 
         bool hasVertex(const VertexID& vid) const;
+        bool hasEdge(const VertexID& src, const VertexID& dst) const;
 
         void loadGraphfromFile(const std::string& filename);
         void writeGraphtoFile(const std::string& filename);
@@ -55,6 +74,15 @@ class Graph
         void removeVertex(const VertexID& vid, bool updateIndex, bool computeVDigest);
         void addEdge(const VertexID& src, const VertexID& dst, bool updateIndex, bool computeVDigest);
         void removeEdge(const VertexID& src, const VertexID& dst, bool updateIndex, bool computeVDigest);
+        // 从检查点恢复时按编号升序追加节点，邻居和摘要直接使用；全部追加之后需要buildInvertedIndex
+        void restoreVertex(const VertexID& vid, const VertexID* first, const VertexID* last, const unsigned char* digest);
+        // 把节点表和邻居表按编号顺序复制到新的内存块中并归还碎片化的旧块，之前取得的节点和邻居表的引用全部失效
+        void compactAdjacency();
+        // 开启后度数足够大的邻居表以差分varint压缩存放，遍历时顺序解码，应在加载或恢复之前设置；已有节点也随之转换
+        void setCompressedAdjacency(bool enable);
+        bool isCompressedAdjacency() const;
+        size_t getAdjacencyBytes() const; // 全部邻居表占用的字节数
+        size_t getReservedBytes() const; // 内存池向系统申请的字节数
 
         void buildInvertedIndex();
         void updateInvertedIndexADV(const VertexID& vid); // 删除节点后更新倒排索引
@@ -62,7 +90,11 @@ class Graph
         void updateInvertedIndexAUE(const VertexID& src, const VertexID& dst); // 更新边（包括删除和增加）后更新倒排索引
 
         void computeVertexDigest();
+        void computeVertexDigest(const VertexID& vid); // 只重新计算一个节点的摘要，不同节点可以并行计算
 
+        void setVertexOrder(VertexOrder order);
+        // 返回local2global：ID_ORDER按编号升序；DEGREE_ORDER按度数降序，高度数节点集中在数组前部；
+        // RCM_ORDER为逆Cuthill-McKee顺序，BFS相邻的节点编号相邻，遍历和剥离时访问的数组位置更集中
         std::vector<VertexID> convertToLocalID() const;
 
         void printGraphInfo(int verboseNodeNum = -1) const;
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <vector>
+#include <iterator>
+#include <cstddef>
+
+#include "adjacencyPool.h"
+#include "../configuration/types.h"
+#include "../configuration/config.h"
+
+// 节点的邻居表，始终按编号升序。度数不超过HUB_DEGREE_THRESHOLD时是一个有序数组；超过后切换为分块的有序数组，
+// 每块不超过2*NEIGHBOR_BLOCK_SIZE个邻居，插入和删除先二分找块再在块内二分，只移动一块内的元素，
+// 度数降到阈值的一半以下时再合并回一个数组。
+// setPackable(true)之后，度数不小于PACKED_MIN_DEGREE的邻居表改为差分varint压缩（不再分块），每PACKED_BLOCK_SIZE个邻居
+// 在索引中记一项（块首编号和字节偏移），查找先二分索引再顺序解码一块；插入和删除重新编码一块，并移动其后的字节。
+// 各种形式的遍历顺序相同，摘要不受影响
+class NeighborList
+{
+    public:
+        typedef std::vector<VertexID, PoolAllocator<VertexID>> Block; // 邻居从AdjacencyPool分配
+
+    private:
+        typedef std::vector<unsigned char, PoolAllocator<unsigned char>> Bytes;
+        struct PackedBlock
+        {
+            VertexID first; // 块中最小的邻居
+            uint offset; // 块中第一个差分在bytes中的位置
+            uint count;
+        };
+        // 压缩的邻居表：每个邻居编码为与前一个邻居（第一个与0）之差的varint，块与块首尾相接
+        struct Packed
+        {
+            Bytes bytes;
+            std::vector<PackedBlock, PoolAllocator<PackedBlock>> index;
+
+            Packed(const PoolAllocator<unsigned char>& alloc) : bytes(alloc), index(alloc) {}
+        };
+
+        Block flat; // 未分块且未压缩时的全部邻居，否则为空
+        std::vector<Block, PoolAllocator<Block>> blocks; // 分块时每块非空，块内和块间都按编号升序；未分块时为空
+        Packed* packed; // 压缩时的邻居，否则为nullptr
+        uint count;
+        bool packable; // 度数足够大时是否压缩
+
+        size_t findBlock(VertexID vid) const; // 第一个末尾元素不小于vid的块，不存在时为最后一块
+        void splitBlock(size_t index);
+        void mergeBlock(size_t index); // 把过小的块与相邻的块合并
+        void toBlocks();
+        void toFlat();
+
+        static void encodeDelta(VertexID delta, Bytes& out);
+        void pack();
+        void unpack();
+        size_t findPackedBlock(VertexID vid) const; // 最后一个块首不大于vid的块，都大于时为第一块
+        void decodePackedBlock(size_t index, std::vector<VertexID>& out) const;
+        VertexID packedBlockBack(size_t index) const;
+        // 用[first, last)重新编码索引中[begin, end)的块，过长时按PACKED_BLOCK_SIZE切成多块，并修正其后的块
+        void repack(size_t begin, size_t end, const VertexID* first, const VertexID* last);
+
+    public:
+        // 读取一个差分varint（与appendVarint的格式相同），读取后cur指向下一个差分。不检查越界，只用于自己编码的字节
+        static VertexID decodeDelta(const unsigned char*& cur)
+        {
+            VertexID value = *cur & 0x7f;
+            for(uint shift = 7; *cur++ & 0x80; shift += 7)
+            {
+                value |= (VertexID)(*cur & 0x7f) << shift;
+            }
+            return value;
+        }
+
+        // 跨块的只读前向迭代器，压缩时边遍历边解码，解引用得到的是值
+        class const_iterator
+        {
+            private:
+                const VertexID* cur;
+                const VertexID* blockEnd;
+                const Block* block; // 当前所在的块，未分块时为flat
+                const Block* lastBlock;
+                const unsigned char* code; // 压缩时当前邻居的差分位置，未压缩时为nullptr
+                const unsigned char* next; // 下一个差分的位置
+                const unsigned char* codeEnd;
+                VertexID value; // 压缩时当前邻居的编号
+
+            public:
+                typedef std::forward_iterator_tag iterator_category;
+                typedef VertexID value_type;
+                typedef std::ptrdiff_t difference_type;
+                typedef const VertexID* pointer;
+                typedef VertexID reference;
+
+                const_iterator() : cur(nullptr), blockEnd(nullptr), block(nullptr), lastBlock(nullptr), code(nullptr), next(nullptr), codeEnd(nullptr), value(0) {}
+                const_iterator(const VertexID* _cur, const Block* _block, const Block* _lastBlock)
+                    : cur(_cur), blockEnd(_block->data() + _block->size()), block(_block), lastBlock(_lastBlock), code(nullptr), next(nullptr), codeEnd(nullptr), value(0) {}
+                const_iterator(const unsigned char* _code, const unsigned char* _codeEnd)
+                    : cur(nullptr), blockEnd(nullptr), block(nullptr), lastBlock(nullptr), code(_code), next(_code), codeEnd(_codeEnd), value(0)
+                {
+                    if(code != codeEnd)
+                    {
+                        value = decodeDelta(next);
+                    }
+                }
+
+                reference operator*() const { return code == nullptr ? *cur : value; }
+                const_iterator& operator++()
+                {
+                    if(code != nullptr)
+                    {
+                        code = next;
+                        if(code != codeEnd)
+                        {
+                            value += decodeDelta(next);
+                        }
+                    }
+                    else if(++cur == blockEnd && block != lastBlock)
+                    {
+                        ++block;
+                        cur = block->data();
+                        blockEnd = cur + block->size();
+                    }
+                    return *this;
+                }
+                const_iterator operator++(int)
+                {
+                    const_iterator old = *this;
+                    ++(*this);
+                    return old;
+                }
+                bool operator==(const const_iterator& other) const { return cur == other.cur && code == other.code; }
+                bool operator!=(const const_iterator& other) const { return !(*this == other); }
+        };
+
+        NeighborList(AdjacencyPool* pool = nullptr); // 邻居从pool分配，为nullptr时直接使用operator new
+        NeighborList(const VertexID* first, const VertexID* last, AdjacencyPool* pool = nullptr); // [first, last)须按编号升序且不重复
+        NeighborList(const NeighborList& other);
+        NeighborList(NeighborList&& other);
+        NeighborList& operator=(NeighborList other);
+        ~NeighborList();
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        bool isBlocked() const { return !blocks.empty(); }
+        bool isPacked() const { return packed != nullptr; }
+        VertexID back() const;
+        size_t getMemoryBytes() const; // 邻居占用的字节数，不含NeighborList本身
+
+        const_iterator begin() const
+        {
+            if(packed != nullptr)
+            {
+                return const_iterator(packed->bytes.data(), packed->bytes.data() + packed->bytes.size());
+            }
+            return blocks.empty() ? const_iterator(flat.data(), &flat, &flat) : const_iterator(blocks.front().data(), &blocks.front(), &blocks.back());
+        }
+        const_iterator end() const
+        {
+            if(packed != nullptr)
+            {
+                return const_iterator(packed->bytes.data() + packed->bytes.size(), packed->bytes.data() + packed->bytes.size());
+            }
+            return blocks.empty() ? const_iterator(flat.data() + flat.size(), &flat, &flat) : const_iterator(blocks.back().data() + blocks.back().size(), &blocks.back(), &blocks.back());
+        }
+
+        void setPackable(bool enable); // 开启时立即压缩足够大的邻居表，关闭时解压
+
+        bool contains(VertexID vid) const;
+        bool insert(VertexID vid); // 已存在时返回false
+        bool erase(VertexID vid); // 不存在时返回false
+};
@@ -11,31 +11,34 @@
 #include "../configuration/types.h"
 #include "../configuration/config.h"
 #include "../util/common.h"
+#include "neighborList.h"
 
 class Vertex
 {
     private:
         VertexID id;
         uint degree;
-        std::vector<VertexID> neighbors;
+        NeighborList neighbors;
         unsigned char digest[SHA256_DIGEST_LENGTH];
 
     public:
         Vertex();
-        Vertex(VertexID vid);
+        Vertex(VertexID vid, AdjacencyPool* pool = nullptr); // 邻居表从pool分配，为nullptr时直接使用operator new
+        Vertex(VertexID vid, const VertexID* first, const VertexID* last, const unsigned char* _digest, AdjacencyPool* pool = nullptr); // 邻居[first, last)须按编号升序，摘要直接使用不重新计算
         Vertex(const Vertex& other);
         ~Vertex();
 
         VertexID getVid() const;
         uint getDegree() const;
         VertexID getMaxDegreeNeighbor() const;
-        std::array<unsigned char, SHA256_DIGEST_LENGTH> getDigest() const;
-        const std::vector<VertexID>& getNeighbors() const;
+        const unsigned char* getDigest() const; // 指向节点内部的SHA256_DIGEST_LENGTH字节，不复制
+        const NeighborList& getNeighbors() const;
 
         bool hasNeighbor(VertexID neighbor_vid) const;
 
         void addNeighbor(VertexID neighbor_vid);
         void removeNeighbor(VertexID neighbor_vid);
+        void setPackedNeighbors(bool enable); // 见NeighborList::setPackable
 
         void digestCompute();
         void printInfo() const;
@@ -4,7 +4,9 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <queue>
+#include <deque>
 #include <algorithm>
 #include <chrono>
 
@@ -13,10 +15,13 @@
 #include "../graph/vertex.h"
 #include "../graph/graph.h"
 #include "../ostree/ostree.h"
+#include "shelltree.h"
+#include "../util/threadPool.h"
 
 class Vertex;
 class Graph;
 class OSTree;
+class ShellTree;
 
 struct MinHeapCmp
 {
@@ -26,6 +31,18 @@ struct MinHeapCmp
     }
 };
 
+struct MaintainTask // 一条边的核心维护任务，search阶段只读cores可以并行执行，commit阶段串行执行
+{
+    VertexID src;
+    VertexID dst;
+    uint K;
+    std::vector<VertexID> VStar;
+    std::unordered_map<VertexID, uint> inVStar; // 仅删除时使用，保存VStar节点在K-order中的位置
+    std::vector<std::pair<VertexID, VertexID>> moved; // 仅插入时使用，被移出候选集的节点及其在K-order中的新前驱，按移动顺序保存
+
+    MaintainTask(VertexID _src, VertexID _dst) : src(_src), dst(_dst), K(0) {}
+};
+
 class CoreMaintainer
 {
     private:
@@ -35,33 +52,64 @@ class CoreMaintainer
         std::unordered_map<uint, OSTree> ostrees;
         // std::unordered_map<uint, std::list<VertexID>> orderkV;
 
-        uint version = 0;
+        uint version = 0; // cores每次改变后递增，发布的IndexSnapshot记录其对应的版本
+        std::unordered_set<VertexID> changedVertices; // 上次takeChangedVertices之后core或邻居改变的节点，包括被删除的节点
+        std::vector<VertexID> detachedVertices; // 上次takeDetachedVertices之后被detachIsolatedVertex从图中移除的节点
+
+        ShellTree* shellTree = nullptr; // 不为空时，每次维护后同步修复shell tree
+
+        uint findRegion(const Graph& graph, const VertexID& vid, uint K, std::unordered_map<VertexID, uint>& regionLabel, uint& regionNum) const; // 查找vid所在的K层连通区域
+        void batchMaintain(Graph& graph, const std::vector<std::pair<VertexID, VertexID>>& edges, ThreadPool& pool, bool isInsert);
     public:
         CoreMaintainer();
         CoreMaintainer(const Graph& graph);
 
         uint getCore(const VertexID& vid) const;
+        uint getVersion() const;
         OSTree& getOSTree(uint k);
         bool hasOSTree(uint k) const;
         const std::unordered_map<VertexID, uint>& getCoresSet() const;
+        void attachShellTree(ShellTree* tree); // tree必须由当前的cores构建，传入nullptr取消关联
+        // 取出并清空changedVertices，追加到changed；coresDecomp和restoreState整体替换cores后清空，调用者需要整体重建
+        void takeChangedVertices(std::vector<VertexID>& changed);
+        // 取出并清空detachedVertices，追加到detached；发布时只需从MbpTree删除这些节点
+        void takeDetachedVertices(std::vector<VertexID>& detached);
 
-        void insertToOrderk(const std::vector<VertexID>& vert, const std::vector<VertexID> local2global, uint startPos, uint endPos, uint k);
-        void initmcd(const Graph& graph, const std::vector<VertexID> local2global);
+        // 检查点使用：mcdValues和degPlusValues与vids一一对应，没有记录的为UINT_MAX；korders为各层的k-order，按k升序
+        void exportState(const std::vector<VertexID>& vids, std::vector<uint>& mcdValues, std::vector<uint>& degPlusValues, std::vector<std::pair<uint, std::vector<VertexID>>>& korders) const;
+        // 用exportState的格式整体替换当前状态，coreValues同样与vids一一对应
+        void restoreState(const std::vector<VertexID>& vids, const std::vector<uint>& coreValues, const std::vector<uint>& mcdValues, const std::vector<uint>& degPlusValues, const std::vector<std::pair<uint, std::vector<VertexID>>>& korders, uint _version);
+
+        void insertToOrderk(const std::vector<VertexID>& vert, const std::vector<VertexID>& local2global, uint startPos, uint endPos, uint k);
+        // offsets和adjacency为局部编号的邻接表（CSR），localCores为按局部编号的core
+        void initmcd(const std::vector<VertexID>& local2global, const std::vector<size_t>& offsets, const std::vector<uint>& adjacency, const std::vector<uint>& localCores);
+        // 邻接压缩时不展开CSR，直接遍历localVertices中各节点的邻居表
+        void initmcd(const std::vector<VertexID>& local2global, const std::vector<const Vertex*>& localVertices, const std::unordered_map<VertexID, VertexID>& global2local, const std::vector<uint>& localCores);
         void initmcdTest(const Graph& graph);
         void coresDecomp(const Graph& graph);
 
         bool comparekorder(const uint& a, const uint& b, const uint& k);
 
         void orderInsert(const Graph& graph, const VertexID src, const VertexID dst);
+        void orderInsertSearch(const Graph& graph, MaintainTask& task);
+        void orderInsertCommit(const Graph& graph, MaintainTask& task);
         void addVertex(const VertexID& vid);
-        void removeCandidates(const Graph& graph, std::unordered_map<VertexID, uint>& degStar, std::unordered_map<VertexID, uint>& inVc, std::unordered_set<VertexID>& inHeap, VertexID w, uint K);
+        void removeCandidates(const Graph& graph, std::unordered_map<VertexID, uint>& degStar, std::unordered_map<VertexID, uint>& inVc, std::unordered_set<VertexID>& inHeap, VertexID w, uint K, 
+                              std::vector<std::pair<VertexID, VertexID>>& moved);
         void updatemcdInsert(const Graph& graph, const std::vector<VertexID>& VStar, uint K); // 插入和删除更新操作不同
         
-        void orderRemove(const Graph& graph, const VertexID src, const VertexID dst);
+        void orderRemove(const Graph& graph, const VertexID src, const VertexID dst); // 不修复shell tree的分裂，连续的删除之后调用一次finishRemove
+        void finishRemove(const Graph& graph); // 修复之前的删除在shell tree中留下的分裂，插入和发布索引前调用
+        void orderRemoveSearch(const Graph& graph, MaintainTask& task);
+        void orderRemoveCommit(const Graph& graph, MaintainTask& task);
         void removeVertex(const VertexID& vid);
+        void detachIsolatedVertex(const VertexID& vid); // 最后一条边被删除、core降为0的节点，从所有索引中移除
         void traverseVStarFind(const Graph& graph, std::vector<VertexID>& VStar, std::unordered_map<VertexID, uint>& inVStar, const VertexID& src, const VertexID& dst, uint K);
         void updatemcdRemove(const Graph& graph, const std::vector<VertexID>& VStar, const std::unordered_map<VertexID, uint>& inVStar, uint K);
 
+        void batchInsert(Graph& graph, const std::vector<std::pair<VertexID, VertexID>>& edges, ThreadPool& pool); // 边会在维护过程中加入graph，并重新计算相关节点的摘要
+        void batchRemove(Graph& graph, const std::vector<std::pair<VertexID, VertexID>>& edges, ThreadPool& pool); // 边会在维护过程中从graph删除，并重新计算相关节点的摘要
+
         // void printOrderk(uint k) const;
         void testOSTree();
         void printOSTree(uint k) const;
@@ -7,6 +7,9 @@
 #include <unordered_set>
 #include <algorithm>
 #include <chrono>
+#include <tuple>
+#include <memory>
+#include <climits>
 
 #include "../configuration/types.h"
 #include "../configuration/config.h"
@@ -20,27 +23,97 @@ struct ShellNode
 {
     uint id;
     uint coreLevel;
+    uint handle; // 在ShellTree中的句柄，节点释放后会被复用
     std::vector<VertexID> vertices;
     ShellNode* parent;
     std::unordered_set<ShellNode*> children;
-    ShellNode(uint _id, uint _coreLevel, ShellNode* _parent = nullptr) : id(_id), coreLevel(_coreLevel), parent(_parent) {}
+    uint start; // 子树在ShellTree::flatVertices中的范围[start, end)，flatten之后有效
+    uint end;
+    ShellNode(uint _id, uint _coreLevel, ShellNode* _parent = nullptr) : id(_id), coreLevel(_coreLevel), handle(UINT_MAX), parent(_parent), start(0), end(0) {}
+};
+
+struct FrozenShellNode // 发布时ShellNode的只读拷贝，父子关系用句柄表示，没有改变的节点在相邻版本的快照之间共享
+{
+    static const uint NONE = UINT_MAX;
+    uint coreLevel;
+    uint id; // 与ShellNode::id相同，(coreLevel, id)在shell tree重建之前唯一且不会复用
+    uint parent;
+    std::vector<uint> children;
+    std::vector<VertexID> vertices; // 只含节点自己的节点，不含子树
+};
+
+struct FlatShellNode // 检查点中的ShellNode，自己的节点为另存的节点数组中的[start, end)
+{
+    uint handle;
+    uint coreLevel;
+    uint id;
+    uint parent; // 父节点的句柄，没有时为FrozenShellNode::NONE
+    uint start;
+    uint end;
 };
 
 class ShellTree
 {
     private:
         std::unordered_map<uint, std::vector<ShellNode*>> shellNodes;
-        std::unordered_map<VertexID, uint> vertexToCC;
+        std::unordered_map<VertexID, ShellNode*> vertexToNode; // 节点所在的ShellNode（层级为节点的core）
+        std::unordered_map<VertexID, uint> vertexPos; // 节点在所属ShellNode的vertices中的位置
+
+        std::vector<std::tuple<VertexID, VertexID, uint>> removedEdges; // 等待finishRemove修复连通性的删除边(src, dst, K)
+        std::unordered_map<uint, std::vector<VertexID>> removedSeeds; // 层 -> 该层需要检查连通性的种子
+        std::unordered_set<ShellNode*> hollowNodes; // 维护过程中节点被移空的ShellNode，维护结束时由compactNodes清理
+
+        std::vector<VertexID> flatVertices; // 按ShellNode的DFS先序排列的节点，每个ShellNode的子树是其中连续的一段
+        bool flatDirty = true; // 树结构改变后需要重新flatten
+
+        std::vector<ShellNode*> handleNodes; // 句柄 -> ShellNode，已经释放的句柄为空
+        std::vector<uint> freeHandles;
+        std::unordered_set<uint> dirtyHandles; // 上次takeChanges之后节点、父节点或孩子改变的ShellNode，包括已经释放的
+        std::unordered_set<VertexID> movedVertices; // 上次takeChanges之后所在ShellNode改变的节点
+
+        static uint findRoot(std::vector<uint>& dsuParent, uint x); // 带路径压缩的并查集查找
+        ShellNode* createNode(uint coreLevel, ShellNode* parent);
+        void releaseNode(ShellNode* node); // 删除没有节点也没有孩子的ShellNode，并向上检查父节点
+        void compactNodes();
+        void flatten(); // 非递归DFS先序遍历，重新排列flatVertices并记录每个ShellNode的范围
+        uint allocHandle(ShellNode* node);
+        void setParent(ShellNode* node, ShellNode* parent);
+        void addToNode(ShellNode* node, const VertexID& vid);
+        void removeFromNode(const VertexID& vid);
+        ShellNode* getNode(const VertexID& vid) const;
+        ShellNode* levelComponent(ShellNode* node, uint level) const; // node所在的level-core连通分量的顶层节点
+        ShellNode* mergeNodes(ShellNode* a, ShellNode* b); // 合并两个同层的ShellNode，返回保留的节点
+        void mergePaths(ShellNode* a, ShellNode* b); // 按层合并a和b到根的路径
+        void mergeAlongEdge(const std::unordered_map<VertexID, uint>& cores, const VertexID& u, const VertexID& v);
+        std::vector<std::vector<VertexID>> findSplitPieces(const Graph& graph, const std::unordered_map<VertexID, uint>& cores, const std::vector<VertexID>& seeds, uint level);
+        void extractPiece(const std::unordered_map<VertexID, uint>& cores, const std::vector<VertexID>& piece, uint level);
+        void splitLevel(const Graph& graph, const std::unordered_map<VertexID, uint>& cores, const std::vector<VertexID>& seeds, uint level);
 
     public:
         ShellTree();
         ~ShellTree();
 
-        void dfs(const Graph& graph, const VertexID& u, ShellNode* component, const uint& componentID, const std::unordered_map<VertexID, uint>& cores, std::unordered_set<VertexID>& visited);
-        void initBottomNodes(const Graph& graph, const std::unordered_map<VertexID, uint>& cores, const std::vector<VertexID>& bottomSets, const uint& bottomLevel);
-        void buildTree(const Graph& graph, const std::unordered_map<VertexID, uint>& cores);
+        void buildTree(const Graph& graph, const std::unordered_map<VertexID, uint>& cores); // 并查集自顶向下逐层合并，O(m·α(n))
+
+        // 边(src, dst)插入后，VStar中的节点core由K变为K+1，cores为更新后的值
+        void insertUpdate(const Graph& graph, const std::unordered_map<VertexID, uint>& cores, const VertexID& src, const VertexID& dst, const std::vector<VertexID>& VStar, uint K);
+        // 边(src, dst)删除后，VStar中的节点core由K变为K-1，cores为更新后的值；只调整节点所在的层，分裂在finishRemove中统一处理
+        void removeUpdate(const Graph& graph, const std::unordered_map<VertexID, uint>& cores, const VertexID& src, const VertexID& dst, const std::vector<VertexID>& VStar, uint K);
+        void finishRemove(const Graph& graph, const std::unordered_map<VertexID, uint>& cores); // 图中已删除的边全部调用removeUpdate之后调用
+        void removeIsolatedVertex(const VertexID& vid); // 在finishRemove之后移除已经没有邻居的节点
+        bool isReady() const; // 没有等待finishRemove修复的删除时，树与当前的cores一致，可以直接回答查询
+        void prepareQuery(); // 树结构改变后重新flatten，之后kcoreRange只读，可以被多个查询线程同时调用
+
+        // 包含queryV的连通k-core在flatVertices中的范围[first, second)，queryV的core小于k时为空范围；调用前需要prepareQuery
+        std::pair<const VertexID*, const VertexID*> kcoreRange(const VertexID& queryV, const uint& k) const;
 
-        void traverseShellNode(ShellNode* node, std::unordered_set<VertexID>& vertices);
+        // 取出并清空上次调用之后改变的ShellNode句柄和所在ShellNode改变的节点，分别追加到nodes和vertices
+        void takeChanges(std::vector<uint>& nodes, std::vector<VertexID>& vertices);
+        uint getHandleNum() const; // 句柄都小于这个值
+        uint getHandle(const VertexID& vid) const; // vid所在ShellNode的句柄，不在树中时为FrozenShellNode::NONE
+        std::shared_ptr<const FrozenShellNode> freezeNode(uint handle) const; // 句柄已经释放时返回空指针
+        // 从检查点恢复到空树：句柄、节点id和每个节点中节点的顺序都与保存时相同
+        void importFlat(const std::vector<VertexID>& vertices, const std::vector<FlatShellNode>& nodes);
         // Graph query(const Graph& graph, const VertexID& queryV, const uint& queryVCore, const uint& k);
         std::chrono::milliseconds query(const Graph& graph, const VertexID& queryV, const uint& queryVCore, const uint& k);
 };
\ No newline at end of file
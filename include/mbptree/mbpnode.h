@@ -6,9 +6,38 @@
 #include <algorithm>
 #include <tuple>
 #include <array>
+#include <map>
+#include <string>
+#include <memory>
+#include <functional>
 #include "../configuration/types.h"
 #include "../configuration/config.h"
 #include "../util/common.h"
+#include "../util/voSink.h"
+
+struct VOTarget // 共享遍历中的一个结果子图
+{
+    const VertexID* first; // 还没有输出的子图节点，按编号升序
+    const VertexID* last;
+    std::function<const std::string&(const VertexID&)> payloadOf; // 遍历到子图节点时取得其节点信息，返回值在下一次调用前有效
+    VOEntry::DataType payloadType; // 节点信息的格式，NODEDATA或PACKEDDATA
+    VOSink* sink;
+};
+
+// MbpNode发布时的只读拷贝。发布后不再修改，两次发布之间没有改变的子树在各个版本之间共享，
+// 不再被任何版本引用的节点由shared_ptr回收
+struct FrozenMbpNode
+{
+    bool isLeaf;
+    std::vector<uint> keys;
+    std::vector<std::array<unsigned char, SHA256_DIGEST_LENGTH>> vertexDigests;
+    std::vector<std::shared_ptr<const FrozenMbpNode>> children;
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+
+    void constructVO(std::vector<VOEntry>& vo, std::vector<VertexID>& subgraphVids, const std::map<VertexID, std::string>& serializedVertexInfo, VOEntry::DataType payloadType = VOEntry::NODEDATA) const;
+    // 一次遍历为多个子图构造VO，不包含任何目标节点的子树对所有子图只输出已经保存的摘要
+    void constructSharedVO(const std::vector<VOTarget*>& targets) const;
+};
 
 class MbpNode
 {
@@ -22,6 +51,8 @@ class MbpNode
         bool isDigestComputed; // 是否已经计算了摘要,或者需要重新计算
         bool isLeaf;
 
+        std::shared_ptr<const FrozenMbpNode> frozen; // 上次发布时的拷贝，节点被修改时清空
+
     public:
         std::vector<uint> keys;
         // std::vector<uint> values;
@@ -30,8 +61,11 @@ class MbpNode
 
 
         MbpNode(MbpNode* _parent = nullptr, MbpNode* _prev = nullptr, MbpNode* _next = nullptr, bool _isLeaf = false);
+        // 由发布的拷贝还原，摘要直接使用，再次freeze时返回_frozen本身；孩子由调用者还原后加入children
+        MbpNode(std::shared_ptr<const FrozenMbpNode> _frozen, MbpNode* _parent, MbpNode* _prev);
         ~MbpNode();
 
+
         uint indexofChild(const uint& key) const; // 根据关键字查找其对应的子节点的索引
         uint indexofKey(const uint& key) const; // 根据关键字查找其在节点中的索引
         bool hasKey(const uint& key) const; // 是否存在关键字
@@ -56,15 +90,15 @@ class MbpNode
         std::array<unsigned char, SHA256_DIGEST_LENGTH> getVertexDigest(const VertexID& vid) const; // 根据关键字获取对应顶点的摘要（仅叶子节点）
 
         // void set(const uint& key, const uint& value); // 设置关键字及其对应的值（仅叶子节点）
-        void setVertexDigest(const VertexID& vid, const std::array<unsigned char, SHA256_DIGEST_LENGTH>& _digest); // 设置关键字对应的顶点的摘要（仅叶子节点）
+        void setVertexDigest(const VertexID& vid, const unsigned char* _digest); // 设置关键字对应的顶点的摘要（仅叶子节点）
 
-        void getDigest(unsigned char* _digest); // 获取节点摘要
+        void getDigest(unsigned char* _digest) const; // 获取缓存的节点摘要，只读，可以被多个查询线程同时调用
 
-        void setFalseDigestComputed();
+        void setFalseDigestComputed(); // 标记该节点及其祖先的摘要需要重新计算，同时作废它们上次发布的拷贝
 
-        void digestCompute();
+        void digestCompute(); // 只重新计算被标记的子树
 
-        void constructVO(std::vector<VOEntry>& vo, std::vector<VertexID>& subgraphVids, const std::map<VertexID, std::string>& serializedVertexInfo);
+        std::shared_ptr<const FrozenMbpNode> freeze(); // 只拷贝上次发布之后改变过的节点，调用前摘要需要已经计算
 
         void printNodeInfo();
 };
\ No newline at end of file
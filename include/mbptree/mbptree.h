@@ -22,18 +22,22 @@ class MbpTree
         uint depth;
 
         void deleteTree(MbpNode* node); // 用于析构函数，递归删除子树的辅助函数
+        MbpNode* thawTree(std::shared_ptr<const FrozenMbpNode> frozen, MbpNode* parent, MbpNode*& lastLeaf, uint level); // 按先序还原子树并串起叶子链表
 
     public:
         MbpTree(uint _maxCapaciy = 4);
         ~MbpTree();
 
         MbpNode* getRoot() const; // 获取根节点
+        uint getMaxCapacity() const;
+
+        void restore(std::shared_ptr<const FrozenMbpNode> frozenRoot); // 丢弃当前的树，还原为与frozenRoot形状和摘要完全相同的树，不重新计算摘要
 
         MbpNode* findLeaf(uint key) const; // 查找包含key的叶子节点
 
         std::array<unsigned char, SHA256_DIGEST_LENGTH> getVertexDigest(const VertexID& vid) const; // 根据关键字获取对应顶点的摘要
         // uint get(uint key) const; // 获取key对应的值
-        void setVertexDigest(const VertexID& vid, const std::array<unsigned char, SHA256_DIGEST_LENGTH>& _digest); // 设置关键字对应的顶点的摘要
+        void setVertexDigest(const VertexID& vid, const unsigned char* _digest); // 设置关键字对应的顶点的摘要
         // void set(uint key, uint value); // 设置key对应的值
 
         void insert(std::tuple<uint, MbpNode*, MbpNode*> result); 
@@ -53,7 +57,9 @@ class MbpTree
 
         void remove(uint key, MbpNode* node = nullptr);
 
-        void constructVO(std::vector<VOEntry>& vo, std::vector<VertexID> subgraphVids, const std::map<VertexID, std::string>& serializedVertexInfo);
+        void digestCompute(); // 重新计算更新过程中被标记的节点摘要
+
+        std::shared_ptr<const FrozenMbpNode> freeze(); // 发布当前版本，与上一个版本共享没有改变的子树
 
         void printMbpTreeInfo(MbpNode* node = nullptr, std::string _prefix = "", bool _last = true);
 };
\ No newline at end of file
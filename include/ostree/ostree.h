@@ -40,25 +40,33 @@ class OSTree
         std::shared_ptr<TreeNode> balance(std::shared_ptr<TreeNode> node, bool isFront);
         std::shared_ptr<TreeNode> insertFront(std::shared_ptr<TreeNode> node, VertexID vid, std::shared_ptr<TreeNode> parent);
         std::shared_ptr<TreeNode> insertBack(std::shared_ptr<TreeNode> node, VertexID vid, std::shared_ptr<TreeNode> parent);
+        std::shared_ptr<TreeNode> insertAt(std::shared_ptr<TreeNode> node, VertexID vid, uint vRank, std::shared_ptr<TreeNode> parent); // 插入后vid的排名为vRank
         std::shared_ptr<TreeNode> minValueNode(std::shared_ptr<TreeNode> node);
         std::shared_ptr<TreeNode> erase(std::shared_ptr<TreeNode> node, uint vRank);
         std::shared_ptr<TreeNode> findNode(std::shared_ptr<TreeNode> node, uint rank);
         uint rank(std::shared_ptr<TreeNode> node) const;
-        void getVertexes(std::shared_ptr<TreeNode> node, std::vector<VertexID> &vids);
+        void getVertexes(std::shared_ptr<TreeNode> node, std::vector<VertexID> &vids) const;
         void inOrderTraversal(std::shared_ptr<TreeNode> node) const;
-        std::shared_ptr<TreeNode> buildTree(std::vector<VertexID> &vids, int start, int end, std::shared_ptr<TreeNode> parent = nullptr);
+        std::shared_ptr<TreeNode> buildTree(const std::vector<VertexID> &vids, int start, int end, std::shared_ptr<TreeNode> parent = nullptr);
+        std::shared_ptr<TreeNode> rebalance(std::shared_ptr<TreeNode> node);
+        std::shared_ptr<TreeNode> joinRight(std::shared_ptr<TreeNode> left, std::shared_ptr<TreeNode> pivot, std::shared_ptr<TreeNode> right); // left比right高，沿left的右链向下合并
+        std::shared_ptr<TreeNode> joinLeft(std::shared_ptr<TreeNode> left, std::shared_ptr<TreeNode> pivot, std::shared_ptr<TreeNode> right); // right比left高，沿right的左链向下合并
+        std::shared_ptr<TreeNode> join(std::shared_ptr<TreeNode> left, std::shared_ptr<TreeNode> pivot, std::shared_ptr<TreeNode> right); // 中序为left, pivot, right
 
     public:
         OSTree();
-        void buildTree(std::vector<VertexID>& vids);
+        void buildTree(const std::vector<VertexID>& vids); // 按vids的顺序构建平衡树，O(n)
+        void appendRange(const std::vector<VertexID>& vids); // 将vids按顺序整体接到末尾，O(|vids| + log n)
+        void prependRange(const std::vector<VertexID>& vids); // 将vids按顺序整体接到开头，O(|vids| + log n)
         void insertFront(const VertexID& vid);
         void insertBack(const VertexID& vid);
+        void insertAfter(const VertexID& anchor, const VertexID& vid); // 将vid插入到anchor的后一个位置
         void erase(const VertexID& vid);
-        uint getRank(const VertexID& vid);
-        bool compare(const VertexID& v1, const VertexID& v2);
+        uint getRank(const VertexID& vid) const;
+        bool compare(const VertexID& v1, const VertexID& v2) const;
         bool hasVertex(const VertexID& vid) const;
         VertexID at(uint index);
-        std::vector<VertexID> getVids();
+        std::vector<VertexID> getVids() const;
         uint size() const;
         void display() const;
         void showMap() const;
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <utility>
+#include <climits>
+
+#include "../graph/graph.h"
+#include "../mbptree/mbpnode.h"
+#include "../mbptree/mbptree.h"
+#include "../maintainer/coremaintainer.h"
+#include "../maintainer/shelltree.h"
+#include "indexSnapshot.h"
+#include "../configuration/types.h"
+#include "../configuration/config.h"
+
+class Graph;
+class MbpTree;
+class CoreMaintainer;
+class ShellTree;
+class IndexSnapshot;
+
+// 索引的完整检查点：某一发布版本的IndexSnapshot，加上快照中没有而增量维护需要的mcd、degPlus和各层的k-order。
+// 由semiIndexExtractor::captureCheckpoint在写线程上生成，之后只读，write可以在任意线程上与后续的更新和查询同时执行。
+// 文件以CHECKPOINT_MAGIC开头和结尾，数组按本机字节序原样写出，恢复时不重新计算任何摘要，也不重新做核分解
+class IndexCheckpoint
+{
+    private:
+        static const uint MAX_MBP_DEPTH = 64; // 读取时MbpTree的深度上限，防止损坏的文件导致无限递归
+
+        std::shared_ptr<const IndexSnapshot> snapshot;
+        uint mbpCapacity; // MbpTree的最大容量，0表示没有MbpTree
+        std::vector<VertexID> vids; // 快照中的节点，按编号升序
+        std::vector<uint> mcd; // 与vids一一对应
+        std::vector<uint> degPlus;
+        std::vector<std::pair<uint, std::vector<VertexID>>> korders; // (k, k-order)，按k升序
+
+        // 按顺序读取映射的检查点文件，越界时抛出异常
+        struct Cursor
+        {
+            const char* data;
+            size_t size;
+            size_t pos;
+            std::string filePath;
+
+            void read(void* out, size_t length);
+            template <typename T> T readValue();
+            template <typename T> void readArray(std::vector<T>& out);
+        };
+
+        static void writeBytes(std::ofstream& out, const void* data, size_t length);
+        template <typename T> static void writeArray(std::ofstream& out, const std::vector<T>& values);
+        // 按编号顺序写出快照各块中的一个数组，field返回块中的数组，length为各块数组长度之和
+        template <typename T, typename F> static void writeChunked(std::ofstream& out, const IndexSnapshot& snapshot, uint64_t length, F field);
+        static void writeMbpNode(const FrozenMbpNode& node, std::string& buffer, std::ofstream& out); // 先序写出，buffer攒够后写出
+        static std::shared_ptr<const FrozenMbpNode> readMbpNode(Cursor& cursor, uint level);
+
+    public:
+        IndexCheckpoint(std::shared_ptr<const IndexSnapshot> _snapshot, const CoreMaintainer& coremaintainer, uint _mbpCapacity);
+        IndexCheckpoint(const IndexCheckpoint&) = delete;
+        IndexCheckpoint& operator=(const IndexCheckpoint&) = delete;
+
+        uint getVersion() const;
+        const IndexSnapshot& getSnapshot() const;
+
+        void write(const std::string& path) const; // 先写到path.tmp，完整写出后再改名，中途失败不会破坏已有的检查点
+
+        // 把检查点还原到空的graph和coremaintainer中，shellTree和mbptree为新建的对象（检查点中没有时为nullptr），
+        // 返回检查点的发布版本
+        static uint restore(const std::string& path, Graph& graph, CoreMaintainer& coremaintainer, ShellTree*& shellTree, MbpTree*& mbptree);
+};
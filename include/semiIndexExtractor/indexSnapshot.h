@@ -0,0 +1,169 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <utility>
+#include <climits>
+#include <memory>
+#include <set>
+#include <algorithm>
+#include <string>
+#include <iterator>
+#include <cstddef>
+
+#include "../graph/graph.h"
+#include "../graph/neighborList.h"
+#include "../mbptree/mbptree.h"
+#include "../maintainer/coremaintainer.h"
+#include "../maintainer/shelltree.h"
+#include "../util/chunkedArray.h"
+#include "../util/common.h"
+#include "../configuration/types.h"
+#include "../configuration/config.h"
+
+class Graph;
+class MbpTree;
+class CoreMaintainer;
+class ShellTree;
+
+// IndexSnapshot中编号在同一段[key << SNAPSHOT_CHUNK_BITS, (key + 1) << SNAPSHOT_CHUNK_BITS)中的节点，按编号升序。
+// 块发布之后不再修改，没有改变的块在相邻版本之间共享。
+// 图开启邻接压缩时，块中的邻居也以差分varint存放（与NeighborList的压缩格式相同），遍历时顺序解码
+struct SnapshotChunk
+{
+    std::vector<VertexID> vids;
+    std::vector<uint> cores;
+    std::vector<uint> shellHandles; // 节点所在shell node的句柄，快照没有shell tree时为空
+    std::vector<uint> offsets; // vids[i]的邻居是块中第offsets[i]到第offsets[i+1]个邻居，与Graph中的顺序相同
+    std::vector<VertexID> neighbors; // 不压缩时的邻居，压缩时为空
+    std::vector<uint> codeOffsets; // 压缩时vids[i]的邻居编码为codes[codeOffsets[i], codeOffsets[i+1])，不压缩时为空
+    std::string codes; // 压缩时每个节点的邻居依次编码为与前一个邻居（第一个与0）之差的varint
+
+    bool isPacked() const { return !codeOffsets.empty(); }
+    size_t getNeighborNum() const { return offsets.back(); }
+};
+
+// 快照中一个节点的邻居，按编号升序
+class SnapshotNeighbors
+{
+    public:
+        // 只读前向迭代器，压缩时边遍历边解码，解引用得到的是值
+        class const_iterator
+        {
+            private:
+                const VertexID* cur; // 不压缩时的当前邻居
+                const unsigned char* code; // 压缩时当前邻居的差分位置，不压缩时为nullptr
+                const unsigned char* next; // 下一个差分的位置
+                const unsigned char* codeEnd;
+                VertexID value; // 压缩时当前邻居的编号
+
+            public:
+                typedef std::forward_iterator_tag iterator_category;
+                typedef VertexID value_type;
+                typedef std::ptrdiff_t difference_type;
+                typedef const VertexID* pointer;
+                typedef VertexID reference;
+
+                const_iterator(const VertexID* _cur) : cur(_cur), code(nullptr), next(nullptr), codeEnd(nullptr), value(0) {}
+                const_iterator(const unsigned char* _code, const unsigned char* _codeEnd) : cur(nullptr), code(_code), next(_code), codeEnd(_codeEnd), value(0)
+                {
+                    if(code != codeEnd)
+                    {
+                        value = NeighborList::decodeDelta(next);
+                    }
+                }
+
+                reference operator*() const { return code == nullptr ? *cur : value; }
+                const_iterator& operator++()
+                {
+                    if(code == nullptr)
+                    {
+                        ++cur;
+                        return *this;
+                    }
+                    code = next;
+                    if(code != codeEnd)
+                    {
+                        value += NeighborList::decodeDelta(next);
+                    }
+                    return *this;
+                }
+                const_iterator operator++(int)
+                {
+                    const_iterator old = *this;
+                    ++(*this);
+                    return old;
+                }
+                bool operator==(const const_iterator& other) const { return cur == other.cur && code == other.code; }
+                bool operator!=(const const_iterator& other) const { return !(*this == other); }
+        };
+
+    private:
+        const_iterator first;
+        const_iterator last;
+        size_t count;
+
+    public:
+        SnapshotNeighbors() : first(nullptr), last(nullptr), count(0) {}
+        SnapshotNeighbors(const VertexID* _first, const VertexID* _last) : first(_first), last(_last), count(_last - _first) {}
+        SnapshotNeighbors(const unsigned char* _first, const unsigned char* _last, size_t _count) : first(_first, _last), last(_last, _last), count(_count) {}
+
+        const_iterator begin() const { return first; }
+        const_iterator end() const { return last; }
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+};
+
+// 某一版本的图、cores、shell tree和MbpTree根节点的只读快照。发布之后不再修改，
+// 查询线程持有shared_ptr即可在写线程处理下一批更新时继续使用这个版本，
+// 得到的VO与该版本的根摘要一致；最后一个持有者释放时快照被回收。
+// 节点按编号分块、shell node按句柄分块保存，新版本从上一版本复制块指针，只重建改变的节点和shell node所在的块
+// 节点按原始编号而不是Graph::convertToLocalID的局部编号分块：局部编号在每次分解时重新分配，按它分块的话每个版本都要整体重建
+class IndexSnapshot
+{
+    private:
+        uint version; // 发布序号
+        uint coreVersion; // 对应的CoreMaintainer版本
+
+        ChunkedArray<std::shared_ptr<const SnapshotChunk>> chunks; // vid >> SNAPSHOT_CHUNK_BITS -> 该段的节点，没有节点的段为空指针
+        size_t vertexNum;
+        size_t neighborNum; // 所有节点的邻居数之和
+
+        bool shellReady; // 发布时shell tree存在且没有未修复的删除
+        ChunkedArray<std::shared_ptr<const FrozenShellNode>> shellNodes; // 句柄 -> shell node，已经释放的句柄为空指针
+
+        std::shared_ptr<const FrozenMbpNode> mbpRoot; // 与相邻版本共享没有改变的子树
+
+        friend class IndexCheckpoint; // 检查点直接遍历这些块
+
+        bool locate(const VertexID& vid, const SnapshotChunk*& chunk, uint& index) const; // vid不在快照中时返回false
+        void rebuildChunk(uint key, const Graph& graph, const CoreMaintainer& coremaintainer, const ShellTree* shellTree);
+
+    public:
+        /*
+         * shellTree为空时不保存shell tree，查询退回BFS。previous为空时由当前状态整体构造；
+         * 否则previous必须是上一个构造的快照，且shell tree是否保存与本次相同，changed为此后core、邻居或所在shell node
+         * 改变的节点（包括被删除的节点），changedNodes为此后改变的shell node句柄，其余的块与previous共享
+         */
+        IndexSnapshot(uint _version, const Graph& graph, const CoreMaintainer& coremaintainer, const ShellTree* shellTree, std::shared_ptr<const FrozenMbpNode> _mbpRoot,
+                      const IndexSnapshot* previous, const std::vector<VertexID>& changed, const std::vector<uint>& changedNodes);
+        IndexSnapshot(const IndexSnapshot&) = delete;
+        IndexSnapshot& operator=(const IndexSnapshot&) = delete;
+
+        uint getVersion() const;
+        uint getCoreVersion() const;
+        size_t getVertexNum() const;
+
+        bool hasVertex(const VertexID& vid) const;
+        uint getCore(const VertexID& vid) const;
+        SnapshotNeighbors getNeighbors(const VertexID& vid) const; // vid不在快照中时为空
+
+        bool isShellReady() const;
+        const FrozenShellNode& kcoreNode(const VertexID& queryV, const uint& k) const; // 包含queryV的连通k-core的顶层节点，要求queryV的core不小于k
+        void kcoreVertices(const VertexID& queryV, const uint& k, std::vector<VertexID>& vertices) const; // 包含queryV的连通k-core的全部节点，queryV的core小于k时为空
+        void shellPath(const VertexID& vid, std::set<std::pair<uint, uint>>& path) const; // vid所在节点到根的(coreLevel, id)
+
+        void attachMbpRoot(std::shared_ptr<const FrozenMbpNode> _mbpRoot); // 构造时还没有冻结MbpTree的，在发布之前补上根节点
+        const FrozenMbpNode& getMbpRoot() const;
+        void getRootDigest(unsigned char* _digest) const;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <list>
+#include <set>
+#include <tuple>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <cstring>
+
+#include "../configuration/types.h"
+#include "../configuration/config.h"
+#include "../util/common.h"
+
+typedef std::tuple<uint, uint, uint> QueryCacheKey; // (shell node层级, shell node id, k)
+
+// 一个连通k-core的结果子图，与查询节点无关，同一shell node下的查询共用
+struct CachedAnswer
+{
+    std::vector<VertexID> vertices;
+    std::vector<uint> offsets;
+    std::vector<VertexID> adjacency;
+    std::map<VertexID, std::string> serializedInfo; // 结果子图不变时VO只需要按新的根重新构造
+};
+
+struct CachedVO
+{
+    unsigned char rootDigest[SHA256_DIGEST_LENGTH]; // 构造VO时的MbpTree根摘要
+    std::vector<VOEntry> vo;
+};
+
+// 按(shell node, k)缓存查询结果的LRU。publishIndex在发布新版本之前调用invalidate，
+// 删除包含改变节点的shell node下的所有条目，缓存中剩下的条目对从其版本到最新版本都有效。
+// 结果子图和VO分开保存：子图只有在分量内的节点改变时才失效，VO在根摘要改变后按需重建
+class QueryCache
+{
+    private:
+        struct Entry
+        {
+            QueryCacheKey key;
+            uint version; // 条目插入时的快照版本
+            std::shared_ptr<const CachedAnswer> answer;
+            std::shared_ptr<const CachedVO> vo;
+        };
+
+        size_t capacity;
+        uint latestVersion; // 最近一次invalidate或clear对应的版本，更旧版本上计算的结果不再插入
+        std::list<Entry> lru; // 最近使用的在前
+        std::map<QueryCacheKey, std::list<Entry>::iterator> entries;
+        mutable std::mutex mtx;
+
+    public:
+        QueryCache(size_t _capacity = QUERY_CACHE_SIZE);
+
+        // 命中时返回true，vo为空或根摘要与快照不同时需要调用者重新构造
+        bool lookup(const QueryCacheKey& key, uint version, std::shared_ptr<const CachedAnswer>& answer, std::shared_ptr<const CachedVO>& vo);
+        void insert(const QueryCacheKey& key, uint version, std::shared_ptr<const CachedAnswer> answer, std::shared_ptr<const CachedVO> vo);
+        void updateVO(const QueryCacheKey& key, uint version, std::shared_ptr<const CachedVO> vo);
+
+        void invalidate(const std::set<std::pair<uint, uint>>& shellNodes, uint version); // 删除这些shell node下任意k的条目
+        void clear(uint version);
+        size_t size() const;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <list>
+#include <unordered_map>
+#include <algorithm>
+#include <climits>
+
+#include "../configuration/types.h"
+#include "../configuration/config.h"
+#include "../util/common.h"
+
+// 一次k-core查询的全部临时状态。reset只递增epoch并清空各个向量（保留容量），
+// 连续执行的查询之间不释放也不重新申请内存。每个查询线程使用自己的QueryContext，
+// 共享的索引在查询期间只读
+struct QueryContext
+{
+    uint epoch;
+    std::vector<uint> stamp; // VertexID -> 最近一次被标记时的epoch，等于当前epoch表示本次查询已标记
+    std::vector<uint> slot; // VertexID -> 在vertices中的下标，stamp为当前epoch时有效
+
+    std::vector<VertexID> vertices; // 结果子图的节点，按编号升序
+    std::vector<uint> offsets; // vertices[i]的邻居为adjacency[offsets[i], offsets[i+1])
+    std::vector<VertexID> adjacency; // 结果子图的邻接表，每个节点的邻居按编号升序
+    std::vector<VertexID> frontier; // BFS队列
+    std::vector<uint> degree; // 剥离时按vertices下标保存的剩余度数
+    bool answerExists;
+    uint snapshotVersion; // 回答查询所用的IndexSnapshot版本
+    std::vector<VOEntry> vo; // 结果子图的VO
+
+    std::map<uint, std::list<VertexID>> liIndex;
+    std::unordered_map<VertexID, uint> liIndexExists;
+
+    QueryContext();
+
+    void reset();
+    bool mark(const VertexID& vid); // 本次查询中第一次标记时返回true
+    bool isMarked(const VertexID& vid) const;
+    void unmark(const VertexID& vid);
+
+    uint getVertexNum() const;
+    uint getNeighborNum(uint index) const;
+    const VertexID* neighborsBegin(uint index) const;
+    const VertexID* neighborsEnd(uint index) const;
+};
+
+// 多个查询共用的证明。QueryContext中保存所有结果子图的并集和覆盖并集的一份VO，
+// 每个节点的信息只出现一次，格式与单个查询的VO相同；某个查询的结果是并集子图中
+// 由其节点集合导出的子图
+struct MultiProof
+{
+    std::vector<std::vector<VertexID>> communities; // 去重后的结果节点集合，按编号升序
+    std::vector<uint> communityOf; // 查询下标 -> communities下标
+};
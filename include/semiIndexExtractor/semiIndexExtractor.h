@@ -7,6 +7,15 @@
 #include <algorithm>
 #include <list>
 #include <random>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <memory>
+#include <deque>
+#include <set>
+#include <array>
+#include <thread>
+#include <exception>
 
 #include "../graph/graph.h"
 #include "../graph/vertex.h"
@@ -14,7 +23,17 @@
 #include "../mbptree/mbptree.h"
 #include "../maintainer/coremaintainer.h"
 #include "../maintainer/shelltree.h"
+#include "queryContext.h"
+#include "indexSnapshot.h"
+#include "indexCheckpoint.h"
+#include "queryCache.h"
 #include "../util/common.h"
+#include "../util/threadPool.h"
+#include "../util/voSink.h"
+#include "../util/boundedQueue.h"
+#include "../util/edgeReader.h"
+#include "../util/updateCoalescer.h"
+#include "../util/updateLog.h"
 #include "../configuration/types.h"
 
 class Vertex;
@@ -24,6 +43,16 @@ class OSTree;
 class CoreMaintainer;
 class ShellTree;
 
+// 更新流水线发布一批之后交给回调的信息，插入和删除数为合并并去掉无效操作之后的边数
+struct PublishedBatch
+{
+    size_t round;
+    size_t updateNum;
+    size_t insertNum;
+    size_t removeNum;
+    uint version;
+};
+
 class semiIndexExtractor
 {
     private:
@@ -31,18 +60,66 @@ class semiIndexExtractor
         CoreMaintainer coremaintainer;
         ShellTree* shellTree;
 
-        std::vector<VertexID> candVertices;
-        Graph candGraph;
-
-        std::map<uint, std::list<VertexID>> liIndex;
-        std::unordered_map<VertexID, uint> liIndexExists;
-
-        bool answerExists;
+        QueryContext queryCtx; // 单查询接口使用的上下文，候选集、结果子图、VO和LiIndex都保存在其中
 
         MbpTree* mbptree;
-        std::vector<VOEntry> vo;
+
+        ThreadPool* pool;
+
+        // coremaintainer、shellTree和mbptree只由写线程访问。更新接口只标记索引已改变，
+        // publishIndex把当前状态发布为新的IndexSnapshot，查询只读取快照，可以与下一批更新同时进行
+        bool indexDirty;
+        uint publishedVersion;
+        std::deque<std::shared_ptr<const IndexSnapshot>> snapshots; // 最近发布的SNAPSHOT_RETAIN_NUM个快照，最后一个为最新版本
+        std::shared_ptr<const IndexSnapshot> lastPrepared; // 写线程最近构造的快照，下一个快照与它共享没有改变的块
+        bool snapshotRebuild; // cores或shell tree被整体替换，下一个快照不能与lastPrepared共享
+        mutable std::mutex snapshotMtx;
+        std::mutex contextMtx;
+        std::vector<QueryContext*> idleContexts; // 并发查询复用的QueryContext
+
+        static const VOEntry::DataType VO_PAYLOAD_TYPE = VO_PACKED_PAYLOAD ? VOEntry::PACKEDDATA : VOEntry::NODEDATA; // serializeGraphInfo生成的节点信息格式
+
+        mutable QueryCache queryCache; // 按(shell node, k)缓存的结果子图和VO
+        bool shellRebuilt; // shell tree重建后节点id重新分配，发布时清空缓存
+
+        UpdateLog* updateLog; // 不为空时，流水线应用的每一批先写入日志，落盘之后才发布
+
+        // 更新流水线中已经应用到图和cores、等待更新MbpTree并发布的一批
+        struct PendingPublish
+        {
+            std::shared_ptr<IndexSnapshot> snapshot; // 还没有MbpTree根节点
+            std::vector<std::pair<VertexID, std::array<unsigned char, SHA256_DIGEST_LENGTH>>> digests; // 这一批中邻居改变的节点的新摘要
+            std::vector<VertexID> removed; // 这一批中从图中移除、需要从MbpTree删除的节点
+            std::vector<VertexID> changed; // 这一批中core、邻居或所在shell node改变的节点，用于失效查询缓存
+            PublishedBatch info;
+            uint64_t logSeq; // 这一批在updateLog中的序号，0表示没有写日志
+        };
+
+        QueryContext* acquireContext();
+        void releaseContext(QueryContext* ctx);
+
+        bool isShellTreeReady() const;
+        void shellCandidateGeneration(const IndexSnapshot& snapshot, const VertexID& queryV, const uint& k, QueryContext& ctx) const; // 由shell tree直接得到连通k-core
+        void buildCandAdjacency(const IndexSnapshot& snapshot, QueryContext& ctx) const; // 由ctx中已标记的节点生成结果子图的邻接表
+        void extractCandidates(const IndexSnapshot& snapshot, const VertexID& queryV, const uint& k, QueryContext& ctx) const; // 结果保存在ctx中
+        void loadCachedAnswer(const IndexSnapshot& snapshot, const QueryCacheKey& key, const CachedAnswer& answer, std::shared_ptr<const CachedVO> cachedVO, QueryContext& ctx) const; // 根摘要改变时重建VO并写回缓存
+        // changed为previous之后core、邻居或所在shell node改变的节点，由prepareIndex得到
+        void invalidateQueryCache(const IndexSnapshot* previous, const IndexSnapshot& published, const std::vector<VertexID>& changed);
+        // 发布的前一半：复制改变的节点和shell node，只读写线程的状态；上一个快照之后改变的节点追加到changed
+        std::shared_ptr<IndexSnapshot> prepareIndex(const Graph& graph, std::vector<VertexID>& changed);
+        void commitIndex(std::shared_ptr<IndexSnapshot> prepared, const std::vector<VertexID>& changed); // 发布的后一半：冻结MbpTree并使新版本可见，只读写mbptree和快照窗口
+        void dropNoOpUpdates(const Graph& graph, std::vector<std::pair<VertexID, VertexID>>& edges, bool isInsert) const;
+        // 先删除后插入，应用到graph、cores和shell tree；detached为这一批中从图中移除的孤立节点，按编号升序
+        void applyBatch(Graph& graph, const UpdateBatch& batch, std::vector<VertexID>& detached);
+        // 按端点第一次出现的顺序收集这一批改变的节点摘要和detached中被删除的节点，追加到pending。
+        // 之前就不在图中的端点（更早被移除或从未出现）不在MbpTree中，不需要删除
+        void collectBatchDigests(const Graph& graph, const UpdateBatch& batch, const std::vector<VertexID>& detached, std::unordered_set<VertexID>& seen, PendingPublish& pending) const;
+        void applyBatchDigests(const PendingPublish& pending); // 写入MbpTree的叶子，不重新计算内部节点摘要
+        // readBatch在读线程中调用，没有更多更新时返回false
+        void runUpdatePipeline(Graph& graph, const std::function<bool(UpdateBatch&)>& readBatch, bool dropNoOps, const std::function<void(const PublishedBatch&)>& onPublished);
+        void serializeVertex(const IndexSnapshot& snapshot, const QueryContext& ctx, uint index, std::string& out) const; // ctx.vertices[index]的节点信息
     public:
-        semiIndexExtractor();
+        semiIndexExtractor(uint threadNum = 0);
         ~semiIndexExtractor();
         
         void buildMbpTree(const Graph& graph, const uint maxcapacity);
@@ -51,15 +128,19 @@ class semiIndexExtractor
         void mbpTreeDeleteEdgeUpdate(const Vertex& v); // 节点未被删除，但是节点信息发生改变，需要更新节点的摘要
         void mbpTreeDeleteVertexUpdate(const VertexID& vid); // 节点被删除，需要删除mbp树中该节点的摘要
 
-        std::map<VertexID, std::string> serializeGraphInfo(const Graph& graph, const Graph& subgraph, std::vector<VertexID>& subgraphVids);
+        std::map<VertexID, std::string> serializeGraphInfo(const IndexSnapshot& snapshot, const QueryContext& ctx) const; // 格式由VO_PACKED_PAYLOAD决定
+
+        void constructVO(const IndexSnapshot& snapshot, QueryContext& ctx) const; // VO保存在ctx.vo中
 
-        void constructVO(const Graph& G, const Graph& subgraph);
+        void streamVO(const IndexSnapshot& snapshot, const QueryContext& ctx, VOSink& sink) const; // VO边构造边写入sink，不保存节点信息
 
-        void getRootDigest(unsigned char* _digest);
+        void getRootDigest(unsigned char* _digest); // 最新发布的快照的根摘要，还没有发布时为当前MbpTree的根摘要
 
         void vertify(Graph& subgraph, std::queue<VOEntry>& VO, unsigned char* partdigest);
 
-        size_t calculateVOSize();
+        size_t calculateVOSize() const;
+
+        static size_t calculateVOSize(const std::vector<VOEntry>& vo);
 
         const std::vector<VOEntry>& getVO() const;
 
@@ -69,16 +150,61 @@ class semiIndexExtractor
 
         void removeCoreUpdate(const Graph& graph, const VertexID& src, const VertexID& dst);
 
+        void insertCoreUpdateBatch(Graph& graph, const std::vector<std::pair<VertexID, VertexID>>& edges); // 同时负责把边加入graph
+
+        void removeCoreUpdateBatch(Graph& graph, const std::vector<std::pair<VertexID, VertexID>>& edges); // 同时负责把边从graph删除
+
         void coresDecomposition(const Graph& graph);
 
-        void candidateGeneration(const Graph& graph, const VertexID& queryV, const uint& k);
+        void candidateGeneration(const IndexSnapshot& snapshot, const VertexID& queryV, const uint& k, QueryContext& ctx) const;
 
-        void globalExtract(const VertexID& queryV, const uint& k);
+        void globalExtract(const VertexID& queryV, const uint& k, QueryContext& ctx) const;
 
-        Graph kcoreExtract(const Graph& graph, const VertexID& queryV, const uint& k);
+        Graph kcoreExtract(const Graph& graph, const VertexID& queryV, const uint& k); // 返回结果子图的Graph副本
 
         // Graph kcoreExtractByShell(const Graph& graph, const VertexID& queryV, const uint& k);
-        std::chrono::milliseconds kcoreExtractByShell(const Graph& graph, const VertexID& queryV, const uint& k);
+        std::chrono::milliseconds kcoreExtractByShell(const Graph& graph, const VertexID& queryV, const uint& k); // 提取k-core并构造VO，结果由getQueryContext和getVO获得
+
+        void publishIndex(const Graph& graph); // 由写线程在一批更新结束后调用，索引没有改变时不发布新版本
+
+        // 以流水线方式应用reader中剩余的全部边并逐批发布：读线程预读后面的批，调用线程维护图和cores，
+        // 摘要线程为前一批更新MbpTree并发布。onPublished在摘要线程中按顺序调用
+        void applyUpdateStream(Graph& graph, EdgeReader& reader, uint batchNum, bool isInsert, const std::function<void(const PublishedBatch&)>& onPublished);
+        // 与applyUpdateStream相同，但reader为带操作码的更新日志，每批先由UpdateCoalescer合并，再去掉对照图无效的操作
+        void applyMixedUpdateStream(Graph& graph, EdgeReader& reader, uint batchNum, const std::function<void(const PublishedBatch&)>& onPublished);
+
+        // 压缩graph的邻接内存，发布当前状态并生成检查点，由写线程调用；返回的检查点只读，可以交给其他线程write，写线程继续处理更新
+        std::shared_ptr<const IndexCheckpoint> captureCheckpoint(Graph& graph);
+
+        // 从检查点恢复graph和全部索引并发布检查点中的版本，graph须为空；之前的索引和快照全部丢弃
+        void restoreCheckpoint(const std::string& path, Graph& graph);
+
+        void attachUpdateLog(UpdateLog* log); // 之后流水线应用的批次都写入log，传入nullptr取消关联
+
+        // 重放log中版本大于当前发布版本的记录，返回重放的批数。所有记录依次应用之后只按最后一条记录的版本发布一次，
+        // onPublished也只调用一次，计数为全部记录之和；通常在restoreCheckpoint之后调用，重放的批次不会再次写入日志
+        size_t replayUpdateLog(Graph& graph, const UpdateLog& log, const std::function<void(const PublishedBatch&)>& onPublished);
+
+        std::shared_ptr<const IndexSnapshot> getSnapshot() const; // 任意线程都可以调用，持有返回值期间该版本不会被回收
+
+        std::shared_ptr<const IndexSnapshot> getSnapshot(uint version) const; // 已经不在保留窗口中的版本返回空指针
+
+        bool getRootDigest(uint version, unsigned char* _digest) const; // 保留窗口中某个版本的根摘要
+
+        void kcoreQuery(const IndexSnapshot& snapshot, const VertexID& queryV, const uint& k, QueryContext& ctx) const; // 在快照上提取k-core并构造VO
+
+        void kcoreQueryStream(const IndexSnapshot& snapshot, const VertexID& queryV, const uint& k, QueryContext& ctx, VOSink& sink) const; // 结果子图保存在ctx中，VO写入sink
+
+        // 在线程池上并发执行一组查询，每个查询完成后在执行它的线程上调用onResult(查询下标, 结果)，
+        // onResult返回后ctx会被其他查询复用；写线程可以同时处理下一批更新
+        void kcoreQueryBatch(std::shared_ptr<const IndexSnapshot> snapshot, const std::vector<VertexID>& queries, const uint& k, const std::function<void(size_t, const QueryContext&)>& onResult);
+
+        // 执行一批(查询节点, k)：按结果所在的shell node分组，每个连通分量只提取一次，
+        // 所有需要新VO的分量在一次MbpTree遍历中构造VO；同组的查询依次以同一个ctx回调onResult
+        void kcoreQueryGroups(std::shared_ptr<const IndexSnapshot> snapshot, const std::vector<std::pair<VertexID, uint>>& queries, const std::function<void(size_t, const QueryContext&)>& onResult);
+
+        // 一次MbpTree遍历为一组查询构造合并的证明，并集子图和VO保存在ctx中
+        void kcoreMultiProof(const IndexSnapshot& snapshot, const std::vector<std::pair<VertexID, uint>>& queries, MultiProof& proof, QueryContext& ctx) const;
 
         VertexID getLiIndexTop() const;
 
@@ -90,7 +216,7 @@ class semiIndexExtractor
 
         bool isLiIndexEmpty() const;
 
-        const Graph& getCandGraph() const;
+        const QueryContext& getQueryContext() const;
 
         void buildShellTree(const Graph& graph);
 
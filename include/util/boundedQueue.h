@@ -0,0 +1,64 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+#include "../configuration/types.h"
+
+// 有容量上限的阻塞队列，用于流水线各阶段之间传递数据：队列满时push阻塞，下游处理不过来时上游自然停下
+template <typename T>
+class BoundedQueue
+{
+    private:
+        std::deque<T> items;
+        size_t capacity;
+        bool closed;
+        std::mutex mtx;
+        std::condition_variable notEmpty;
+        std::condition_variable notFull;
+
+    public:
+        BoundedQueue(size_t _capacity) : capacity(_capacity == 0 ? 1 : _capacity), closed(false) {}
+
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        // 队列已关闭时返回false，item不会被放入队列
+        bool push(T&& item)
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            notFull.wait(lock, [this]() { return closed || items.size() < capacity; });
+            if(closed)
+            {
+                return false;
+            }
+            items.emplace_back(std::move(item));
+            notEmpty.notify_one();
+            return true;
+        }
+
+        // 队列已关闭且没有剩余元素时返回false
+        bool pop(T& item)
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            notEmpty.wait(lock, [this]() { return closed || !items.empty(); });
+            if(items.empty())
+            {
+                return false;
+            }
+            item = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+            return true;
+        }
+
+        // 关闭后不再接受新元素，已有的元素仍然可以取出，阻塞中的push和pop都会返回
+        void close()
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            closed = true;
+            notEmpty.notify_all();
+            notFull.notify_all();
+        }
+};
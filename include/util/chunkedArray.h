@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "../configuration/types.h"
+#include "../configuration/config.h"
+
+// 按2^SNAPSHOT_CHUNK_BITS个元素分块的持久数组：拷贝只复制各块的指针，set只复制被修改的、
+// 仍与其他拷贝共享的块，所以相邻版本之间没有修改的块是共享的。
+// 只有写线程拷贝和修改，已经发布的拷贝只读，可以被多个线程同时访问
+template <typename T>
+class ChunkedArray
+{
+    private:
+        std::vector<std::shared_ptr<std::vector<T>>> chunks; // 从未写入过的块为空指针，其元素都为fill
+        size_t length;
+        T fill;
+
+    public:
+        static const size_t CHUNK_SIZE = (size_t)1 << SNAPSHOT_CHUNK_BITS;
+
+        explicit ChunkedArray(const T& _fill = T()) : length(0), fill(_fill) {}
+
+        size_t size() const
+        {
+            return length;
+        }
+
+        // 越界或所在的块没有写入过时返回fill
+        const T& operator[](size_t i) const
+        {
+            if(i >= length)
+            {
+                return fill;
+            }
+            const std::shared_ptr<std::vector<T>>& chunk = chunks[i >> SNAPSHOT_CHUNK_BITS];
+            return chunk == nullptr ? fill : (*chunk)[i & (CHUNK_SIZE - 1)];
+        }
+
+        // i不小于size时数组扩展到i + 1
+        void set(size_t i, const T& value)
+        {
+            if(i >= length)
+            {
+                length = i + 1;
+                chunks.resize(((length - 1) >> SNAPSHOT_CHUNK_BITS) + 1);
+            }
+            std::shared_ptr<std::vector<T>>& chunk = chunks[i >> SNAPSHOT_CHUNK_BITS];
+            if(chunk == nullptr)
+            {
+                chunk = std::make_shared<std::vector<T>>(CHUNK_SIZE, fill);
+            }
+            else if(chunk.use_count() > 1) // 其他版本仍持有这一块，先复制
+            {
+                chunk = std::make_shared<std::vector<T>>(*chunk);
+            }
+            (*chunk)[i & (CHUNK_SIZE - 1)] = value;
+        }
+};
+
+template <typename T>
+const size_t ChunkedArray<T>::CHUNK_SIZE;
@@ -21,21 +21,35 @@ struct cmdOptions
     std::string filename;
     std::string addFilename;
     std::string deleteFilename;
+    std::string updateFilename; // 插入和删除交错的更新日志
+    std::string checkpointFilename; // 插入阶段结束后在后台写出的检查点
+    std::string restoreFilename; // 不为空时从该检查点恢复，代替加载图和构建索引
+    std::string updateLogFilename; // 已应用批次的预写日志，恢复检查点之后从中重放
     std::string experimentFilePath;
+    bool compressAdjacency; // 邻居表使用差分varint压缩
+    std::string vertexOrder; // 局部编号顺序：id、degree或rcm
     VertexID query;
     uint k;
     uint khop;
     uint maxcapacity;
+    uint threadNum;
     std::map<uint, std::vector<VertexID>> queryMap;
 };
 
+struct PackedPayload
+{
+    unsigned char* bytes;
+    uint length;
+};
+
 struct VOEntry
 {
-    enum DataType {NODEDATA, DIGEST, SPECIAL};
+    enum DataType {NODEDATA, DIGEST, SPECIAL, PACKEDDATA};
     DataType type;
     union
     {
         char* nodeData; // 以节点v的id打头，后面跟着v在子图中的邻居节点，然后以'|'分割，然后跟着v在原图中的邻居节点（除去在子图中的邻居节点）
+        PackedPayload packedData; // 与nodeData信息相同的二进制格式，见encodeVertexPayload
         unsigned char digest[SHA256_DIGEST_LENGTH];
         char specialChar;
     };
@@ -46,6 +60,25 @@ struct VOEntry
         std::strcpy(nodeData, serializedVertexInfo.c_str());
     }
 
+    VOEntry(const std::string& payload, DataType _type) : type(_type) // payload为serializeGraphInfo按_type生成的节点信息
+    {
+        if(type == NODEDATA)
+        {
+            nodeData = new char[payload.length() + 1];
+            std::strcpy(nodeData, payload.c_str());
+        }
+        else if(type == PACKEDDATA)
+        {
+            packedData.length = payload.length();
+            packedData.bytes = new unsigned char[packedData.length];
+            std::memcpy(packedData.bytes, payload.data(), packedData.length);
+        }
+        else
+        {
+            throw std::runtime_error("Invalid VOEntry type!");
+        }
+    }
+
     VOEntry(const unsigned char* _digest, size_t length) : type(DIGEST)
     {
         if(length!= SHA256_DIGEST_LENGTH)
@@ -83,6 +116,11 @@ struct VOEntry
             case SPECIAL:
                 specialChar = other.specialChar;
                 break;
+            case PACKEDDATA:
+                packedData.length = other.packedData.length;
+                packedData.bytes = new unsigned char[packedData.length];
+                std::memcpy(packedData.bytes, other.packedData.bytes, packedData.length);
+                break;
             default:
                 throw std::runtime_error("Invalid VOEntry type!");
         }
@@ -94,6 +132,10 @@ struct VOEntry
         {
             delete[] nodeData;
         }
+        else if(type == PACKEDDATA)
+        {
+            delete[] packedData.bytes;
+        }
     }
 
     void printVOEntry() const
@@ -115,6 +157,12 @@ struct VOEntry
             case SPECIAL:
                 std::cout << specialChar;
                 break;
+            case PACKEDDATA:
+                for(size_t i = 0; i < packedData.length; i++)
+                {
+                    printf("%02x", packedData.bytes[i]);
+                }
+                break;
             default:
                 throw std::runtime_error("Invalid VOEntry type!");
         }
@@ -145,4 +193,42 @@ std::pair<std::string, std::string> splitStringtoTwoParts(const std::string& str
 
 void splitString(const std::string& str, const std::string& delimiter, std::vector<VertexID>& result);
 
+void appendVarint(uint64_t value, std::string& out); // 每字节7位，低位在前，最高位表示后面还有字节
+uint64_t readVarint(const unsigned char*& cur, const unsigned char* end); // 读取后cur指向下一个字节，数据不完整时抛出异常
+
+// 打包的节点信息：varint(vid) varint(度数) 原图邻居的差分varint（第一个为原值），之后是按邻居顺序
+// 标记子图邻居的位图（第i个邻居对应第i/8字节的第i%8位）。原图邻居和子图邻居都按编号升序
+// 原图邻居[neighborsBegin, neighborsEnd)可以是任意的前向迭代器（如边遍历边解码的压缩邻居表），degree为其中的邻居数
+template<typename Iterator>
+void encodeVertexPayload(const VertexID& vid, size_t degree, Iterator neighborsBegin, Iterator neighborsEnd, const VertexID* subgraphBegin, const VertexID* subgraphEnd, std::string& out)
+{
+    out.clear();
+    appendVarint(vid, out);
+    appendVarint(degree, out);
+    VertexID prev = 0;
+    for(Iterator it = neighborsBegin; it != neighborsEnd; ++it)
+    {
+        appendVarint(*it - prev, out);
+        prev = *it;
+    }
+    size_t bitmapStart = out.size();
+    out.append((degree + 7) / 8, '\0');
+    const VertexID* sub = subgraphBegin;
+    size_t i = 0;
+    for(Iterator it = neighborsBegin; it != neighborsEnd && sub != subgraphEnd; ++it, ++i)
+    {
+        if(*it == *sub)
+        {
+            out[bitmapStart + i / 8] |= (char)(1 << (i % 8));
+            ++sub;
+        }
+    }
+}
+void decodeVertexPayload(const unsigned char* bytes, size_t length, VertexID& vid, std::vector<VertexID>& neighbors, std::vector<VertexID>& subgraphNeighbors);
+std::string vertexDigestPreimage(const VertexID& vid, const std::vector<VertexID>& neighbors); // 与Vertex::digestCompute相同的"vid/n1/n2..."
+
+// 文件原子替换使用：写完临时文件后syncFile，rename之后syncParentDirectory使目录项落盘，失败时返回false
+bool syncFile(const std::string& path);
+bool syncParentDirectory(const std::string& path);
+
 std::queue<VOEntry> convertVectorToQueue(const std::vector<VOEntry>& VO);
\ No newline at end of file
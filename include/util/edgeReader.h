@@ -1,23 +1,63 @@
+#pragma once
+
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <string>
 #include <sstream>
+#include <climits>
 
 #include "../configuration/types.h"
 #include "../configuration/config.h"
 
+// 更新日志中的一条记录
+struct EdgeUpdate
+{
+    VertexID src;
+    VertexID dst;
+    bool isInsert;
+};
+
+// 以内存映射的方式按批读取边文件或更新日志，支持以下格式：
+// 文本：每行"src dst"，空白分隔，行内多余的内容忽略，空行跳过；行首可以有操作码'+'（插入）或'-'（删除），没有时为插入；
+// 二进制边文件：EDGE_BINARY_MAGIC开头，之后每条边为varint(src) varint(dst)，由convertToBinary生成；
+// 二进制更新日志：UPDATE_BINARY_MAGIC开头，之后每条更新为varint(src*2+是否删除) varint(dst)，由convertUpdatesToBinary生成
 class EdgeReader
 {
     private:
-        std::ifstream file;
+        enum Format
+        {
+            TEXT,
+            BINARY_EDGES,
+            BINARY_UPDATES
+        };
+
         std::string filePath;
+        const char* data; // 映射的文件内容，空文件时为nullptr
+        size_t size;
+        size_t pos; // 下一次读取的位置
+        Format format;
         bool endOfFile;
 
+        void closeFile();
+        bool parseTextEdge(VertexID& src, VertexID& dst, bool& isInsert); // 没有更多的边时返回false
+        bool parseBinaryEdge(VertexID& src, VertexID& dst, bool& isInsert);
+        bool parseNext(VertexID& src, VertexID& dst, bool& isInsert);
+        void finishBatch(); // 读完一批后跳过结尾的空白并更新endOfFile
+
     public:
         EdgeReader(const std::string& _filePath = "");
         ~EdgeReader();
+        EdgeReader(const EdgeReader&) = delete;
+        EdgeReader& operator=(const EdgeReader&) = delete;
+
         void setFilePath(const std::string& _filePath);
-        std::vector<std::pair<VertexID, VertexID>> readNextEdges(const uint& num);
+        // 读取至多num条边到edges中（先清空，保留容量以便重复使用），返回读取的边数
+        uint readNextEdges(const uint& num, std::vector<std::pair<VertexID, VertexID>>& edges);
+        std::vector<std::pair<VertexID, VertexID>> readNextEdges(const uint& num); // 遇到删除操作时抛出异常
+        uint readNextUpdates(const uint& num, std::vector<EdgeUpdate>& updates); // 与readNextEdges相同，但保留操作码
         bool isEndOfFile() const;
-};
\ No newline at end of file
+
+        static void convertToBinary(const std::string& textPath, const std::string& binaryPath); // 把文本边文件转换为二进制格式
+        static void convertUpdatesToBinary(const std::string& textPath, const std::string& binaryPath); // 把文本更新日志转换为二进制格式
+};
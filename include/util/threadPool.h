@@ -0,0 +1,57 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <exception>
+
+#include "../configuration/types.h"
+#include "../configuration/config.h"
+
+// 工作窃取线程池：每个工作线程拥有自己的任务队列，从队尾取任务，空闲时从其他队列的队头窃取
+class ThreadPool
+{
+    private:
+        struct WorkerQueue
+        {
+            std::mutex mtx;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<WorkerQueue>> queues;
+
+        std::mutex waitMtx;
+        std::condition_variable taskCv; // 有新任务或线程池停止
+        std::condition_variable doneCv; // 有任务执行结束
+
+        std::atomic<size_t> queuedTasks; // 队列中尚未被取走的任务数
+        std::atomic<size_t> unfinishedTasks; // 已提交但尚未执行结束的任务数
+        std::atomic<size_t> nextQueue;
+        bool stop;
+
+        bool popTask(size_t queueIndex, std::function<void()>& task); // 先取自己的队尾，再窃取其他队列的队头
+        void workerLoop(size_t queueIndex);
+        void finishTask();
+
+    public:
+        ThreadPool(uint threadNum = 0); // threadNum为0时使用硬件线程数
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        uint size() const;
+
+        void submit(std::function<void()> task);
+        bool runPendingTask(); // 调用线程帮助执行一个排队中的任务，没有任务时返回false
+        void wait(); // 等待所有已提交的任务执行结束
+
+        void parallelFor(size_t num, const std::function<void(size_t)>& func); // 并行执行func(0)...func(num-1)，返回时全部执行结束；func抛出异常时等所有块结束后重新抛出第一个异常
+};
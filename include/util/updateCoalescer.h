@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include <algorithm>
+
+#include "edgeReader.h"
+#include "../configuration/types.h"
+
+// 合并后的一批更新，inserts和removes中的边互不相同
+struct UpdateBatch
+{
+    std::vector<std::pair<VertexID, VertexID>> inserts;
+    std::vector<std::pair<VertexID, VertexID>> removes;
+    size_t updateNum; // 合并前的更新数
+    uint version; // 从UpdateLog重放时为记录中的发布版本，其他情况为0
+
+    UpdateBatch() : updateNum(0), version(0) {}
+    void clear();
+};
+
+// 一批混合更新在进入Graph、CoreMaintainer和MbpTree之前先合并：同一条边（不区分方向）只保留批内最后一次操作，
+// 位置为第一次出现的位置。先加后删的边只剩一次删除，边原本不存在时由调用者对照图过滤掉
+class UpdateCoalescer
+{
+    private:
+        std::unordered_map<uint64_t, size_t> slotOf; // 边 -> ops中的下标，每批复用
+        std::vector<EdgeUpdate> ops;
+
+    public:
+        void coalesce(const std::vector<EdgeUpdate>& updates, UpdateBatch& batch);
+};
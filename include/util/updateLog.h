@@ -0,0 +1,62 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <utility>
+#include <mutex>
+#include <climits>
+
+#include "updateCoalescer.h"
+#include "../configuration/types.h"
+#include "../configuration/config.h"
+
+// 已应用的更新批次的预写日志（WAL），用于在两次检查点之间崩溃后恢复。文件以UPDATE_LOG_MAGIC开头，之后每批一条记录：
+// payloadLength(4) version(4) updateNum(4) payload checksum(8)，payload中先删除后插入，每条边的编码与二进制更新日志相同，
+// checksum为header和payload的SHA256的前8字节。打开时截掉结尾写了一半的记录
+class UpdateLog
+{
+    private:
+        struct Record
+        {
+            uint version; // 这一批发布的版本
+            uint64_t offset; // payload在文件中的位置
+            uint payloadLength;
+            uint updateNum;
+        };
+
+        std::string filePath;
+        int fd;
+        std::vector<Record> records;
+        uint64_t fileSize;
+        uint64_t appendedSeq; // 已经write的记录数
+        uint64_t syncedSeq; // 已经落盘的记录数
+        std::string buffer;
+        mutable std::mutex appendMtx; // 保护records、fileSize和appendedSeq
+        std::mutex syncMtx;
+
+        static const uint HEADER_LENGTH = 12;
+        static const uint CHECKSUM_LENGTH = 8;
+
+        void openFile(); // 打开并校验已有的记录，截掉第一条损坏的记录及其之后的内容
+        void writeAt(const char* data, size_t length, uint64_t offset) const;
+        bool readAt(char* data, size_t length, uint64_t offset) const; // 文件不够长时返回false
+        static void computeChecksum(const char* data, size_t length, unsigned char* checksum); // header和payload连续存放
+
+    public:
+        UpdateLog(const std::string& _filePath); // 不存在时创建
+        ~UpdateLog();
+        UpdateLog(const UpdateLog&) = delete;
+        UpdateLog& operator=(const UpdateLog&) = delete;
+
+        // 追加一批，版本须大于已有记录的版本；返回的序号交给sync。只写入内核缓冲，不等待落盘
+        uint64_t append(uint version, const UpdateBatch& batch);
+        // 等待序号不大于seq的记录落盘。一次fdatasync覆盖调用时已经追加的所有记录，先后到来的多批共用一次（group commit）
+        void sync(uint64_t seq);
+
+        size_t getRecordNum() const;
+        uint getRecordVersion(size_t index) const;
+        void readRecord(size_t index, UpdateBatch& batch) const; // 可以与append同时调用
+
+        void discardThrough(uint version); // 检查点已经覆盖这个版本之后，丢弃版本不大于它的记录
+};
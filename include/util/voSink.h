@@ -0,0 +1,86 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <functional>
+#include <openssl/sha.h>
+
+#include "common.h"
+#include "../configuration/types.h"
+#include "../configuration/config.h"
+
+// VO的输出端。构造VO时按遍历顺序逐个写入条目，不需要先在内存中生成完整的VO
+class VOSink
+{
+    public:
+        virtual ~VOSink() {}
+        virtual void special(char specialChar) = 0; // '['或']'
+        virtual void digest(const unsigned char* digest) = 0;
+        virtual void payload(const std::string& payload, VOEntry::DataType type) = 0; // NODEDATA或PACKEDDATA
+};
+
+// 保存为VOEntry数组，结果与原来的constructVO相同
+class VectorVOSink : public VOSink
+{
+    private:
+        std::vector<VOEntry>& vo;
+
+    public:
+        VectorVOSink(std::vector<VOEntry>& _vo);
+        void special(char specialChar) override;
+        void digest(const unsigned char* digest) override;
+        void payload(const std::string& payload, VOEntry::DataType type) override;
+};
+
+// 以字节流输出VO：'['和']'各一个字节，'D'后跟32字节摘要，'N'或'P'后跟varint(长度)和节点信息。
+// 缓冲区攒够VO_SINK_BUFFER_SIZE字节后交给write，可以写入文件描述符、环形缓冲区或网络连接
+class ByteVOSink : public VOSink
+{
+    private:
+        std::function<void(const char*, size_t)> write;
+        std::string buffer;
+        size_t bytesWritten;
+
+        void append(const char* data, size_t length);
+
+    public:
+        ByteVOSink(std::function<void(const char*, size_t)> _write);
+        ~ByteVOSink(); // 析构时写出剩余的字节
+        ByteVOSink(const ByteVOSink&) = delete;
+        ByteVOSink& operator=(const ByteVOSink&) = delete;
+
+        void special(char specialChar) override;
+        void digest(const unsigned char* digest) override;
+        void payload(const std::string& payload, VOEntry::DataType type) override;
+        void flush();
+        size_t getBytesWritten() const; // 已经交给write的字节数
+};
+
+class FdVOSink : public ByteVOSink
+{
+    public:
+        FdVOSink(int fd); // 不负责关闭fd，写失败时抛出异常
+};
+
+// 增量验证ByteVOSink输出的字节流。feed可以在VO生成的同时分段调用，
+// 内存只与树高和一个不完整的条目有关；结果子图的边通过onEdge交给调用者
+class VOStreamVerifier
+{
+    private:
+        std::function<void(const VertexID&, const VertexID&)> onEdge;
+        std::vector<SHA256_CTX> levels; // 每个还没有闭合的'['一层
+        std::string pending; // 还不完整的条目
+        unsigned char rootDigest[SHA256_DIGEST_LENGTH];
+        bool finished;
+
+        size_t consume(const unsigned char* data, size_t length); // 处理一个完整的条目，返回其字节数，不完整时返回0
+        void addVertex(const std::string& payload, VOEntry::DataType type);
+
+    public:
+        VOStreamVerifier(std::function<void(const VertexID&, const VertexID&)> _onEdge = nullptr);
+
+        void feed(const char* data, size_t length); // 格式错误时抛出异常
+        bool isFinished() const; // 最外层的']'已经到达
+        void getDigest(unsigned char* _digest) const; // 重新计算出的根摘要，需要isFinished
+};
@@ -0,0 +1,188 @@
+#include "graph/adjacencyPool.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+
+const uint AdjacencyPool::SMALL_CLASS_NUM;
+const uint AdjacencyPool::CLASS_NUM;
+const size_t AdjacencyPool::MAX_SLOT_SIZE;
+const size_t AdjacencyPool::SLOT_ALIGN;
+
+AdjacencyPool::AdjacencyPool() : compacting(false), reservedBytes(0)
+{
+    for(uint i = 0; i < CLASS_NUM; i++)
+    {
+        freeSlots[i] = nullptr;
+        currentChunks[i] = nullptr;
+    }
+}
+
+AdjacencyPool::~AdjacencyPool()
+{
+    for(Chunk* chunk : chunks)
+    {
+        std::free(chunk);
+    }
+    for(Chunk* chunk : retiredChunks)
+    {
+        std::free(chunk);
+    }
+}
+
+uint AdjacencyPool::sizeClassOf(size_t bytes)
+{
+    if(bytes <= 16 * SMALL_CLASS_NUM)
+    {
+        return bytes == 0 ? 0 : (bytes - 1) / 16;
+    }
+    uint sizeClass = SMALL_CLASS_NUM;
+    for(size_t size = 512; size < bytes; size <<= 1)
+    {
+        sizeClass++;
+    }
+    return sizeClass;
+}
+
+size_t AdjacencyPool::slotSizeOf(uint sizeClass)
+{
+    if(sizeClass < SMALL_CLASS_NUM)
+    {
+        return 16 * (sizeClass + 1);
+    }
+    return (size_t)512 << (sizeClass - SMALL_CLASS_NUM);
+}
+
+AdjacencyPool::Chunk* AdjacencyPool::chunkOf(void* p)
+{
+    return reinterpret_cast<Chunk*>(reinterpret_cast<uintptr_t>(p) & ~(uintptr_t)(ADJACENCY_CHUNK_SIZE - 1));
+}
+
+AdjacencyPool::Chunk* AdjacencyPool::newChunk(uint sizeClass)
+{
+    void* memory = nullptr;
+    if(posix_memalign(&memory, ADJACENCY_CHUNK_SIZE, ADJACENCY_CHUNK_SIZE) != 0)
+    {
+        std::cerr << "Error: AdjacencyPool cannot allocate a chunk" << std::endl;
+        throw std::bad_alloc();
+    }
+    Chunk* chunk = static_cast<Chunk*>(memory);
+    chunk->sizeClass = sizeClass;
+    chunk->liveNum = 0;
+    chunk->retired = false;
+    chunk->next = static_cast<char*>(memory) + (sizeof(Chunk) + SLOT_ALIGN - 1) / SLOT_ALIGN * SLOT_ALIGN;
+    chunks.push_back(chunk);
+    reservedBytes += ADJACENCY_CHUNK_SIZE;
+    return chunk;
+}
+
+void AdjacencyPool::freeChunk(Chunk* chunk)
+{
+    reservedBytes -= ADJACENCY_CHUNK_SIZE;
+    std::free(chunk);
+}
+
+void* AdjacencyPool::allocate(size_t bytes)
+{
+    if(bytes > MAX_SLOT_SIZE)
+    {
+        void* p = ::operator new(bytes);
+        std::lock_guard<std::mutex> lock(mtx);
+        reservedBytes += bytes;
+        return p;
+    }
+    uint sizeClass = sizeClassOf(bytes);
+    size_t slotSize = slotSizeOf(sizeClass);
+    std::lock_guard<std::mutex> lock(mtx);
+    FreeSlot* slot = freeSlots[sizeClass];
+    if(slot != nullptr)
+    {
+        freeSlots[sizeClass] = slot->next;
+        chunkOf(slot)->liveNum++;
+        return slot;
+    }
+    Chunk* chunk = currentChunks[sizeClass];
+    if(chunk == nullptr || chunk->next + slotSize > reinterpret_cast<char*>(chunk) + ADJACENCY_CHUNK_SIZE)
+    {
+        chunk = newChunk(sizeClass);
+        currentChunks[sizeClass] = chunk;
+    }
+    void* p = chunk->next;
+    chunk->next += slotSize;
+    chunk->liveNum++;
+    return p;
+}
+
+void AdjacencyPool::deallocate(void* p, size_t bytes)
+{
+    if(p == nullptr)
+    {
+        return ;
+    }
+    if(bytes > MAX_SLOT_SIZE)
+    {
+        ::operator delete(p);
+        std::lock_guard<std::mutex> lock(mtx);
+        reservedBytes -= bytes;
+        return ;
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    Chunk* chunk = chunkOf(p);
+    chunk->liveNum--;
+    if(chunk->retired)
+    {
+        // 退役块的槽位不再复用；压缩期间用空的块留给endCompaction统一释放
+        if(chunk->liveNum == 0 && !compacting)
+        {
+            freeChunk(chunk);
+        }
+        return ;
+    }
+    FreeSlot* slot = static_cast<FreeSlot*>(p);
+    slot->next = freeSlots[chunk->sizeClass];
+    freeSlots[chunk->sizeClass] = slot;
+}
+
+void AdjacencyPool::beginCompaction()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if(compacting)
+    {
+        std::cerr << "Error: AdjacencyPool compaction has already begun" << std::endl;
+        throw std::runtime_error("Error: nested AdjacencyPool compaction");
+    }
+    compacting = true;
+    for(Chunk* chunk : chunks)
+    {
+        chunk->retired = true;
+    }
+    retiredChunks.swap(chunks);
+    chunks.clear();
+    for(uint i = 0; i < CLASS_NUM; i++)
+    {
+        freeSlots[i] = nullptr;
+        currentChunks[i] = nullptr;
+    }
+}
+
+void AdjacencyPool::endCompaction()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    for(Chunk* chunk : retiredChunks)
+    {
+        if(chunk->liveNum == 0)
+        {
+            freeChunk(chunk);
+        }
+    }
+    retiredChunks.clear();
+    compacting = false;
+}
+
+size_t AdjacencyPool::getReservedBytes()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return reservedBytes;
+}
@@ -1,10 +1,13 @@
 #include "graph/graph.h"
 #include "graph/vertex.h"
+#include "util/edgeReader.h"
 
-Graph::Graph()
+Graph::Graph() : pool(new AdjacencyPool()), nodes(std::less<VertexID>(), PoolAllocator<std::pair<const VertexID, Vertex>>(pool.get()))
 {
     vertex_num = 0;
     edge_num = 0;
+    compressedAdjacency = false;
+    vertexOrder = ID_ORDER;
 }
 
 Graph::~Graph(){}
@@ -59,7 +62,7 @@ VertexID Graph::getMinDegreeVertexID()
 uint Graph::getMinDegreeWithtraversal()
 {
     uint minDegree = std::numeric_limits<uint>::max();
-    for(const std::pair<uint, Vertex>& nodepair : nodes)
+    for(const std::pair<const VertexID, Vertex>& nodepair : nodes)
     {
         uint degree = nodepair.second.getDegree();
         if(degree < minDegree)
@@ -91,7 +94,7 @@ uint Graph::getVertexDegree(const VertexID& vid) const
     return nodes.at(vid).getDegree();
 }
 
-Vertex Graph::getVertex(const VertexID& vid) const
+const Vertex& Graph::getVertex(const VertexID& vid) const
 {
     if(!hasVertex(vid))
     {
@@ -101,7 +104,13 @@ Vertex Graph::getVertex(const VertexID& vid) const
     return nodes.at(vid);
 }
 
-const std::vector<VertexID>& Graph::getVertexNeighbors(const VertexID& vid) const
+const Vertex* Graph::findVertex(const VertexID& vid) const
+{
+    auto it = nodes.find(vid);
+    return it == nodes.end() ? nullptr : &it->second;
+}
+
+const NeighborList& Graph::getVertexNeighbors(const VertexID& vid) const
 {
     if(!hasVertex(vid))
     {
@@ -111,7 +120,7 @@ const std::vector<VertexID>& Graph::getVertexNeighbors(const VertexID& vid) cons
     return nodes.at(vid).getNeighbors();
 }
 
-std::array<unsigned char, SHA256_DIGEST_LENGTH> Graph::getVertexDigest(const VertexID& vid) const
+const unsigned char* Graph::getVertexDigest(const VertexID& vid) const
 {
     if(!hasVertex(vid))
     {
@@ -121,7 +130,7 @@ std::array<unsigned char, SHA256_DIGEST_LENGTH> Graph::getVertexDigest(const Ver
     return nodes.at(vid).getDigest();
 }
 
-const std::map<uint, Vertex>& Graph::getNodes() const
+const VertexMap& Graph::getNodes() const
 {
     return nodes;
 }
@@ -131,30 +140,25 @@ bool Graph::hasVertex(const VertexID& vid) const
     return nodes.find(vid) != nodes.end();
 }
 
-void Graph::loadGraphfromFile(const std::string& filename)
+bool Graph::hasEdge(const VertexID& src, const VertexID& dst) const
 {
-    std::ifstream file(filename);
-    if(!file.is_open())
-    {
-        std::cerr << "Error: Cannot open file " << filename << std::endl;
-        throw std::runtime_error("Cannot open file " + filename);
-    }
+    auto it = nodes.find(src);
+    return it != nodes.end() && it->second.hasNeighbor(dst);
+}
 
-    std::string line;
-    while(std::getline(file, line))
+void Graph::loadGraphfromFile(const std::string& filename)
+{
+    // 与更新文件一样用EdgeReader读取，初始图也可以使用二进制格式
+    EdgeReader reader(filename);
+    std::vector<std::pair<VertexID, VertexID>> edges;
+    while(!reader.isEndOfFile())
     {
-        std::istringstream iss(line);
-        VertexID src, dst;
-        
-        if(!(iss >> src >> dst))
+        reader.readNextEdges(1 << 16, edges);
+        for(const std::pair<VertexID, VertexID>& edge : edges)
         {
-            std::cerr<<"Error: Invalid input forma: "<<line<<std::endl;
-            throw std::runtime_error("Invalid input format in file " + filename);
+            addEdge(edge.first, edge.second, false, false);
         }
-
-        addEdge(src, dst, false, false);
     }
-    file.close();
 
     std::cout << "Graph : Graph has been loaded from file " << filename << std::endl;
 
@@ -175,14 +179,14 @@ void Graph::writeGraphtoFile(const std::string& filename)
 
 void Graph::addVertex(const VertexID& vid, bool updateIndex, bool computeVDigest)
 {
-    if(!hasVertex(vid))
+    bool added;
+    Vertex& vertex = findOrAddVertex(vid, added);
+    if(added)
     {
-        nodes[vid] = Vertex(vid);
         if(computeVDigest == true)
         {
-            nodes[vid].digestCompute();
+            vertex.digestCompute();
         }
-        ++vertex_num;
 
         if(updateIndex)
         {
@@ -191,6 +195,38 @@ void Graph::addVertex(const VertexID& vid, bool updateIndex, bool computeVDigest
     }
 }
 
+Vertex& Graph::findOrAddVertex(const VertexID& vid, bool& added)
+{
+    auto it = nodes.lower_bound(vid);
+    added = it == nodes.end() || it->first != vid;
+    if(added)
+    {
+        it = nodes.emplace_hint(it, vid, Vertex(vid, pool.get()));
+        if(compressedAdjacency)
+        {
+            it->second.setPackedNeighbors(true);
+        }
+        ++vertex_num;
+    }
+    return it->second;
+}
+
+void Graph::restoreVertex(const VertexID& vid, const VertexID* first, const VertexID* last, const unsigned char* digest)
+{
+    if(!nodes.empty() && nodes.rbegin()->first >= vid)
+    {
+        std::cerr << "Graph Error: restored vertex " << vid << " is not in ascending order" << std::endl;
+        throw std::runtime_error("Graph Error: restored vertices must be in ascending order");
+    }
+    Vertex& vertex = nodes.emplace_hint(nodes.end(), vid, Vertex(vid, first, last, digest, pool.get()))->second;
+    if(compressedAdjacency)
+    {
+        vertex.setPackedNeighbors(true);
+    }
+    ++vertex_num;
+    edge_num += last - std::upper_bound(first, last, vid); // 每条边只在编号较小的端点计数一次
+}
+
 void Graph::removeVertex(const VertexID& vid, bool updateIndex, bool computeVDigest)
 {
     if(hasVertex(vid))
@@ -200,8 +236,8 @@ void Graph::removeVertex(const VertexID& vid, bool updateIndex, bool computeVDig
             updateInvertedIndexADV(vid);
         }
 
-        std::vector<VertexID> neighbors = nodes.at(vid).getNeighbors();
-        for(const VertexID& neighbor : neighbors)
+        // 只修改邻居的邻居表，vid自己的邻居表在erase之前保持不变，可以直接遍历
+        for(const VertexID& neighbor : nodes.at(vid).getNeighbors())
         {
             nodes.at(neighbor).removeNeighbor(vid);
             if(computeVDigest == true)
@@ -218,18 +254,18 @@ void Graph::removeVertex(const VertexID& vid, bool updateIndex, bool computeVDig
 
 void Graph::addEdge(const VertexID& src, const VertexID& dst, bool updateIndex, bool computeVDigest)
 {
-    // 会检查src和dst是否存在，不存在则会自动添加
-    addVertex(src, false, false);
-    addVertex(dst, false, false);
-    
-    if(!nodes.at(src).hasNeighbor(dst))
+    // 会检查src和dst是否存在，不存在则会自动添加；map的元素引用在插入其他节点后仍然有效，每个端点只查找一次
+    bool added;
+    Vertex& srcVertex = findOrAddVertex(src, added);
+    Vertex& dstVertex = findOrAddVertex(dst, added);
+    if(!srcVertex.hasNeighbor(dst))
     {
-        nodes.at(src).addNeighbor(dst);
-        nodes.at(dst).addNeighbor(src);
+        srcVertex.addNeighbor(dst);
+        dstVertex.addNeighbor(src);
         if(computeVDigest == true)
         {
-            nodes.at(src).digestCompute();
-            nodes.at(dst).digestCompute();
+            srcVertex.digestCompute();
+            dstVertex.digestCompute();
         }
         ++edge_num;
 
@@ -266,7 +302,7 @@ void Graph::removeEdge(const VertexID& src, const VertexID& dst, bool updateInde
 void Graph::buildInvertedIndex()
 {
     invertedIndex.clear();
-    for(const std::pair<uint, Vertex>& nodepair : nodes)
+    for(const std::pair<const VertexID, Vertex>& nodepair : nodes)
     {
         uint degree = nodepair.second.getDegree();
         invertedIndex[degree].push_back(nodepair.second.getVid());
@@ -275,10 +311,7 @@ void Graph::buildInvertedIndex()
 
 void Graph::updateInvertedIndexADV(const VertexID& vid)
 {
-    Vertex node = nodes.at(vid);
-    uint degree = node.getDegree();
-    std::vector<VertexID> neighbors = node.getNeighbors();
-    for(const VertexID& neighbor : neighbors)
+    for(const VertexID& neighbor : nodes.at(vid).getNeighbors())
     {
         uint neighborDegree = nodes.at(neighbor).getDegree();
         invertedIndex[neighborDegree-1].push_back(neighbor);
@@ -301,6 +334,51 @@ void Graph::updateInvertedIndexAUE(const VertexID& src, const VertexID& dst)
     invertedIndex[dstDegree].push_back(dst);
 }
 
+void Graph::compactAdjacency()
+{
+    // 只退役这个图的内存块，其他图的节点表和邻居表不受影响
+    pool->beginCompaction();
+    {
+        // 按编号顺序逐个复制，复制出的邻居表容量与大小相同，相邻编号的节点落在相邻的内存中
+        VertexMap compacted(nodes.key_comp(), nodes.get_allocator());
+        for(const std::pair<const VertexID, Vertex>& nodepair : nodes)
+        {
+            compacted.emplace_hint(compacted.end(), nodepair.first, nodepair.second);
+        }
+        nodes.swap(compacted);
+    }
+    pool->endCompaction();
+}
+
+void Graph::setCompressedAdjacency(bool enable)
+{
+    compressedAdjacency = enable;
+    for(std::pair<const VertexID, Vertex>& nodepair : nodes)
+    {
+        nodepair.second.setPackedNeighbors(enable);
+    }
+}
+
+bool Graph::isCompressedAdjacency() const
+{
+    return compressedAdjacency;
+}
+
+size_t Graph::getAdjacencyBytes() const
+{
+    size_t bytes = 0;
+    for(const std::pair<const VertexID, Vertex>& nodepair : nodes)
+    {
+        bytes += nodepair.second.getNeighbors().getMemoryBytes();
+    }
+    return bytes;
+}
+
+size_t Graph::getReservedBytes() const
+{
+    return pool->getReservedBytes();
+}
+
 void Graph::computeVertexDigest()
 {
     for(auto& node : nodes)
@@ -309,20 +387,110 @@ void Graph::computeVertexDigest()
     }
 }
 
+void Graph::computeVertexDigest(const VertexID& vid)
+{
+    if(!hasVertex(vid))
+    {
+        std::cerr << "Error: Vertex " << vid << " does not exist!" << std::endl;
+        throw std::runtime_error("Vertex " + std::to_string(vid) + " does not exist!");
+    }
+    nodes.at(vid).digestCompute();
+}
+
+void Graph::setVertexOrder(VertexOrder order)
+{
+    vertexOrder = order;
+}
+
 std::vector<VertexID> Graph::convertToLocalID() const
 {
     std::vector<VertexID> local2global(vertex_num);
 
     VertexID localIndex = 0;
 
-    for(const std::pair<VertexID, Vertex>& nodePair : nodes)
+    for(const std::pair<const VertexID, Vertex>& nodePair : nodes)
     {
         local2global[localIndex] = nodePair.first;
         localIndex++;
     }
+    if(vertexOrder == DEGREE_ORDER)
+    {
+        std::vector<std::pair<uint, VertexID>> byDegree;
+        byDegree.reserve(vertex_num);
+        for(const std::pair<const VertexID, Vertex>& nodePair : nodes)
+        {
+            byDegree.emplace_back(UINT_MAX - nodePair.second.getDegree(), nodePair.first);
+        }
+        std::sort(byDegree.begin(), byDegree.end()); // 度数降序，相同度数按编号升序
+        for(size_t i = 0; i < byDegree.size(); i++)
+        {
+            local2global[i] = byDegree[i].second;
+        }
+    }
+    else if(vertexOrder == RCM_ORDER)
+    {
+        std::vector<VertexID> vids;
+        vids.swap(local2global);
+        rcmOrder(vids, local2global);
+    }
     return local2global;
 }
 
+void Graph::rcmOrder(const std::vector<VertexID>& vids, std::vector<VertexID>& local2global) const
+{
+    // vids按编号升序，邻居换成vids中的下标
+    uint n = vids.size();
+    std::unordered_map<VertexID, uint> indexOf;
+    indexOf.reserve(n);
+    std::vector<const Vertex*> vertices(n);
+    std::vector<uint> degree(n);
+    std::vector<uint> starts(n);
+    VertexMap::const_iterator it = nodes.begin();
+    for(uint i = 0; i < n; i++, ++it)
+    {
+        indexOf.emplace(vids[i], i);
+        vertices[i] = &it->second;
+        degree[i] = it->second.getDegree();
+        starts[i] = i;
+    }
+    std::stable_sort(starts.begin(), starts.end(), [&degree](uint a, uint b){return degree[a] < degree[b];});
+
+    // 每个连通分量从度数最小的未访问节点开始BFS，同一节点的邻居按度数升序入队，最后整体反转
+    std::vector<uint> order;
+    order.reserve(n);
+    std::vector<bool> visited(n, false);
+    std::vector<uint> frontier;
+    for(uint start : starts)
+    {
+        if(visited[start])
+        {
+            continue;
+        }
+        visited[start] = true;
+        order.emplace_back(start);
+        for(size_t head = order.size() - 1; head < order.size(); head++)
+        {
+            frontier.clear();
+            for(const VertexID& neighbor : vertices[order[head]]->getNeighbors())
+            {
+                uint w = indexOf.find(neighbor)->second;
+                if(!visited[w])
+                {
+                    visited[w] = true;
+                    frontier.emplace_back(w);
+                }
+            }
+            std::stable_sort(frontier.begin(), frontier.end(), [&degree](uint a, uint b){return degree[a] < degree[b];});
+            order.insert(order.end(), frontier.begin(), frontier.end());
+        }
+    }
+    local2global.resize(n);
+    for(uint i = 0; i < n; i++)
+    {
+        local2global[i] = vids[order[n - 1 - i]];
+    }
+}
+
 void Graph::printGraphInfo(int verboseNodeNum) const
 {
     std::cout << "Graph Information:" << std::endl;
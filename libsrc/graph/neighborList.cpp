@@ -0,0 +1,426 @@
+#include "graph/neighborList.h"
+
+#include <algorithm>
+
+NeighborList::NeighborList(AdjacencyPool* pool) : flat(PoolAllocator<VertexID>(pool)), blocks(PoolAllocator<Block>(pool)), packed(nullptr), count(0), packable(false) {}
+
+NeighborList::NeighborList(const VertexID* first, const VertexID* last, AdjacencyPool* pool)
+    : flat(first, last, PoolAllocator<VertexID>(pool)), blocks(PoolAllocator<Block>(pool)), packed(nullptr), count(last - first), packable(false)
+{
+    if(count > HUB_DEGREE_THRESHOLD)
+    {
+        toBlocks();
+    }
+}
+
+NeighborList::NeighborList(const NeighborList& other) : flat(other.flat), blocks(other.blocks), packed(nullptr), count(other.count), packable(other.packable)
+{
+    if(other.packed != nullptr)
+    {
+        packed = new Packed(*other.packed);
+    }
+}
+
+NeighborList::NeighborList(NeighborList&& other) : flat(std::move(other.flat)), blocks(std::move(other.blocks)), packed(other.packed), count(other.count), packable(other.packable)
+{
+    other.packed = nullptr;
+    other.count = 0;
+}
+
+NeighborList& NeighborList::operator=(NeighborList other)
+{
+    flat.swap(other.flat);
+    blocks.swap(other.blocks);
+    std::swap(packed, other.packed);
+    std::swap(count, other.count);
+    std::swap(packable, other.packable);
+    return *this;
+}
+
+NeighborList::~NeighborList()
+{
+    delete packed;
+}
+
+VertexID NeighborList::back() const
+{
+    if(packed != nullptr)
+    {
+        return packedBlockBack(packed->index.size() - 1);
+    }
+    return blocks.empty() ? flat.back() : blocks.back().back();
+}
+
+size_t NeighborList::getMemoryBytes() const
+{
+    if(packed != nullptr)
+    {
+        return sizeof(Packed) + packed->bytes.capacity() + packed->index.capacity() * sizeof(PackedBlock);
+    }
+    size_t bytes = flat.capacity() * sizeof(VertexID) + blocks.capacity() * sizeof(Block);
+    for(const Block& block : blocks)
+    {
+        bytes += block.capacity() * sizeof(VertexID);
+    }
+    return bytes;
+}
+
+void NeighborList::setPackable(bool enable)
+{
+    packable = enable;
+    if(enable && packed == nullptr)
+    {
+        if(!blocks.empty())
+        {
+            toFlat();
+        }
+        if(count >= PACKED_MIN_DEGREE)
+        {
+            pack();
+        }
+    }
+    else if(!enable && packed != nullptr)
+    {
+        unpack();
+        if(count > HUB_DEGREE_THRESHOLD)
+        {
+            toBlocks();
+        }
+    }
+}
+
+void NeighborList::encodeDelta(VertexID delta, Bytes& out)
+{
+    while(delta >= 0x80)
+    {
+        out.push_back((unsigned char)(delta | 0x80));
+        delta >>= 7;
+    }
+    out.push_back((unsigned char)delta);
+}
+
+void NeighborList::pack()
+{
+    packed = new Packed(flat.get_allocator());
+    repack(0, 0, flat.data(), flat.data() + flat.size());
+    Block(flat.get_allocator()).swap(flat);
+}
+
+void NeighborList::unpack()
+{
+    flat.reserve(count);
+    const unsigned char* cur = packed->bytes.data();
+    const unsigned char* end = cur + packed->bytes.size();
+    VertexID value = 0;
+    while(cur < end)
+    {
+        value += decodeDelta(cur);
+        flat.push_back(value);
+    }
+    delete packed;
+    packed = nullptr;
+}
+
+size_t NeighborList::findPackedBlock(VertexID vid) const
+{
+    const std::vector<PackedBlock, PoolAllocator<PackedBlock>>& index = packed->index;
+    size_t low = 0, high = index.size();
+    while(high - low > 1)
+    {
+        size_t mid = (low + high) / 2;
+        if(index[mid].first <= vid)
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+void NeighborList::decodePackedBlock(size_t index, std::vector<VertexID>& out) const
+{
+    const PackedBlock& block = packed->index[index];
+    const unsigned char* cur = packed->bytes.data() + block.offset;
+    decodeDelta(cur); // 块首与前一块末尾之差，块首直接取索引中的值
+    VertexID value = block.first;
+    out.push_back(value);
+    for(uint i = 1; i < block.count; i++)
+    {
+        value += decodeDelta(cur);
+        out.push_back(value);
+    }
+}
+
+VertexID NeighborList::packedBlockBack(size_t index) const
+{
+    const PackedBlock& block = packed->index[index];
+    const unsigned char* cur = packed->bytes.data() + block.offset;
+    decodeDelta(cur);
+    VertexID value = block.first;
+    for(uint i = 1; i < block.count; i++)
+    {
+        value += decodeDelta(cur);
+    }
+    return value;
+}
+
+void NeighborList::repack(size_t begin, size_t end, const VertexID* first, const VertexID* last)
+{
+    Bytes& bytes = packed->bytes;
+    std::vector<PackedBlock, PoolAllocator<PackedBlock>>& index = packed->index;
+    VertexID prev = begin > 0 ? packedBlockBack(begin - 1) : 0;
+    size_t byteBegin = begin < index.size() ? index[begin].offset : bytes.size();
+    size_t byteEnd = bytes.size();
+    if(end < index.size())
+    {
+        // 后一块的块首差分依赖这一段的末尾，一起重新编码
+        const unsigned char* cur = bytes.data() + index[end].offset;
+        decodeDelta(cur);
+        byteEnd = cur - bytes.data();
+    }
+
+    Bytes encoded;
+    std::vector<PackedBlock> blockEntries;
+    size_t valueNum = last - first;
+    size_t blockNum = valueNum > 2 * PACKED_BLOCK_SIZE ? (valueNum + PACKED_BLOCK_SIZE - 1) / PACKED_BLOCK_SIZE : 1;
+    size_t blockSize = (valueNum + blockNum - 1) / blockNum;
+    for(size_t i = 0; i < valueNum; i++)
+    {
+        if(i % blockSize == 0)
+        {
+            blockEntries.push_back(PackedBlock{first[i], (uint)(byteBegin + encoded.size()), (uint)std::min(blockSize, valueNum - i)});
+        }
+        encodeDelta(first[i] - prev, encoded);
+        prev = first[i];
+    }
+    size_t nextOffset = byteBegin + encoded.size();
+    if(end < index.size())
+    {
+        encodeDelta(index[end].first - prev, encoded);
+    }
+
+    size_t oldLength = byteEnd - byteBegin;
+    if(encoded.size() > oldLength)
+    {
+        bytes.insert(bytes.begin() + byteEnd, encoded.size() - oldLength, 0);
+    }
+    else
+    {
+        bytes.erase(bytes.begin() + byteBegin + encoded.size(), bytes.begin() + byteEnd);
+    }
+    std::copy(encoded.begin(), encoded.end(), bytes.begin() + byteBegin);
+    for(size_t i = end; i < index.size(); i++)
+    {
+        index[i].offset += encoded.size() - oldLength;
+    }
+    if(end < index.size())
+    {
+        index[end].offset = nextOffset; // 后一块的块首差分长度可能改变
+    }
+    index.erase(index.begin() + begin, index.begin() + end);
+    index.insert(index.begin() + begin, blockEntries.begin(), blockEntries.end());
+}
+
+size_t NeighborList::findBlock(VertexID vid) const
+{
+    size_t low = 0, high = blocks.size() - 1;
+    while(low < high)
+    {
+        size_t mid = (low + high) / 2;
+        if(blocks[mid].back() < vid)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+void NeighborList::splitBlock(size_t index)
+{
+    Block& block = blocks[index];
+    Block upper(block.begin() + block.size() / 2, block.end(), block.get_allocator());
+    block.resize(block.size() / 2);
+    blocks.insert(blocks.begin() + index + 1, std::move(upper));
+}
+
+void NeighborList::mergeBlock(size_t index)
+{
+    if(blocks.size() < 2)
+    {
+        return ;
+    }
+    size_t left = index + 1 < blocks.size() ? index : index - 1;
+    Block& block = blocks[left];
+    block.insert(block.end(), blocks[left + 1].begin(), blocks[left + 1].end());
+    blocks.erase(blocks.begin() + left + 1);
+    if(block.size() > 2 * NEIGHBOR_BLOCK_SIZE)
+    {
+        splitBlock(left);
+    }
+}
+
+void NeighborList::toBlocks()
+{
+    blocks.reserve((flat.size() + NEIGHBOR_BLOCK_SIZE - 1) / NEIGHBOR_BLOCK_SIZE);
+    for(size_t i = 0; i < flat.size(); i += NEIGHBOR_BLOCK_SIZE)
+    {
+        blocks.emplace_back(flat.begin() + i, flat.begin() + std::min(flat.size(), i + NEIGHBOR_BLOCK_SIZE), flat.get_allocator());
+    }
+    Block(flat.get_allocator()).swap(flat);
+}
+
+void NeighborList::toFlat()
+{
+    flat.reserve(count);
+    for(const Block& block : blocks)
+    {
+        flat.insert(flat.end(), block.begin(), block.end());
+    }
+    decltype(blocks)(blocks.get_allocator()).swap(blocks);
+}
+
+bool NeighborList::contains(VertexID vid) const
+{
+    if(packed != nullptr)
+    {
+        const PackedBlock& block = packed->index[findPackedBlock(vid)];
+        const unsigned char* cur = packed->bytes.data() + block.offset;
+        decodeDelta(cur);
+        VertexID value = block.first;
+        for(uint i = 1; i < block.count && value < vid; i++)
+        {
+            value += decodeDelta(cur);
+        }
+        return value == vid;
+    }
+    if(blocks.empty())
+    {
+        return std::binary_search(flat.begin(), flat.end(), vid);
+    }
+    const Block& block = blocks[findBlock(vid)];
+    return std::binary_search(block.begin(), block.end(), vid);
+}
+
+bool NeighborList::insert(VertexID vid)
+{
+    if(packed != nullptr)
+    {
+        size_t index = findPackedBlock(vid);
+        std::vector<VertexID> values;
+        values.reserve(2 * PACKED_BLOCK_SIZE + 1);
+        decodePackedBlock(index, values);
+        auto it = std::lower_bound(values.begin(), values.end(), vid);
+        if(it != values.end() && *it == vid)
+        {
+            return false;
+        }
+        values.insert(it, vid);
+        repack(index, index + 1, values.data(), values.data() + values.size());
+        count++;
+        return true;
+    }
+    if(blocks.empty())
+    {
+        auto it = std::lower_bound(flat.begin(), flat.end(), vid);
+        if(it != flat.end() && *it == vid)
+        {
+            return false;
+        }
+        flat.insert(it, vid);
+        ++count;
+        if(packable && count >= PACKED_MIN_DEGREE)
+        {
+            pack();
+        }
+        else if(!packable && count > HUB_DEGREE_THRESHOLD)
+        {
+            toBlocks();
+        }
+        return true;
+    }
+
+    size_t index = findBlock(vid);
+    Block& block = blocks[index];
+    auto it = std::lower_bound(block.begin(), block.end(), vid);
+    if(it != block.end() && *it == vid)
+    {
+        return false;
+    }
+    block.insert(it, vid);
+    count++;
+    if(block.size() > 2 * NEIGHBOR_BLOCK_SIZE)
+    {
+        splitBlock(index);
+    }
+    return true;
+}
+
+bool NeighborList::erase(VertexID vid)
+{
+    if(packed != nullptr && count <= PACKED_MIN_DEGREE / 2)
+    {
+        unpack(); // 删除后度数太小，压缩节省不了多少
+    }
+    if(packed != nullptr)
+    {
+        size_t index = findPackedBlock(vid);
+        std::vector<VertexID> values;
+        values.reserve(3 * PACKED_BLOCK_SIZE);
+        decodePackedBlock(index, values);
+        auto it = std::lower_bound(values.begin(), values.end(), vid);
+        if(it == values.end() || *it != vid)
+        {
+            return false;
+        }
+        values.erase(it);
+        size_t end = index + 1;
+        if(values.size() < PACKED_BLOCK_SIZE / 4 && end < packed->index.size())
+        {
+            decodePackedBlock(end++, values); // 过小的块与后一块合并
+        }
+        repack(index, end, values.data(), values.data() + values.size());
+        count--;
+        return true;
+    }
+    if(blocks.empty())
+    {
+        auto it = std::lower_bound(flat.begin(), flat.end(), vid);
+        if(it == flat.end() || *it != vid)
+        {
+            return false;
+        }
+        flat.erase(it);
+        count--;
+        return true;
+    }
+
+    size_t index = findBlock(vid);
+    Block& block = blocks[index];
+    auto it = std::lower_bound(block.begin(), block.end(), vid);
+    if(it == block.end() || *it != vid)
+    {
+        return false;
+    }
+    block.erase(it);
+    count--;
+    if(count < HUB_DEGREE_THRESHOLD / 2)
+    {
+        toFlat();
+    }
+    else if(block.empty())
+    {
+        blocks.erase(blocks.begin() + index);
+    }
+    else if(block.size() < NEIGHBOR_BLOCK_SIZE / 4)
+    {
+        mergeBlock(index);
+    }
+    return true;
+}
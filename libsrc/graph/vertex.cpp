@@ -5,16 +5,20 @@ Vertex::Vertex() : id(0), degree(0)
     memset(digest, 0, SHA256_DIGEST_LENGTH);
 }
 
-Vertex::Vertex(VertexID vid) : id(vid), degree(0) 
+Vertex::Vertex(VertexID vid, AdjacencyPool* pool) : id(vid), degree(0), neighbors(pool)
 {
     memset(digest, 0, SHA256_DIGEST_LENGTH);
 }
 
-Vertex::Vertex(const Vertex& other)
+Vertex::Vertex(VertexID vid, const VertexID* first, const VertexID* last, const unsigned char* _digest, AdjacencyPool* pool) : id(vid), degree(last - first), neighbors(first, last, pool)
+{
+    std::memcpy(digest, _digest, SHA256_DIGEST_LENGTH);
+}
+
+Vertex::Vertex(const Vertex& other) : neighbors(other.neighbors) // 复制出的邻居表与原节点使用同一个池
 {
     id = other.id;
     degree = other.degree;
-    neighbors = other.neighbors;
     std::memcpy(digest, other.digest, SHA256_DIGEST_LENGTH);
 }
 
@@ -30,47 +34,43 @@ uint Vertex::getDegree() const
     return degree;
 }
 
-std::array<unsigned char, SHA256_DIGEST_LENGTH> Vertex::getDigest() const
+const unsigned char* Vertex::getDigest() const
 {
-    std::array<unsigned char, SHA256_DIGEST_LENGTH> result;
-    std::copy(digest, digest + SHA256_DIGEST_LENGTH, result.begin());
-    return result;
+    return digest;
 }
 
-const std::vector<VertexID>& Vertex::getNeighbors() const
+const NeighborList& Vertex::getNeighbors() const
 {
     return neighbors;
 }
 
 bool Vertex::hasNeighbor(VertexID neighbor_vid) const
 {
-    return std::binary_search(neighbors.begin(), neighbors.end(), neighbor_vid);
+    return neighbors.contains(neighbor_vid);
 }
 
 void Vertex::addNeighbor(VertexID neighbor_vid)
 {
-    auto it = std::lower_bound(neighbors.begin(), neighbors.end(), neighbor_vid);
-    
     // 如果 neighbor_vid 已存在，则不插入
-    if(it != neighbors.end() && *it == neighbor_vid)
+    if(neighbors.insert(neighbor_vid))
     {
-        return ;
+        degree++;
     }
-
-    neighbors.insert(it, neighbor_vid);
-    degree++;
 }
 
 void Vertex::removeNeighbor(VertexID neighbor_vid)
 {
-    auto it = std::lower_bound(neighbors.begin(), neighbors.end(), neighbor_vid);
-    if(it != neighbors.end())
+    if(neighbors.erase(neighbor_vid))
     {
-        neighbors.erase(it);
         degree--;
     }
 }
 
+void Vertex::setPackedNeighbors(bool enable)
+{
+    neighbors.setPackable(enable);
+}
+
 void Vertex::digestCompute()
 {
     std::ostringstream oss;
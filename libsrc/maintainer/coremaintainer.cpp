@@ -19,6 +19,11 @@ uint CoreMaintainer::getCore(const VertexID& vid) const
     return it->second;
 }
 
+uint CoreMaintainer::getVersion() const
+{
+    return version;
+}
+
 OSTree& CoreMaintainer::getOSTree(uint k)
 {
     if(ostrees.find(k) == ostrees.end())
@@ -39,7 +44,102 @@ const std::unordered_map<VertexID, uint>& CoreMaintainer::getCoresSet() const
     return cores;
 }
 
-void CoreMaintainer::insertToOrderk(const std::vector<VertexID>& vert, const std::vector<VertexID> local2global, uint startPos, uint endPos, uint k)
+void CoreMaintainer::attachShellTree(ShellTree* tree)
+{
+    shellTree = tree;
+}
+
+void CoreMaintainer::takeChangedVertices(std::vector<VertexID>& changed)
+{
+    changed.insert(changed.end(), changedVertices.begin(), changedVertices.end());
+    changedVertices.clear();
+}
+
+void CoreMaintainer::takeDetachedVertices(std::vector<VertexID>& detached)
+{
+    detached.insert(detached.end(), detachedVertices.begin(), detachedVertices.end());
+    detachedVertices.clear();
+}
+
+void CoreMaintainer::exportState(const std::vector<VertexID>& vids, std::vector<uint>& mcdValues, std::vector<uint>& degPlusValues, std::vector<std::pair<uint, std::vector<VertexID>>>& korders) const
+{
+    mcdValues.assign(vids.size(), UINT_MAX);
+    degPlusValues.assign(vids.size(), UINT_MAX);
+    for(size_t i = 0; i < vids.size(); i++)
+    {
+        auto mcdIt = mcd.find(vids[i]);
+        if(mcdIt != mcd.end())
+        {
+            mcdValues[i] = mcdIt->second;
+        }
+        auto degPlusIt = degPlus.find(vids[i]);
+        if(degPlusIt != degPlus.end())
+        {
+            degPlusValues[i] = degPlusIt->second;
+        }
+    }
+    korders.clear();
+    korders.reserve(ostrees.size());
+    for(const std::pair<const uint, OSTree>& p : ostrees)
+    {
+        korders.emplace_back(p.first, p.second.getVids());
+    }
+    std::sort(korders.begin(), korders.end(), [](const std::pair<uint, std::vector<VertexID>>& a, const std::pair<uint, std::vector<VertexID>>& b)
+    {
+        return a.first < b.first;
+    });
+}
+
+void CoreMaintainer::restoreState(const std::vector<VertexID>& vids, const std::vector<uint>& coreValues, const std::vector<uint>& mcdValues, const std::vector<uint>& degPlusValues, const std::vector<std::pair<uint, std::vector<VertexID>>>& korders, uint _version)
+{
+    if(coreValues.size() != vids.size() || mcdValues.size() != vids.size() || degPlusValues.size() != vids.size())
+    {
+        std::cerr << "CoreMaintainer Error: restored state arrays have different lengths" << std::endl;
+        throw std::runtime_error("CoreMaintainer Error: inconsistent restored state");
+    }
+    cores.clear();
+    mcd.clear();
+    degPlus.clear();
+    ostrees.clear();
+    changedVertices.clear();
+    detachedVertices.clear();
+    cores.reserve(vids.size());
+    for(size_t i = 0; i < vids.size(); i++)
+    {
+        cores.emplace(vids[i], coreValues[i]);
+        if(mcdValues[i] != UINT_MAX)
+        {
+            mcd.emplace(vids[i], mcdValues[i]);
+        }
+        if(degPlusValues[i] != UINT_MAX)
+        {
+            degPlus.emplace(vids[i], degPlusValues[i]);
+        }
+    }
+    size_t orderedNum = 0;
+    for(const std::pair<uint, std::vector<VertexID>>& korder : korders)
+    {
+        for(const VertexID& vid : korder.second)
+        {
+            auto it = cores.find(vid);
+            if(it == cores.end() || it->second != korder.first)
+            {
+                std::cerr << "CoreMaintainer Error: vertex " << vid << " in the restored " << korder.first << "-order has a different core" << std::endl;
+                throw std::runtime_error("CoreMaintainer Error: inconsistent restored k-order");
+            }
+        }
+        ostrees[korder.first].buildTree(korder.second);
+        orderedNum += korder.second.size();
+    }
+    if(orderedNum != cores.size())
+    {
+        std::cerr << "CoreMaintainer Error: restored k-orders cover " << orderedNum << " of " << cores.size() << " vertices" << std::endl;
+        throw std::runtime_error("CoreMaintainer Error: inconsistent restored k-order");
+    }
+    version = _version;
+}
+
+void CoreMaintainer::insertToOrderk(const std::vector<VertexID>& vert, const std::vector<VertexID>& local2global, uint startPos, uint endPos, uint k)
 {
     if(startPos >= vert.size() || endPos > vert.size() || startPos > endPos)
     {
@@ -52,56 +152,51 @@ void CoreMaintainer::insertToOrderk(const std::vector<VertexID>& vert, const std
         return ;
     }
 
-    std::unordered_map<VertexID, uint>& _degPlus = degPlus;
-    std::vector<VertexID> orderVert(vert.begin() + startPos, vert.begin() + endPos); // 不包括索引为 endPos 的元素
-    std::unordered_set<VertexID> visited;
-    /* k-order序保持 */
-    for(uint i = 0; i < orderVert.size(); i++)
+    /* k-order序保持，分解顺序即为k-order，整段一次性建成平衡树 */
+    std::vector<VertexID> orderVert;
+    orderVert.reserve(endPos - startPos);
+    for(uint i = startPos; i < endPos; i++) // 不包括索引为 endPos 的元素
+    {
+        orderVert.emplace_back(local2global[vert[i]]);
+    }
+    ostrees[k].appendRange(orderVert);
+}
+
+void CoreMaintainer::initmcd(const std::vector<VertexID>& local2global, const std::vector<size_t>& offsets, const std::vector<uint>& adjacency, const std::vector<uint>& localCores)
+{
+    for(size_t localID = 0; localID < local2global.size(); localID++)
     {
-        if(visited.find(orderVert[i]) != visited.end())
+        uint count = 0;
+        for(size_t p = offsets[localID]; p < offsets[localID + 1]; p++)
         {
-            std::cout << "Waring : vertex " << orderVert[i] << " has been visited" << std::endl;
+            if(localCores[adjacency[p]] >= localCores[localID])
+            {
+                count++;
+            }
         }
-        visited.insert(orderVert[i]);
-        ostrees[k].insertBack(local2global[orderVert[i]]);
-        // orderkV[k].push_back(local2global[orderVert[i]]);
+        mcd[local2global[localID]] = count;
     }
-
-    // /* 小deg+优先 */
-    // for(uint i = 0; i < orderVert.size(); i++)
-    // {
-    //     ostrees[k].insertBack(local2global[orderVert[i]]);
-    // }
-
-    // std::sort(orderVert.begin(), orderVert.end(), [&_degPlus, &local2global](VertexID a, VertexID b){return _degPlus.at(local2global[a]) < _degPlus.at(local2global[b]);});
-
-    // for(uint i = 0; i < orderVert.size(); i++)
-    // {
-    //     orderkV[k].push_back(local2global[orderVert[i]]);
-    // }
 }
 
-void CoreMaintainer::initmcd(const Graph& graph, const std::vector<VertexID> local2global)
+void CoreMaintainer::initmcd(const std::vector<VertexID>& local2global, const std::vector<const Vertex*>& localVertices, const std::unordered_map<VertexID, VertexID>& global2local, const std::vector<uint>& localCores)
 {
-    uint vertexNum = graph.getVertexNum();
-    for(VertexID localID = 0; localID < vertexNum; localID++)
+    for(size_t localID = 0; localID < local2global.size(); localID++)
     {
-        VertexID vid = local2global[localID];
-        uint vCore = cores.at(vid);
-        mcd[vid] = 0;
-        for(const VertexID& neighbor : graph.getVertexNeighbors(vid))
+        uint count = 0;
+        for(const VertexID& neighbor : localVertices[localID]->getNeighbors())
         {
-            if(cores.at(neighbor) >= vCore)
+            if(localCores[global2local.find(neighbor)->second] >= localCores[localID])
             {
-                mcd[vid]++;
+                count++;
             }
         }
+        mcd[local2global[localID]] = count;
     }
 }
 
 void CoreMaintainer::initmcdTest(const Graph& graph)
 {
-    for(const std::pair<VertexID, Vertex>& p : graph.getNodes())
+    for(const std::pair<const VertexID, Vertex>& p : graph.getNodes())
     {
         VertexID vid = p.first;
         uint vCore = cores.at(vid);
@@ -118,6 +213,7 @@ void CoreMaintainer::initmcdTest(const Graph& graph)
 
 void CoreMaintainer::coresDecomp(const Graph& graph)
 {
+    ++version;
     uint vertexNum = graph.getVertexNum();
     std::unordered_map<VertexID, VertexID> global2local;
     std::vector<VertexID> local2global = graph.convertToLocalID();
@@ -132,6 +228,7 @@ void CoreMaintainer::coresDecomp(const Graph& graph)
     {
         cores.clear();
     }
+    changedVertices.clear(); // 所有节点都重新计算，由调用者整体重建
     if(!ostrees.empty())
     {
         ostrees.clear();
@@ -143,12 +240,40 @@ void CoreMaintainer::coresDecomp(const Graph& graph)
         global2local[local2global[localID]] = localID;
     }
 
-    // 第一步：计算每个节点的度数并找出最大度数 md
-    for(size_t localID = 0; localID < vertexNum; localID++)
+    // 第一步：计算每个节点的度数并找出最大度数 md，同时把邻接表换成局部编号的CSR，之后的剥离只访问数组。
+    // graph开启邻接压缩时不展开CSR（否则分解期间邻接表又以原值存放一份），剥离时直接解码各节点的邻居表。
+    // graph按编号顺序遍历，局部编号的顺序由graph的VertexOrder决定
+    bool packed = graph.isCompressedAdjacency();
+    std::vector<const Vertex*> localVertices(packed ? vertexNum : 0); // 压缩时局部编号对应的节点
+    for(const std::pair<const VertexID, Vertex>& nodePair : graph.getNodes())
     {
-        degree[localID] = graph.getVertexDegree(local2global[localID]);
+        VertexID localID = global2local[nodePair.first];
+        degree[localID] = nodePair.second.getDegree();
         degreeP[localID] = degree[localID];
         maxDegree = std::max(maxDegree, degree[localID]);
+        if(packed)
+        {
+            localVertices[localID] = &nodePair.second;
+        }
+    }
+    std::vector<size_t> offsets;
+    std::vector<uint> adjacency;
+    if(!packed)
+    {
+        offsets.assign(vertexNum + 1, 0);
+        for(size_t localID = 0; localID < vertexNum; localID++)
+        {
+            offsets[localID + 1] = offsets[localID] + degree[localID];
+        }
+        adjacency.resize(offsets[vertexNum]);
+        for(const std::pair<const VertexID, Vertex>& nodePair : graph.getNodes())
+        {
+            size_t p = offsets[global2local[nodePair.first]];
+            for(const VertexID& neighbor : nodePair.second.getNeighbors())
+            {
+                adjacency[p++] = global2local[neighbor];
+            }
+        }
     }
 
     // 第二步：初始化 bin 数组，用于统计每个度数的节点数量
@@ -199,11 +324,10 @@ void CoreMaintainer::coresDecomp(const Graph& graph)
             startPos = i;
             lastK = degree[localV];
         }
-        for(const VertexID& u : graph.getVertexNeighbors(local2global[localV]))
+        // 剥离localV的一个邻居localU
+        auto peel = [&](VertexID localU)
         {
-            VertexID localU = global2local[u];
             if(degree[localU] > degree[localV])
-
             {
                 uint degU = degree[localU]; // 节点 u 的度数
                 uint posU = pos[localU]; // 节点 u 的起始索引
@@ -226,6 +350,20 @@ void CoreMaintainer::coresDecomp(const Graph& graph)
             {
                 --degreeP[localU];
             }
+        };
+        if(packed)
+        {
+            for(const VertexID& neighbor : localVertices[localV]->getNeighbors())
+            {
+                peel(global2local[neighbor]);
+            }
+        }
+        else
+        {
+            for(size_t p = offsets[localV]; p < offsets[localV + 1]; p++)
+            {
+                peel(adjacency[p]);
+            }
         }
     }
 
@@ -234,7 +372,15 @@ void CoreMaintainer::coresDecomp(const Graph& graph)
         insertToOrderk(vert, local2global, startPos, vertexNum, lastK);
     }
 
-    initmcd(graph, local2global);
+    // 剥离结束后degree即为各节点的core
+    if(packed)
+    {
+        initmcd(local2global, localVertices, global2local, degree);
+    }
+    else
+    {
+        initmcd(local2global, offsets, adjacency, degree);
+    }
 }
 
 bool CoreMaintainer::comparekorder(const uint& a, const uint& b, const uint& k)
@@ -245,60 +391,82 @@ bool CoreMaintainer::comparekorder(const uint& a, const uint& b, const uint& k)
 
 void CoreMaintainer::addVertex(const VertexID& vid)
 {
+    changedVertices.insert(vid);
     cores[vid] = 1;
     degPlus[vid] = 1;
     mcd[vid] = 1;
-    ostrees.at(1).insertFront(vid);
+    ostrees[1].insertFront(vid); // 所有节点的core都大于1时1层还不存在
 }
 
 void CoreMaintainer::orderInsert(const Graph& graph, const VertexID src, const VertexID dst) // 要考虑节点被新添加的情况
 {
-    if(cores.find(src) == cores.end() && cores.find(dst) == cores.end()) // 节点 src 和 dst 是新加入的节点
-    {
-        addVertex(src);
-        addVertex(dst);
-        return ;
-    }
-    if(cores.find(src) == cores.end()) // 节点 src 是新加入的节点
+    ++version;
+    finishRemove(graph); // 插入在分裂修复之后的shell tree上合并
+    changedVertices.insert(src);
+    changedVertices.insert(dst);
+    if(cores.find(src) == cores.end() || cores.find(dst) == cores.end())
     {
-        addVertex(src);
-
-        if(cores.at(dst) == 1)
+        if(cores.find(src) == cores.end() && cores.find(dst) == cores.end()) // 节点 src 和 dst 是新加入的节点
         {
-            ++mcd[dst];
+            addVertex(src);
+            addVertex(dst);
+            degPlus[src] = 0; // dst插在src之前，src之后没有邻居
         }
-        return ;
-    }
-    if(cores.find(dst) == cores.end()) // 节点 dst 是新加入的节点
-    {
-        addVertex(dst);
+        else if(cores.find(src) == cores.end()) // 节点 src 是新加入的节点
+        {
+            addVertex(src);
 
-        if(cores.at(src) == 1)
+            if(cores.at(dst) == 1)
+            {
+                ++mcd[dst];
+            }
+        }
+        else // 节点 dst 是新加入的节点
         {
-            ++mcd[src];
+            addVertex(dst);
+
+            if(cores.at(src) == 1)
+            {
+                ++mcd[src];
+            }
+        }
+        if(shellTree != nullptr)
+        {
+            shellTree->insertUpdate(graph, cores, src, dst, {}, 1);
         }
         return ;
     }
+
+    MaintainTask task(src, dst);
+    orderInsertSearch(graph, task);
+    orderInsertCommit(graph, task);
+}
+
+void CoreMaintainer::orderInsertSearch(const Graph& graph, MaintainTask& task)
+{
+    // 只读取cores和K-order，只修改K层节点的degPlus，结果保存在task.VStar中
     /* 准备阶段 */
     std::priority_queue<std::pair<uint, VertexID>, std::vector<std::pair<uint, VertexID>>, MinHeapCmp> minHeap;
     std::unordered_set<VertexID> inHeap;
-    auto start = std::chrono::high_resolution_clock::now();
+    VertexID src = task.src;
+    VertexID dst = task.dst;
     VertexID u = src; // k-order更小的节点
     VertexID v = dst; // k-order更大的节点
     uint srcCore = cores.at(src);
     uint dstCore = cores.at(dst);
 
-    uint K = std::min(cores.at(src), cores.at(dst));
-    OSTree& ost = ostrees.at(K);
+    uint K = std::min(srcCore, dstCore);
+    task.K = K;
+    const OSTree& ost = ostrees.at(K);
     if(dstCore < srcCore || ( dstCore == srcCore && ost.getRank(src) > ost.getRank(dst)))
     {
         u = dst;
         v = src;
     }
-    ++degPlus[u];
+    ++degPlus.at(u);
     
     /* 核心维护阶段 */
-    if(degPlus[u] <= K)
+    if(degPlus.at(u) <= K)
     {
         return ;
     }
@@ -333,7 +501,7 @@ void CoreMaintainer::orderInsert(const Graph& graph, const VertexID src, const V
         {
             degStar[curV] = 0;
         }
-        if(degStar[curV] + degPlus[curV] > K)
+        if(degStar[curV] + degPlus.at(curV) > K)
         {
             inVc[curV] = curVRank;
             Vc.emplace_back(curV);
@@ -356,39 +524,69 @@ void CoreMaintainer::orderInsert(const Graph& graph, const VertexID src, const V
         }
         else
         {
-            degPlus[curV] += degStar[curV];
+            degPlus.at(curV) += degStar[curV];
             degStar[curV] = 0;
-            removeCandidates(graph, degStar, inVc, inHeap, curV, K);
+            removeCandidates(graph, degStar, inVc, inHeap, curV, K, task.moved);
         }
     }
     /* 结束阶段 */
-    std::vector<VertexID> VStar;
     for(const VertexID& w : Vc)
     {
         if(inVc.find(w) == inVc.end())
         {
             continue;
         }
+        task.VStar.emplace_back(w);
+    }
+}
+
+void CoreMaintainer::orderInsertCommit(const Graph& graph, MaintainTask& task)
+{
+    uint K = task.K;
+    const std::vector<VertexID>& VStar = task.VStar;
+    // 新边对端点mcd的贡献，VStar节点的mcd随后在updatemcdInsert中重新计算
+    if(cores.at(task.src) <= cores.at(task.dst))
+    {
+        ++mcd[task.src];
+    }
+    if(cores.at(task.dst) <= cores.at(task.src))
+    {
+        ++mcd[task.dst];
+    }
+    changedVertices.insert(task.src);
+    changedVertices.insert(task.dst);
+    for(const VertexID& w : VStar)
+    {
         ++cores[w];
-        VStar.emplace_back(w);
+        changedVertices.insert(w);
     }
-    for(int i = VStar.size() - 1; i >= 0; i--)
+    for(const VertexID& w : VStar)
     {
-        VertexID w = VStar[i];
         ostrees[K].erase(w);
-        ostrees[K+1].insertFront(w);
+    }
+    ostrees[K+1].prependRange(VStar); // VStar整体按原顺序移到K+1层的最前面
+    for(const std::pair<VertexID, VertexID>& p : task.moved)
+    {
+        ostrees[K].erase(p.first);
+        ostrees[K].insertAfter(p.second, p.first);
     }
     updatemcdInsert(graph, VStar, K);
     // initmcdTest(graph);
+    if(shellTree != nullptr)
+    {
+        shellTree->insertUpdate(graph, cores, task.src, task.dst, VStar, K);
+    }
 }
 
 void CoreMaintainer::removeCandidates(const Graph& graph, std::unordered_map<VertexID, uint>& degStar, std::unordered_map<VertexID, uint>& inVc, 
-                                    std::unordered_set<VertexID>& inHeap, VertexID w, uint K)
+                                    std::unordered_set<VertexID>& inHeap, VertexID w, uint K, 
+                                    std::vector<std::pair<VertexID, VertexID>>& moved)
 {
-    OSTree& ost = ostrees.at(K);
+    const OSTree& ost = ostrees.at(K);
     uint wRank = ost.getRank(w);
     std::queue<VertexID> Q;
     std::unordered_set<VertexID> visited;
+    VertexID last = w;
     for(const VertexID& neighbor : graph.getVertexNeighbors(w))
     {
         if(inVc.find(neighbor) != inVc.end())
@@ -397,8 +595,8 @@ void CoreMaintainer::removeCandidates(const Graph& graph, std::unordered_map<Ver
             {
                 degStar[neighbor] = 0;
             }
-            --degPlus[neighbor];
-            if(degPlus[neighbor] + degStar[neighbor] <= K)
+            --degPlus.at(neighbor);
+            if(degPlus.at(neighbor) + degStar[neighbor] <= K)
             {
                 Q.push(neighbor);
                 visited.insert(neighbor);
@@ -409,13 +607,14 @@ void CoreMaintainer::removeCandidates(const Graph& graph, std::unordered_map<Ver
     {
         VertexID curV = Q.front();
         Q.pop();
-        degPlus[curV] += degStar[curV];
+        degPlus.at(curV) += degStar[curV];
         degStar[curV] = 0;
 
         uint curVRank = inVc[curV];
         inVc.erase(curV);
-        // std::list<VertexID>::iterator it = std::lower_bound(_orderK.begin(), _orderK.end(), curV, [&K, this](const uint& a, const uint& b){return comparekorder(a, b, K);});
-        // _orderK.insert(it, curV);
+        // 移出候选集的节点在K-order中依次排到w之后，commit阶段再实际移动
+        moved.emplace_back(curV, last);
+        last = curV;
 
         for(const VertexID& neighbor : graph.getVertexNeighbors(curV))
         {
@@ -425,7 +624,7 @@ void CoreMaintainer::removeCandidates(const Graph& graph, std::unordered_map<Ver
                 if(wRank < neighborRank)
                 {
                     --degStar[neighbor];
-                    if(inHeap.find(neighbor) != inHeap.end() && degStar[neighbor] == 0 && degPlus[neighbor] <= K)
+                    if(inHeap.find(neighbor) != inHeap.end() && degStar[neighbor] == 0 && degPlus.at(neighbor) <= K)
                     {
                         inHeap.erase(neighbor);
                     }
@@ -433,7 +632,7 @@ void CoreMaintainer::removeCandidates(const Graph& graph, std::unordered_map<Ver
                 else if(curVRank < neighborRank && inVc.find(neighbor) != inVc.end())
                 {
                     --degStar[neighbor];
-                    if(degStar[neighbor] + degPlus[neighbor] <= K && visited.find(neighbor) == visited.end())
+                    if(degStar[neighbor] + degPlus.at(neighbor) <= K && visited.find(neighbor) == visited.end())
                     {
                         Q.push(neighbor);
                         visited.insert(neighbor);
@@ -441,8 +640,8 @@ void CoreMaintainer::removeCandidates(const Graph& graph, std::unordered_map<Ver
                 }
                 else if(inVc.find(neighbor) != inVc.end())
                 {
-                    --degPlus[neighbor];
-                    if(degStar[neighbor] + degPlus[neighbor] <= K && visited.find(neighbor) == visited.end())
+                    --degPlus.at(neighbor);
+                    if(degStar[neighbor] + degPlus.at(neighbor) <= K && visited.find(neighbor) == visited.end())
                     {
                         Q.push(neighbor);
                         visited.insert(neighbor);
@@ -475,6 +674,7 @@ void CoreMaintainer::updatemcdInsert(const Graph& graph, const std::vector<Verte
 
 void CoreMaintainer::removeVertex(const VertexID& vid)
 {
+    changedVertices.insert(vid);
     cores.erase(vid);
     degPlus.erase(vid);
     mcd.erase(vid);
@@ -488,13 +688,34 @@ void CoreMaintainer::removeVertex(const VertexID& vid)
     // }
 }
 
+void CoreMaintainer::detachIsolatedVertex(const VertexID& vid)
+{
+    changedVertices.insert(vid);
+    detachedVertices.emplace_back(vid);
+    ostrees.at(cores.at(vid)).erase(vid);
+    cores.erase(vid);
+    degPlus.erase(vid);
+    mcd.erase(vid);
+    if(shellTree != nullptr)
+    {
+        shellTree->removeIsolatedVertex(vid);
+    }
+}
+
 void CoreMaintainer::orderRemove(const Graph& graph, const VertexID src, const VertexID dst)
 {
+    ++version;
+    changedVertices.insert(src);
+    changedVertices.insert(dst);
     // 考虑节点被删除的情况
     if(graph.hasVertex(src) == false && graph.hasVertex(dst) == false)
     {
         removeVertex(src);
         removeVertex(dst);
+        if(shellTree != nullptr)
+        {
+            shellTree->removeUpdate(graph, cores, src, dst, {}, 0);
+        }
         return ;
     }
     if(graph.hasVertex(src) == false)
@@ -508,6 +729,10 @@ void CoreMaintainer::orderRemove(const Graph& graph, const VertexID src, const V
             }
         }
         removeVertex(src);
+        if(shellTree != nullptr)
+        {
+            shellTree->removeUpdate(graph, cores, src, dst, {}, 0);
+        }
         return ;
     }
     if(graph.hasVertex(dst) == false)
@@ -521,23 +746,71 @@ void CoreMaintainer::orderRemove(const Graph& graph, const VertexID src, const V
             }
         }
         removeVertex(dst);
+        if(shellTree != nullptr)
+        {
+            shellTree->removeUpdate(graph, cores, src, dst, {}, 0);
+        }
         return ;
     }
 
+    MaintainTask task(src, dst);
+    orderRemoveSearch(graph, task);
+    orderRemoveCommit(graph, task);
+}
+
+void CoreMaintainer::finishRemove(const Graph& graph)
+{
+    if(shellTree != nullptr && !shellTree->isReady())
+    {
+        shellTree->finishRemove(graph, cores);
+    }
+}
+
+void CoreMaintainer::orderRemoveSearch(const Graph& graph, MaintainTask& task)
+{
+    // 只读取cores和K-order，只修改K层节点的mcd，结果保存在task.VStar和task.inVStar中
+    VertexID src = task.src;
+    VertexID dst = task.dst;
     uint K = std::min(cores.at(src), cores.at(dst));
-    OSTree& ost = ostrees.at(K);
+    task.K = K;
     if(cores.at(src) <= cores.at(dst))
     {
-        --mcd[src];
+        --mcd.at(src);
     }
     if(cores.at(dst) <= cores.at(src))
     {
-        --mcd[dst];
+        --mcd.at(dst);
+    }
+    traverseVStarFind(graph, task.VStar, task.inVStar, src, dst, K);
+}
+
+void CoreMaintainer::orderRemoveCommit(const Graph& graph, MaintainTask& task)
+{
+    uint K = task.K;
+    std::vector<VertexID>& VStar = task.VStar;
+    std::unordered_map<VertexID, uint>& inVStar = task.inVStar;
+    // 同一轮中先提交的任务已经把各自的VStar从K层删除，search阶段记录的排名可能已经前移，
+    // 而其他节点的排名在下面按当前K-order读取，两者要一致；其他任务不改变VStar之间的相对顺序
+    for(const VertexID& w : VStar)
+    {
+        inVStar[w] = ostrees.at(K).getRank(w);
+    }
+    // 被删除的边原先计入k-order更小的端点的degPlus，该端点若在VStar中随后会重新计算
+    VertexID u = task.src;
+    if(cores.at(task.dst) < cores.at(task.src) || (cores.at(task.dst) == cores.at(task.src) && ostrees.at(K).getRank(task.dst) < ostrees.at(K).getRank(task.src)))
+    {
+        u = task.dst;
+    }
+    --degPlus.at(u);
+    changedVertices.insert(task.src);
+    changedVertices.insert(task.dst);
+    for(const VertexID& w : VStar)
+    {
+        --cores[w];
+        changedVertices.insert(w);
     }
-    std::unordered_map<VertexID, uint> inVStar;
-    std::vector<VertexID> VStar;
-    traverseVStarFind(graph, VStar, inVStar, src, dst, K); // 要负责删除OK中的VStar节点
 
+    OSTree& ost = ostrees.at(K);
     updatemcdRemove(graph, VStar, inVStar, K);
     // initmcdTest(graph);
     for(const VertexID& w : VStar)
@@ -567,14 +840,22 @@ void CoreMaintainer::orderRemove(const Graph& graph, const VertexID src, const V
             }
         }
         inVStar.erase(w);
-        // orderkV[K-1].emplace_back(w);
-        ostrees[K-1].insertBack(w);
+    }
+    // 邻居的排名要和VStar删除前的排名比较，所以最后才从K层删除
+    for(const VertexID& w : VStar)
+    {
+        ost.erase(w);
+    }
+    ostrees[K-1].appendRange(VStar); // VStar整体按原顺序移到K-1层的最后面
+    if(shellTree != nullptr)
+    {
+        shellTree->removeUpdate(graph, cores, task.src, task.dst, VStar, K);
     }
 }
 
 void CoreMaintainer::traverseVStarFind(const Graph& graph, std::vector<VertexID>& VStar, std::unordered_map<VertexID, uint>& inVStar, const VertexID& src, const VertexID& dst, uint K)
 {
-    // 要负责删除OK中的VStar节点
+    // 只负责找出VStar，节点core的减少和从OK中删除在orderRemoveCommit中完成
     std::queue<VertexID> Q;
     std::unordered_set<VertexID> inQ;
     std::unordered_map<VertexID, uint> cd;
@@ -601,16 +882,16 @@ void CoreMaintainer::traverseVStarFind(const Graph& graph, std::vector<VertexID>
         }
         VertexID w = Q.front();
         Q.pop();
+        inQ.erase(w); // 出队后未被删除的节点，之后其邻居被删除时仍需更新cd并可能重新入队
         if(cd.find(w) == cd.end())
         {
-            cd[w] = mcd[w];
+            cd[w] = mcd.at(w);
         }
         if(cores.at(w) == K && cd[w] < K)
         {
             VStar.emplace_back(w);
             inVStar.insert(std::make_pair(w, ostrees.at(K).getRank(w)));
             removed.insert(w);
-            --cores[w];
             for(const VertexID& z : graph.getVertexNeighbors(w))
             {
                 if(removed.find(z) != removed.end() || inQ.find(z) != inQ.end())
@@ -621,7 +902,7 @@ void CoreMaintainer::traverseVStarFind(const Graph& graph, std::vector<VertexID>
                 {
                     if(cd.find(z) == cd.end())
                     {
-                        cd[z] = mcd[z];
+                        cd[z] = mcd.at(z);
                         if(cd[z] == 0)
                         {
                             std::cout << "cd error" << std::endl;
@@ -637,12 +918,6 @@ void CoreMaintainer::traverseVStarFind(const Graph& graph, std::vector<VertexID>
             }
         }
     }
-
-    for(const std::pair<VertexID, uint>& p : inVStar)
-    {
-        VertexID _vid = p.first;
-        ostrees.at(K).erase(_vid);
-    }
 }
 
 void CoreMaintainer::updatemcdRemove(const Graph& graph, const std::vector<VertexID>& VStar, const std::unordered_map<VertexID, uint>& inVStar, uint K)
@@ -671,6 +946,263 @@ void CoreMaintainer::updatemcdRemove(const Graph& graph, const std::vector<Verte
     }
 }
 
+uint CoreMaintainer::findRegion(const Graph& graph, const VertexID& vid, uint K, std::unordered_map<VertexID, uint>& regionLabel, uint& regionNum) const
+{
+    // 区域为vid经由core为K的节点可达的K层节点集合，超过BATCH_REGION_LIMIT时返回UINT_MAX表示占用整层
+    auto it = regionLabel.find(vid);
+    if(it != regionLabel.end())
+    {
+        return it->second;
+    }
+
+    uint regionID = regionNum++;
+    bool wholeLevel = false;
+    std::vector<VertexID> region;
+    std::queue<VertexID> Q;
+    regionLabel[vid] = regionID;
+    region.emplace_back(vid);
+    Q.push(vid);
+    while(!Q.empty() && !wholeLevel)
+    {
+        VertexID w = Q.front();
+        Q.pop();
+        for(const VertexID& z : graph.getVertexNeighbors(w))
+        {
+            if(cores.at(z) != K)
+            {
+                continue;
+            }
+            auto zIt = regionLabel.find(z);
+            if(zIt != regionLabel.end())
+            {
+                if(zIt->second != regionID) // 与已经超过上限的区域相连
+                {
+                    wholeLevel = true;
+                    break;
+                }
+                continue;
+            }
+            if(region.size() >= BATCH_REGION_LIMIT)
+            {
+                wholeLevel = true;
+                break;
+            }
+            regionLabel[z] = regionID;
+            region.emplace_back(z);
+            Q.push(z);
+        }
+    }
+
+    if(wholeLevel)
+    {
+        for(const VertexID& w : region)
+        {
+            regionLabel[w] = UINT_MAX;
+        }
+        return UINT_MAX;
+    }
+    return regionID;
+}
+
+void CoreMaintainer::batchMaintain(Graph& graph, const std::vector<std::pair<VertexID, VertexID>>& edges, ThreadPool& pool, bool isInsert)
+{
+    ++version;
+    /*
+     * 每一轮从待处理边中选出互不冲突的一组边：
+     * 插入K层的边会修改K和K+1层，删除K层的边会修改K-1和K层，K不同的边修改的层不能相交；
+     * K相同的边所在的K层连通区域不能相交。
+     * 选出的边先写入图，然后并行执行search阶段，最后按顺序串行commit，冲突的边留到下一轮。
+     */
+    if(isInsert)
+    {
+        finishRemove(graph); // 插入在分裂修复之后的shell tree上合并
+    }
+    std::deque<std::pair<VertexID, VertexID>> pending;
+    std::unordered_set<VertexID> touched; // 邻居发生变化的节点，批量结束后统一重新计算摘要
+    for(const std::pair<VertexID, VertexID>& edge : edges)
+    {
+        VertexID src = edge.first;
+        VertexID dst = edge.second;
+        if(isInsert && (cores.find(src) == cores.end() || cores.find(dst) == cores.end())) // 含新节点的边只涉及1层，直接串行处理
+        {
+            if(!graph.hasEdge(src, dst))
+            {
+                graph.addEdge(src, dst, true, false);
+                orderInsert(graph, src, dst);
+                touched.insert(src);
+                touched.insert(dst);
+            }
+            continue;
+        }
+        pending.emplace_back(edge);
+    }
+
+    // 只有一个工作线程时逐条处理，省去冲突检测的开销
+    size_t window = pool.size() <= 1 ? 1 : pool.size() * BATCH_WINDOW_PER_THREAD;
+    while(!pending.empty())
+    {
+        std::vector<MaintainTask> tasks;
+        std::vector<std::pair<VertexID, VertexID>> deferred;
+        std::unordered_map<uint, uint> levelOwner; // 层 -> 占用该层的任务的K
+        std::unordered_map<uint, uint> levelTaskNum; // K -> 本轮该K的任务数
+        std::unordered_map<uint, std::vector<VertexID>> lazyEndpoints; // K -> 本轮该K第一个任务中core为K的端点
+        std::unordered_set<uint> wholeLevels; // 本轮被整层占用的K
+        std::unordered_set<uint> claimedRegions;
+        std::unordered_map<VertexID, uint> regionLabel;
+        uint regionNum = 0;
+
+        for(size_t scanned = 0; scanned < window && !pending.empty(); scanned++)
+        {
+            std::pair<VertexID, VertexID> edge = pending.front();
+            pending.pop_front();
+            VertexID src = edge.first;
+            VertexID dst = edge.second;
+            if(graph.hasEdge(src, dst) == isInsert) // 重复插入的边或者不存在的边不需要维护
+            {
+                continue;
+            }
+
+            uint K = std::min(cores.at(src), cores.at(dst));
+            uint lowLevel = isInsert ? K : (K > 0 ? K - 1 : 0);
+            uint highLevel = isInsert ? K + 1 : K;
+            bool conflict = (levelOwner.find(lowLevel) != levelOwner.end() && levelOwner.at(lowLevel) != K)
+                            || (levelOwner.find(highLevel) != levelOwner.end() && levelOwner.at(highLevel) != K);
+
+            std::vector<VertexID> endpoints;
+            for(const VertexID& endpoint : {src, dst})
+            {
+                if(cores.at(endpoint) == K)
+                {
+                    endpoints.emplace_back(endpoint);
+                }
+            }
+
+            // 同一个K只有一个任务时不需要计算区域，出现第二个同K任务时再为之前的任务计算
+            std::vector<uint> regions;
+            if(!conflict && levelTaskNum[K] > 0)
+            {
+                auto lazyIt = lazyEndpoints.find(K);
+                if(lazyIt != lazyEndpoints.end())
+                {
+                    for(const VertexID& endpoint : lazyIt->second)
+                    {
+                        uint region = findRegion(graph, endpoint, K, regionLabel, regionNum);
+                        if(region == UINT_MAX)
+                        {
+                            wholeLevels.insert(K);
+                        }
+                        else
+                        {
+                            claimedRegions.insert(region);
+                        }
+                    }
+                    lazyEndpoints.erase(lazyIt);
+                }
+                for(const VertexID& endpoint : endpoints)
+                {
+                    uint region = findRegion(graph, endpoint, K, regionLabel, regionNum);
+                    if(region == UINT_MAX || wholeLevels.find(K) != wholeLevels.end() || claimedRegions.find(region) != claimedRegions.end())
+                    {
+                        conflict = true;
+                        break;
+                    }
+                    regions.emplace_back(region);
+                }
+            }
+            if(conflict)
+            {
+                deferred.emplace_back(edge);
+                continue;
+            }
+
+            levelOwner[lowLevel] = K;
+            levelOwner[highLevel] = K;
+            if(levelTaskNum[K] == 0)
+            {
+                lazyEndpoints[K] = endpoints;
+            }
+            ++levelTaskNum[K];
+            claimedRegions.insert(regions.begin(), regions.end());
+            tasks.emplace_back(src, dst);
+        }
+        pending.insert(pending.begin(), deferred.begin(), deferred.end()); // 冲突的边保持原有顺序留到下一轮
+
+        for(const MaintainTask& task : tasks)
+        {
+            if(isInsert)
+            {
+                graph.addEdge(task.src, task.dst, true, false);
+            }
+            else
+            {
+                graph.removeEdge(task.src, task.dst, true, false);
+            }
+            touched.insert(task.src);
+            touched.insert(task.dst);
+        }
+
+        pool.parallelFor(tasks.size(), [this, &graph, &tasks, isInsert](size_t i)
+        {
+            if(isInsert)
+            {
+                orderInsertSearch(graph, tasks[i]);
+            }
+            else
+            {
+                orderRemoveSearch(graph, tasks[i]);
+            }
+        });
+
+        for(MaintainTask& task : tasks)
+        {
+            if(isInsert)
+            {
+                orderInsertCommit(graph, task);
+            }
+            else
+            {
+                orderRemoveCommit(graph, task);
+            }
+        }
+    }
+
+    if(!isInsert) // 孤立节点从图和索引中移除，之后再出现时按新节点插入，插入维护不需要处理core为0的节点
+    {
+        finishRemove(graph); // 所有轮的边都已经从图中删除，整批只修复一次shell tree的分裂
+        for(const VertexID& vid : touched)
+        {
+            if(graph.hasVertex(vid) && graph.getVertexNeighbors(vid).empty())
+            {
+                detachIsolatedVertex(vid);
+                graph.removeVertex(vid, true, false);
+            }
+        }
+    }
+
+    std::vector<VertexID> touchedVids;
+    for(const VertexID& vid : touched)
+    {
+        if(graph.hasVertex(vid))
+        {
+            touchedVids.emplace_back(vid);
+        }
+    }
+    pool.parallelFor(touchedVids.size(), [&graph, &touchedVids](size_t i)
+    {
+        graph.computeVertexDigest(touchedVids[i]);
+    });
+}
+
+void CoreMaintainer::batchInsert(Graph& graph, const std::vector<std::pair<VertexID, VertexID>>& edges, ThreadPool& pool)
+{
+    batchMaintain(graph, edges, pool, true);
+}
+
+void CoreMaintainer::batchRemove(Graph& graph, const std::vector<std::pair<VertexID, VertexID>>& edges, ThreadPool& pool)
+{
+    batchMaintain(graph, edges, pool, false);
+}
+
 // void CoreMaintainer::printOrderk(uint k) const
 // {
 //     if(orderkV.find(k) == orderkV.end())
@@ -1,5 +1,7 @@
 #include "maintainer/shelltree.h"
 
+const uint FrozenShellNode::NONE;
+
 ShellTree::ShellTree(){}
 
 ShellTree::~ShellTree()
@@ -18,138 +20,831 @@ ShellTree::~ShellTree()
     }
 }
 
-void ShellTree::dfs(const Graph& graph, const VertexID& u, ShellNode* component, const uint& componentID, const std::unordered_map<VertexID, uint>& cores, std::unordered_set<VertexID>& visited)
+uint ShellTree::findRoot(std::vector<uint>& dsuParent, uint x)
 {
-    visited.emplace(u);
-    component->vertices.emplace_back(u);
-    vertexToCC[u] = componentID;
+    // 路径减半，不使用递归
+    while(dsuParent[x] != x)
+    {
+        dsuParent[x] = dsuParent[dsuParent[x]];
+        x = dsuParent[x];
+    }
+    return x;
+}
 
-    for(const VertexID& v : graph.getVertexNeighbors(u))
+void ShellTree::buildTree(const Graph& graph, const std::unordered_map<VertexID, uint>& cores)
+{
+    flatDirty = true;
+    // 节点按graph的局部编号顺序映射为稠密编号，并按core分桶
+    uint n = cores.size();
+    std::unordered_map<VertexID, uint> denseID;
+    denseID.reserve(n);
+    std::vector<VertexID> vids;
+    vids.reserve(n);
+    uint maxCore = 0;
+    for(const VertexID& vid : graph.convertToLocalID())
     {
-        if(visited.find(v) == visited.end() && cores.at(v) >= component->coreLevel)
+        auto it = cores.find(vid);
+        if(it == cores.end())
         {
-            dfs(graph, v, component, componentID, cores, visited);
+            continue;
+        }
+        denseID.emplace(vid, vids.size());
+        vids.emplace_back(vid);
+        maxCore = std::max(maxCore, it->second);
+    }
+    n = vids.size();
+    std::vector<std::vector<uint>> levelSets(maxCore + 1);
+    for(uint i = 0; i < n; i++)
+    {
+        levelSets[cores.at(vids[i])].emplace_back(i);
+    }
+
+    std::vector<uint> dsuParent(n);
+    std::vector<uint> dsuSize(n, 1);
+    std::vector<bool> active(n, false); // core不小于当前层的节点
+    std::vector<ShellNode*> compTop(n, nullptr); // 并查集根 -> 该连通分量当前的顶层ShellNode，为空表示在当前层新出现或被合并
+    std::vector<std::vector<ShellNode*>> compKids(n); // 并查集根 -> 在当前层被合并、等待挂到新节点下的更高层顶层节点
+    vertexToNode.reserve(n);
+    vertexPos.reserve(n);
+
+    // 自顶向下逐层处理，每条边只在其较小core的端点所在层处理一次
+    for(uint level = maxCore + 1; level-- > 0; )
+    {
+        const std::vector<uint>& S = levelSets[level];
+        if(S.empty())
+        {
+            continue;
+        }
+        for(uint v : S)
+        {
+            dsuParent[v] = v;
+            active[v] = true;
+        }
+        for(uint v : S)
+        {
+            for(const VertexID& neighbor : graph.getVertexNeighbors(vids[v]))
+            {
+                uint w = denseID.at(neighbor);
+                if(!active[w])
+                {
+                    continue;
+                }
+                uint a = findRoot(dsuParent, v);
+                uint b = findRoot(dsuParent, w);
+                if(a == b)
+                {
+                    continue;
+                }
+                for(uint r : {a, b})
+                {
+                    if(compTop[r] != nullptr)
+                    {
+                        compKids[r].emplace_back(compTop[r]);
+                        compTop[r] = nullptr;
+                    }
+                }
+                if(dsuSize[a] < dsuSize[b])
+                {
+                    std::swap(a, b);
+                }
+                dsuParent[b] = a;
+                dsuSize[a] += dsuSize[b];
+                if(compKids[a].size() < compKids[b].size())
+                {
+                    compKids[a].swap(compKids[b]);
+                }
+                compKids[a].insert(compKids[a].end(), compKids[b].begin(), compKids[b].end());
+                std::vector<ShellNode*>().swap(compKids[b]);
+            }
+        }
+        // 含有当前层节点的连通分量各建一个新节点，被合并的更高层分量挂到其下
+        for(uint v : S)
+        {
+            uint r = findRoot(dsuParent, v);
+            if(compTop[r] == nullptr)
+            {
+                compTop[r] = createNode(level, nullptr);
+                for(ShellNode* kid : compKids[r])
+                {
+                    setParent(kid, compTop[r]);
+                }
+                std::vector<ShellNode*>().swap(compKids[r]);
+            }
+            addToNode(compTop[r], vids[v]);
         }
     }
 }
 
-void ShellTree::initBottomNodes(const Graph& graph, const std::unordered_map<VertexID, uint>& cores, const std::vector<VertexID>& bottomSets, const uint& bottomLevel)
+uint ShellTree::allocHandle(ShellNode* node)
+{
+    if(freeHandles.empty())
+    {
+        node->handle = handleNodes.size();
+        handleNodes.emplace_back(node);
+    }
+    else
+    {
+        node->handle = freeHandles.back();
+        freeHandles.pop_back();
+        handleNodes[node->handle] = node;
+    }
+    dirtyHandles.insert(node->handle);
+    return node->handle;
+}
+
+ShellNode* ShellTree::createNode(uint coreLevel, ShellNode* parent)
 {
-    std::unordered_set<VertexID> visited;
-    uint componentID = 0;
+    std::vector<ShellNode*>& nodes = shellNodes[coreLevel];
+    ShellNode* node = new ShellNode(nodes.size(), coreLevel, nullptr);
+    nodes.emplace_back(node);
+    allocHandle(node);
+    setParent(node, parent);
+    return node;
+}
 
-    for(VertexID v : bottomSets)
+void ShellTree::releaseNode(ShellNode* node)
+{
+    while(node != nullptr && node->vertices.empty() && node->children.empty())
     {
-        if(visited.find(v) == visited.end())
+        ShellNode* parent = node->parent;
+        setParent(node, nullptr);
+        shellNodes.at(node->coreLevel).at(node->id) = nullptr;
+        hollowNodes.erase(node);
+        handleNodes[node->handle] = nullptr;
+        freeHandles.emplace_back(node->handle);
+        dirtyHandles.insert(node->handle);
+        delete node;
+        node = parent;
+    }
+}
+
+void ShellTree::compactNodes()
+{
+    // 维护结束后仍为空的节点：没有孩子直接删除，有孩子时孩子改挂到其父节点下
+    std::vector<ShellNode*> nodes(hollowNodes.begin(), hollowNodes.end());
+    for(ShellNode* node : nodes)
+    {
+        if(hollowNodes.find(node) == hollowNodes.end() || !node->vertices.empty())
         {
-            ShellNode* newNode = new ShellNode(componentID, bottomLevel, nullptr);
-            dfs(graph, v, newNode, componentID, cores, visited);
-            shellNodes[bottomLevel].emplace_back(newNode);
-            componentID++;
+            continue;
         }
+        std::vector<ShellNode*> children(node->children.begin(), node->children.end());
+        for(ShellNode* child : children)
+        {
+            setParent(child, node->parent);
+        }
+        releaseNode(node);
     }
+    hollowNodes.clear();
 }
 
-void ShellTree::buildTree(const Graph& graph, const std::unordered_map<VertexID, uint>& cores)
+void ShellTree::setParent(ShellNode* node, ShellNode* parent)
+{
+    if(node->parent == parent)
+    {
+        return ;
+    }
+    if(node->parent != nullptr)
+    {
+        node->parent->children.erase(node);
+        dirtyHandles.insert(node->parent->handle);
+    }
+    node->parent = parent;
+    dirtyHandles.insert(node->handle);
+    if(parent != nullptr)
+    {
+        parent->children.insert(node);
+        dirtyHandles.insert(parent->handle);
+    }
+}
+
+void ShellTree::addToNode(ShellNode* node, const VertexID& vid)
+{
+    dirtyHandles.insert(node->handle);
+    movedVertices.insert(vid);
+    vertexToNode[vid] = node;
+    vertexPos[vid] = node->vertices.size();
+    node->vertices.emplace_back(vid);
+}
+
+void ShellTree::removeFromNode(const VertexID& vid)
+{
+    ShellNode* node = getNode(vid);
+    dirtyHandles.insert(node->handle);
+    movedVertices.insert(vid);
+    uint pos = vertexPos.at(vid);
+    VertexID last = node->vertices.back();
+    node->vertices[pos] = last;
+    vertexPos[last] = pos;
+    node->vertices.pop_back();
+    vertexToNode.erase(vid);
+    vertexPos.erase(vid);
+    if(node->vertices.empty())
+    {
+        hollowNodes.insert(node);
+    }
+}
+
+ShellNode* ShellTree::getNode(const VertexID& vid) const
+{
+    auto it = vertexToNode.find(vid);
+    if(it == vertexToNode.end())
+    {
+        std::cerr << "ShellTree Error: vertex " << vid << " not found" << std::endl;
+        throw std::runtime_error("ShellTree Error: vertex not found");
+    }
+    return it->second;
+}
+
+ShellNode* ShellTree::levelComponent(ShellNode* node, uint level) const
+{
+    while(node->parent != nullptr && node->parent->coreLevel >= level)
+    {
+        node = node->parent;
+    }
+    return node;
+}
+
+ShellNode* ShellTree::mergeNodes(ShellNode* a, ShellNode* b)
+{
+    if(a->vertices.size() + a->children.size() < b->vertices.size() + b->children.size())
+    {
+        std::swap(a, b);
+    }
+    // b并入a，b的父节点关系由调用者重新设置
+    dirtyHandles.insert(a->handle);
+    for(const VertexID& vid : b->vertices)
+    {
+        movedVertices.insert(vid);
+        vertexToNode[vid] = a;
+        vertexPos[vid] = a->vertices.size();
+        a->vertices.emplace_back(vid);
+    }
+    b->vertices.clear();
+    std::vector<ShellNode*> children(b->children.begin(), b->children.end());
+    for(ShellNode* child : children)
+    {
+        setParent(child, a);
+    }
+    releaseNode(b);
+    return a;
+}
+
+void ShellTree::mergePaths(ShellNode* a, ShellNode* b)
+{
+    // a和b到根的路径上层级依次递减，按层级归并两条路径，同层的节点合并为一个
+    ShellNode* child = nullptr;
+    while(a != b)
+    {
+        ShellNode* cur;
+        if(b == nullptr || (a != nullptr && a->coreLevel > b->coreLevel))
+        {
+            cur = a;
+            a = a->parent;
+        }
+        else if(a == nullptr || b->coreLevel > a->coreLevel)
+        {
+            cur = b;
+            b = b->parent;
+        }
+        else
+        {
+            // 同层的节点可能在同一条同层链上，先各自移到链的顶端
+            while(a->parent != nullptr && a->parent->coreLevel == a->coreLevel)
+            {
+                a = a->parent;
+            }
+            while(b->parent != nullptr && b->parent->coreLevel == b->coreLevel)
+            {
+                b = b->parent;
+            }
+            if(a == b)
+            {
+                continue;
+            }
+            ShellNode* nextA = a->parent;
+            ShellNode* nextB = b->parent;
+            setParent(a, nullptr);
+            setParent(b, nullptr);
+            cur = mergeNodes(a, b);
+            a = nextA;
+            b = nextB;
+        }
+        if(child != nullptr)
+        {
+            setParent(child, cur);
+        }
+        child = cur;
+    }
+    if(child != nullptr)
+    {
+        setParent(child, a);
+    }
+}
+
+void ShellTree::mergeAlongEdge(const std::unordered_map<VertexID, uint>& cores, const VertexID& u, const VertexID& v)
+{
+    // 边(u, v)只在不超过两端点core较小值的层上连接两端点
+    uint level = std::min(cores.at(u), cores.at(v));
+    ShellNode* a = levelComponent(getNode(u), level);
+    ShellNode* b = levelComponent(getNode(v), level);
+    if(a != b)
+    {
+        mergePaths(a, b);
+    }
+}
+
+std::vector<std::vector<VertexID>> ShellTree::findSplitPieces(const Graph& graph, const std::unordered_map<VertexID, uint>& cores, const std::vector<VertexID>& seeds, uint level)
 {
-    std::map<uint, std::vector<VertexID>, std::greater<uint>> CSets;
-    // 构建每个core对应的集合
-    for(const std::pair<VertexID, uint>& p : cores)
+    /*
+     * 从每个种子同时在level-core中做BFS，每一步每个搜索最多扫描stepEdges条邻边，相遇的搜索合并；
+     * 只剩一个未结束的搜索时停止，已经结束的搜索就是分裂出来的连通块，代价只与较小的连通块有关。
+     */
+    const size_t stepEdges = 8;
+    uint searchNum = seeds.size();
+    std::vector<uint> searchParent(searchNum);
+    std::vector<std::vector<VertexID>> pieces(searchNum);
+    std::vector<std::vector<VertexID>> frontiers(searchNum);
+    std::vector<size_t> heads(searchNum, 0);
+    std::vector<NeighborList::const_iterator> edgeIt(searchNum); // 当前扩展节点下一条要扫描的邻边
+    std::vector<bool> scanning(searchNum, false); // edgeIt是否指向当前扩展节点的邻居表
+    std::vector<bool> finished(searchNum, false);
+    std::unordered_map<VertexID, uint> owner;
+    for(uint i = 0; i < searchNum; i++)
     {
-        CSets[p.second].emplace_back(p.first);
+        searchParent[i] = i;
+        pieces[i].emplace_back(seeds[i]);
+        frontiers[i].emplace_back(seeds[i]);
+        owner[seeds[i]] = i;
     }
-    initBottomNodes(graph, cores, CSets.begin()->second, CSets.begin()->first);
-    for(auto it = std::next(CSets.begin(), 1); it!= CSets.end(); it++)
+    auto findSearch = [&searchParent](uint i)
     {
-        uint level = it->first;
-        std::vector<VertexID>& S = it->second;
+        while(searchParent[i] != i)
+        {
+            searchParent[i] = searchParent[searchParent[i]];
+            i = searchParent[i];
+        }
+        return i;
+    };
 
-        for(const VertexID& v : S)
+    std::vector<std::vector<VertexID>> result;
+    uint active = searchNum;
+    while(active > 1)
+    {
+        for(uint i = 0; i < searchNum && active > 1; i++)
         {
-            std::unordered_set<ShellNode*> T; // 要记得加上v
-            std::unordered_set<VertexID> visited;
-            std::unordered_set<ShellNode*> parents; 
-            for(const VertexID& neighbor : graph.getVertexNeighbors(v))
+            if(searchParent[i] != i || finished[i])
             {
-                if(visited.find(neighbor) != visited.end())
+                continue;
+            }
+            if(heads[i] == frontiers[i].size())
+            {
+                finished[i] = true;
+                --active;
+                result.emplace_back(std::move(pieces[i]));
+                continue;
+            }
+            VertexID u = frontiers[i][heads[i]];
+            const NeighborList& neighbors = graph.getVertexNeighbors(u);
+            if(!scanning[i])
+            {
+                edgeIt[i] = neighbors.begin();
+                scanning[i] = true;
+            }
+            bool merged = false;
+            for(size_t scanned = 0; edgeIt[i] != neighbors.end() && scanned < stepEdges; ++edgeIt[i], scanned++)
+            {
+                const VertexID& v = *edgeIt[i];
+                if(cores.at(v) < level)
                 {
-                    T.insert(shellNodes[level][vertexToCC[neighbor]]);
-                    parents.insert(shellNodes[level][vertexToCC[neighbor]]);
+                    continue;
                 }
-                else if(vertexToCC.find(neighbor) != vertexToCC.end())
+                auto it = owner.find(v);
+                if(it == owner.end())
                 {
-                    ShellNode* neighborCC = shellNodes[cores.at(neighbor)][vertexToCC[neighbor]];
-                    while(neighborCC->parent != nullptr)
-                    {
-                        neighborCC = neighborCC->parent;
-                    }
-                    T.insert(neighborCC);
-                    if(neighborCC->coreLevel == level)
-                    {
-                        parents.insert(neighborCC);
-                    }
+                    owner[v] = i;
+                    pieces[i].emplace_back(v);
+                    frontiers[i].emplace_back(v);
+                    continue;
                 }
+                uint j = findSearch(it->second);
+                if(j == i)
+                {
+                    continue;
+                }
+                // 两个搜索相遇，小的并入大的，小的搜索正在扩展的节点由大的重新扫描
+                uint big = pieces[i].size() >= pieces[j].size() ? i : j;
+                uint small = big == i ? j : i;
+                searchParent[small] = big;
+                pieces[big].insert(pieces[big].end(), pieces[small].begin(), pieces[small].end());
+                frontiers[big].insert(frontiers[big].end(), frontiers[small].begin() + heads[small], frontiers[small].end());
+                std::vector<VertexID>().swap(pieces[small]);
+                std::vector<VertexID>().swap(frontiers[small]);
+                --active;
+                if(small == i)
+                {
+                    merged = true;
+                    break;
+                }
+            }
+            if(!merged && edgeIt[i] == neighbors.end())
+            {
+                ++heads[i];
+                scanning[i] = false;
+            }
+        }
+    }
+    if(active == 0 && !result.empty()) // 所有搜索都结束时，最大的连通块留在原处
+    {
+        auto largest = std::max_element(result.begin(), result.end(), [](const std::vector<VertexID>& a, const std::vector<VertexID>& b){return a.size() < b.size();});
+        result.erase(largest);
+    }
+    return result;
+}
+
+void ShellTree::extractPiece(const std::unordered_map<VertexID, uint>& cores, const std::vector<VertexID>& piece, uint level)
+{
+    // 将piece从所在的level层连通分量中分出，成为新的level层节点
+    ShellNode* component = levelComponent(getNode(piece.front()), level);
+    ShellNode* node = createNode(level, component->parent);
+    std::vector<ShellNode*> oldNodes;
+    for(const VertexID& vid : piece)
+    {
+        ShellNode* vNode = getNode(vid);
+        if(cores.at(vid) == level)
+        {
+            removeFromNode(vid);
+            addToNode(node, vid);
+            oldNodes.emplace_back(vNode);
+            continue;
+        }
+        while(vNode->parent != nullptr && vNode->parent->coreLevel > level)
+        {
+            vNode = vNode->parent;
+        }
+        if(vNode->parent != node)
+        {
+            oldNodes.emplace_back(vNode->parent);
+            setParent(vNode, node);
+        }
+    }
+    for(ShellNode* oldNode : oldNodes)
+    {
+        if(oldNode != nullptr && oldNode != node && oldNode->vertices.empty() && oldNode->children.empty())
+        {
+            releaseNode(oldNode);
+        }
+    }
+    if(node->vertices.empty()) // piece中没有core恰为level的节点
+    {
+        hollowNodes.insert(node);
+    }
+}
+
+void ShellTree::splitLevel(const Graph& graph, const std::unordered_map<VertexID, uint>& cores, const std::vector<VertexID>& seeds, uint level)
+{
+    // 按当前所在的level层连通分量对种子分组，只有同一分量内的种子需要检查是否仍然连通
+    std::unordered_map<ShellNode*, std::vector<VertexID>> groups;
+    std::unordered_set<VertexID> seen;
+    for(const VertexID& seed : seeds)
+    {
+        if(cores.at(seed) >= level && seen.insert(seed).second)
+        {
+            groups[levelComponent(getNode(seed), level)].emplace_back(seed);
+        }
+    }
+    for(const std::pair<ShellNode* const, std::vector<VertexID>>& group : groups)
+    {
+        if(group.second.size() < 2)
+        {
+            continue;
+        }
+        for(const std::vector<VertexID>& piece : findSplitPieces(graph, cores, group.second, level))
+        {
+            extractPiece(cores, piece, level);
+        }
+    }
+}
+
+void ShellTree::insertUpdate(const Graph& graph, const std::unordered_map<VertexID, uint>& cores, const VertexID& src, const VertexID& dst, const std::vector<VertexID>& VStar, uint K)
+{
+    flatDirty = true;
+    for(const VertexID& vid : {src, dst})
+    {
+        if(vertexToNode.find(vid) == vertexToNode.end()) // 新加入的节点
+        {
+            addToNode(createNode(cores.at(vid), nullptr), vid);
+        }
+    }
+
+    // VStar中的节点升到K+1层，先作为原K层节点的孩子，再与K+1-core中的邻居合并
+    for(const VertexID& w : VStar)
+    {
+        ShellNode* oldNode = getNode(w);
+        removeFromNode(w);
+        addToNode(createNode(K + 1, oldNode), w);
+    }
+    for(const VertexID& w : VStar)
+    {
+        for(const VertexID& neighbor : graph.getVertexNeighbors(w))
+        {
+            if(cores.at(neighbor) >= K + 1)
+            {
+                mergeAlongEdge(cores, w, neighbor);
+            }
+        }
+    }
+
+    mergeAlongEdge(cores, src, dst);
+    compactNodes();
+}
+
+void ShellTree::removeUpdate(const Graph& graph, const std::unordered_map<VertexID, uint>& cores, const VertexID& src, const VertexID& dst, const std::vector<VertexID>& VStar, uint K)
+{
+    flatDirty = true;
+    bool vertexRemoved = false;
+    for(const VertexID& vid : {src, dst})
+    {
+        if(cores.find(vid) == cores.end() && vertexToNode.find(vid) != vertexToNode.end()) // 被删除的节点只有这一条边，删除后不会使其他节点断开
+        {
+            ShellNode* node = getNode(vid);
+            removeFromNode(vid);
+            releaseNode(node);
+            vertexRemoved = true;
+        }
+    }
+    if(vertexRemoved || K == 0)
+    {
+        compactNodes();
+        return ;
+    }
+
+    // VStar中的节点降到K-1层，放入原K层分量所在的K-1层节点中
+    std::vector<VertexID>& seeds = removedSeeds[K];
+    seeds.emplace_back(src);
+    seeds.emplace_back(dst);
+    for(const VertexID& w : VStar)
+    {
+        ShellNode* oldNode = getNode(w);
+        ShellNode* top = levelComponent(oldNode, K - 1);
+        ShellNode* target = top;
+        if(top->coreLevel != K - 1)
+        {
+            target = createNode(K - 1, top->parent);
+            setParent(top, target);
+        }
+        removeFromNode(w);
+        addToNode(target, w);
+        releaseNode(oldNode);
+        for(const VertexID& neighbor : graph.getVertexNeighbors(w))
+        {
+            if(cores.at(neighbor) >= K)
+            {
+                seeds.emplace_back(neighbor);
             }
-            visited.emplace(v);
+        }
+    }
+    removedEdges.emplace_back(src, dst, K);
+}
+
+void ShellTree::removeIsolatedVertex(const VertexID& vid)
+{
+    flatDirty = true;
+    removeFromNode(vid);
+    compactNodes();
+}
 
-            if(parents.size() == 1) // 找到唯一的父节点,只需要将v加入到父节点的集合中即可
+void ShellTree::finishRemove(const Graph& graph, const std::unordered_map<VertexID, uint>& cores)
+{
+    flatDirty = true;
+    /*
+     * 从高到低逐层修复：K层分量可能因为边删除和VStar离开分裂成多块，种子为两端点和VStar在K-core中的邻居；
+     * 更低的层只可能因为边删除而分裂，种子为两端点，某层两端点仍连通时更低的层也连通，这条边不再需要检查。
+     * 每一块分裂出去的连通块都必然包含种子，所以每层处理完后该层的分量与图一致。
+     */
+    uint maxLevel = 0;
+    for(const std::tuple<VertexID, VertexID, uint>& edge : removedEdges)
+    {
+        maxLevel = std::max(maxLevel, std::get<2>(edge));
+    }
+    std::vector<std::tuple<VertexID, VertexID, uint>> activeEdges(removedEdges.begin(), removedEdges.end());
+    for(uint level = maxLevel + 1; level > 0 && !activeEdges.empty(); level--)
+    {
+        uint curLevel = level - 1;
+        std::vector<VertexID> seeds;
+        auto seedIt = removedSeeds.find(curLevel);
+        if(seedIt != removedSeeds.end())
+        {
+            seeds.swap(seedIt->second);
+        }
+        for(const std::tuple<VertexID, VertexID, uint>& edge : activeEdges)
+        {
+            if(std::get<2>(edge) > curLevel)
             {
-                ShellNode* parent = *parents.begin();
-                parent->vertices.emplace_back(v);
-                vertexToCC[v] = parent->id;
-                for(ShellNode* t : T)
-                {
-                    if(t->id != parent->id)
-                    {
-                        if(t->parent != nullptr)
-                        {
-                            t->parent->children.erase(t);
-                        }
-                        t->parent = parent;
-                        parent->children.insert(t);
-                    }
-                }
+                seeds.emplace_back(std::get<0>(edge));
+                seeds.emplace_back(std::get<1>(edge));
+            }
+        }
+        splitLevel(graph, cores, seeds, curLevel);
+
+        std::vector<std::tuple<VertexID, VertexID, uint>> stillActive;
+        for(const std::tuple<VertexID, VertexID, uint>& edge : activeEdges)
+        {
+            VertexID src = std::get<0>(edge);
+            VertexID dst = std::get<1>(edge);
+            if(std::get<2>(edge) >= curLevel && cores.at(src) >= curLevel && cores.at(dst) >= curLevel
+                && levelComponent(getNode(src), curLevel) == levelComponent(getNode(dst), curLevel))
+            {
+                continue;
             }
-            else // 找到多个父节点或无父节点,需要新建一个节点作为这些父节点的父节点
+            stillActive.emplace_back(edge);
+        }
+        activeEdges.swap(stillActive);
+    }
+    removedEdges.clear();
+    removedSeeds.clear();
+    compactNodes();
+}
+
+bool ShellTree::isReady() const
+{
+    return removedEdges.empty() && removedSeeds.empty();
+}
+
+void ShellTree::flatten()
+{
+    flatVertices.clear();
+    flatVertices.reserve(vertexToNode.size());
+    std::vector<std::pair<ShellNode*, std::unordered_set<ShellNode*>::const_iterator>> stack;
+    for(const std::pair<const uint, std::vector<ShellNode*>>& level : shellNodes)
+    {
+        for(ShellNode* root : level.second)
+        {
+            if(root == nullptr || root->parent != nullptr)
+            {
+                continue;
+            }
+            root->start = flatVertices.size();
+            flatVertices.insert(flatVertices.end(), root->vertices.begin(), root->vertices.end());
+            stack.emplace_back(root, root->children.begin());
+            while(!stack.empty())
             {
-                ShellNode* newNode = new ShellNode(shellNodes[level].size(), level, nullptr);
-                newNode->vertices.emplace_back(v);
-                vertexToCC[v] = newNode->id;
-                shellNodes[level].emplace_back(newNode);
-                for(ShellNode* t : T)
+                ShellNode* node = stack.back().first;
+                if(stack.back().second == node->children.end())
                 {
-                    if(t->parent != nullptr)
-                    {
-                        t->parent->children.erase(t);
-                    }
-                    t->parent = newNode;
-                    newNode->children.insert(t);
+                    node->end = flatVertices.size();
+                    stack.pop_back();
+                    continue;
                 }
+                ShellNode* child = *stack.back().second;
+                ++stack.back().second;
+                child->start = flatVertices.size();
+                flatVertices.insert(flatVertices.end(), child->vertices.begin(), child->vertices.end());
+                stack.emplace_back(child, child->children.begin());
             }
         }
     }
+    flatDirty = false;
+}
+
+void ShellTree::prepareQuery()
+{
+    if(flatDirty)
+    {
+        flatten();
+    }
+}
+
+std::pair<const VertexID*, const VertexID*> ShellTree::kcoreRange(const VertexID& queryV, const uint& k) const
+{
+    if(flatDirty)
+    {
+        std::cerr << "ShellTree Error: tree changed since the last prepareQuery" << std::endl;
+        throw std::runtime_error("ShellTree Error: tree changed since the last prepareQuery");
+    }
+    ShellNode* curNode = getNode(queryV);
+    if(curNode->coreLevel < k)
+    {
+        return std::make_pair(flatVertices.data(), flatVertices.data());
+    }
+    // 向上找到层级仍不小于k的最高祖先，其子树即为包含queryV的连通k-core
+    while(curNode->parent != nullptr && curNode->parent->coreLevel >= k)
+    {
+        curNode = curNode->parent;
+    }
+    return std::make_pair(flatVertices.data() + curNode->start, flatVertices.data() + curNode->end);
+}
+
+void ShellTree::takeChanges(std::vector<uint>& nodes, std::vector<VertexID>& vertices)
+{
+    nodes.insert(nodes.end(), dirtyHandles.begin(), dirtyHandles.end());
+    vertices.insert(vertices.end(), movedVertices.begin(), movedVertices.end());
+    dirtyHandles.clear();
+    movedVertices.clear();
+}
+
+uint ShellTree::getHandleNum() const
+{
+    return handleNodes.size();
 }
 
-void ShellTree::traverseShellNode(ShellNode* node, std::unordered_set<VertexID>& vertices)
+uint ShellTree::getHandle(const VertexID& vid) const
 {
-    for(const VertexID& v : node->vertices)
+    auto it = vertexToNode.find(vid);
+    return it == vertexToNode.end() ? FrozenShellNode::NONE : it->second->handle;
+}
+
+std::shared_ptr<const FrozenShellNode> ShellTree::freezeNode(uint handle) const
+{
+    if(handle >= handleNodes.size() || handleNodes[handle] == nullptr)
+    {
+        return nullptr;
+    }
+    const ShellNode* node = handleNodes[handle];
+    std::shared_ptr<FrozenShellNode> frozen = std::make_shared<FrozenShellNode>();
+    frozen->coreLevel = node->coreLevel;
+    frozen->id = node->id;
+    frozen->parent = node->parent == nullptr ? FrozenShellNode::NONE : node->parent->handle;
+    frozen->children.reserve(node->children.size());
+    for(const ShellNode* child : node->children)
     {
-        vertices.emplace(v);
+        frozen->children.emplace_back(child->handle);
     }
+    frozen->vertices = node->vertices;
+    return frozen;
+}
 
-    for(ShellNode* child : node->children)
+void ShellTree::importFlat(const std::vector<VertexID>& vertices, const std::vector<FlatShellNode>& nodes)
+{
+    if(!vertexToNode.empty() || !shellNodes.empty())
     {
-        traverseShellNode(child, vertices);
+        std::cerr << "ShellTree Error: importFlat requires an empty tree" << std::endl;
+        throw std::runtime_error("ShellTree Error: importFlat requires an empty tree");
     }
+    for(const FlatShellNode& flat : nodes)
+    {
+        if(flat.start > flat.end || flat.end > vertices.size() || flat.handle == FrozenShellNode::NONE)
+        {
+            std::cerr << "ShellTree Error: invalid flat shell node " << flat.handle << std::endl;
+            throw std::runtime_error("ShellTree Error: invalid flat shell tree");
+        }
+        if(handleNodes.size() <= flat.handle)
+        {
+            handleNodes.resize(flat.handle + 1, nullptr);
+        }
+        std::vector<ShellNode*>& level = shellNodes[flat.coreLevel];
+        if(level.size() <= flat.id)
+        {
+            level.resize(flat.id + 1, nullptr); // 已经释放的id保持为空，新节点继续从末尾分配
+        }
+        if(level[flat.id] != nullptr || handleNodes[flat.handle] != nullptr)
+        {
+            std::cerr << "ShellTree Error: duplicated shell node (" << flat.coreLevel << ", " << flat.id << ")" << std::endl;
+            throw std::runtime_error("ShellTree Error: invalid flat shell tree");
+        }
+        ShellNode* node = new ShellNode(flat.id, flat.coreLevel, nullptr);
+        node->handle = flat.handle;
+        level[flat.id] = node;
+        handleNodes[flat.handle] = node;
+        dirtyHandles.insert(flat.handle);
+    }
+    for(uint handle = handleNodes.size(); handle-- > 0; )
+    {
+        if(handleNodes[handle] == nullptr)
+        {
+            freeHandles.emplace_back(handle);
+        }
+    }
+    vertexToNode.reserve(vertices.size());
+    vertexPos.reserve(vertices.size());
+    for(const FlatShellNode& flat : nodes)
+    {
+        ShellNode* node = handleNodes[flat.handle];
+        if(flat.parent != FrozenShellNode::NONE)
+        {
+            if(flat.parent >= handleNodes.size() || handleNodes[flat.parent] == nullptr)
+            {
+                std::cerr << "ShellTree Error: shell node " << flat.handle << " has no parent " << flat.parent << std::endl;
+                throw std::runtime_error("ShellTree Error: invalid flat shell tree");
+            }
+            setParent(node, handleNodes[flat.parent]);
+        }
+        for(uint i = flat.start; i < flat.end; i++)
+        {
+            if(vertexToNode.find(vertices[i]) != vertexToNode.end())
+            {
+                std::cerr << "ShellTree Error: vertex " << vertices[i] << " is in more than one shell node" << std::endl;
+                throw std::runtime_error("ShellTree Error: invalid flat shell tree");
+            }
+            addToNode(node, vertices[i]);
+        }
+    }
+    flatDirty = true;
 }
 
 std::chrono::milliseconds ShellTree::query(const Graph& graph, const VertexID& queryV, const uint& queryVCore, const uint& k)
 {
     auto start = std::chrono::high_resolution_clock::now();
-    std::unordered_set<VertexID> vertexset;
-    uint CCID = vertexToCC.at(queryV);
-    ShellNode* queryCC = shellNodes.at(queryVCore).at(CCID);
-
     if(queryVCore < k)
     {
         std::cerr << "No satisfied " << k << "-core graph for Vertex "<< queryV << std::endl;
@@ -160,15 +855,10 @@ std::chrono::milliseconds ShellTree::query(const Graph& graph, const VertexID& q
         return duration;
     }
 
-    ShellNode* curNode = queryCC;
-    while(curNode->coreLevel >= k && curNode->parent != nullptr)
-    {
-        curNode = curNode->parent;
-    }
-
-    traverseShellNode(curNode, vertexset);
+    prepareQuery();
+    std::pair<const VertexID*, const VertexID*> range = kcoreRange(queryV, k);
 
-    std::cout << "vertexset size: " << vertexset.size() << std::endl;
+    std::cout << "vertexset size: " << range.second - range.first << std::endl;
 
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
@@ -20,8 +20,19 @@ MbpNode::MbpNode(MbpNode* _parent, MbpNode* _prev, MbpNode* _next, bool _isLeaf)
     }
 }
 
+MbpNode::MbpNode(std::shared_ptr<const FrozenMbpNode> _frozen, MbpNode* _parent, MbpNode* _prev)
+    : MbpNode(_parent, _prev, nullptr, _frozen->isLeaf)
+{
+    keys = _frozen->keys;
+    vertexDigests = _frozen->vertexDigests;
+    memcpy(digest, _frozen->digest, SHA256_DIGEST_LENGTH);
+    isDigestComputed = true;
+    frozen = _frozen;
+}
+
 MbpNode::~MbpNode(){}
 
+
 uint MbpNode::indexofChild(const uint& key) const
 {
     auto it = std::lower_bound(keys.begin(), keys.end(), key); // 返回指向第一个大于等于 key 的迭代器
@@ -170,28 +181,23 @@ std::array<unsigned char, SHA256_DIGEST_LENGTH> MbpNode::getVertexDigest(const V
 //     }
 // }
 
-void MbpNode::setVertexDigest(const VertexID& vid, const std::array<unsigned char, SHA256_DIGEST_LENGTH>& _digest)
+void MbpNode::setVertexDigest(const VertexID& vid, const unsigned char* _digest)
 {
     uint i = indexofChild(vid);
     if(!hasKey(vid))
     {
         keys.insert(keys.begin() + i, vid);
-        vertexDigests.insert(vertexDigests.begin() + i, _digest);
+        vertexDigests.emplace(vertexDigests.begin() + i);
     }
     else
     {
-        vertexDigests[i - 1] = _digest;
+        i--;
     }
+    memcpy(vertexDigests[i].data(), _digest, SHA256_DIGEST_LENGTH);
 }
 
-void MbpNode::getDigest(unsigned char* _digest)
+void MbpNode::getDigest(unsigned char* _digest) const
 {
-    // if(isDigestComputed == false)
-    // {
-    //     digestCompute();
-    //     isDigestComputed = true;
-    // }
-    digestCompute();
     memcpy(_digest, digest, SHA256_DIGEST_LENGTH);
 }
 
@@ -202,6 +208,7 @@ void MbpNode::setFalseDigestComputed()
         parent->setFalseDigestComputed();
     }
     isDigestComputed = false;
+    frozen.reset();
 }
 
 void MbpNode::digestCompute()
@@ -219,71 +226,118 @@ void MbpNode::digestCompute()
     }
     else
     {
-        unsigned char childDigest[SHA256_DIGEST_LENGTH];
         for(int i = 0; i < children.size(); i++)
         {
-            memset(childDigest, 0, SHA256_DIGEST_LENGTH);
-            children[i]->getDigest(childDigest);
-            SHA256_Update(&ctx, childDigest, SHA256_DIGEST_LENGTH);
+            if(!children[i]->isDigestComputed)
+            {
+                children[i]->digestCompute();
+            }
+            SHA256_Update(&ctx, children[i]->digest, SHA256_DIGEST_LENGTH);
         }
     }
     SHA256_Final(digest, &ctx);
+    isDigestComputed = true;
 }
 
-void MbpNode::constructVO(std::vector<VOEntry>& vo, std::vector<VertexID>& subgraphVids, const std::map<VertexID, std::string>& serializedVertexInfo)
+std::shared_ptr<const FrozenMbpNode> MbpNode::freeze()
 {
-    VOEntry entryFront('[');
-    VOEntry entryBack(']');
-    vo.push_back(entryFront);
-    if(isLeafNode())
+    if(frozen != nullptr)
+    {
+        return frozen;
+    }
+    std::shared_ptr<FrozenMbpNode> node = std::make_shared<FrozenMbpNode>();
+    node->isLeaf = isLeaf;
+    node->keys = keys;
+    memcpy(node->digest, digest, SHA256_DIGEST_LENGTH);
+    if(isLeaf)
+    {
+        node->vertexDigests = vertexDigests;
+    }
+    else
+    {
+        node->children.reserve(children.size());
+        for(MbpNode* child : children)
+        {
+            node->children.emplace_back(child->freeze());
+        }
+    }
+    frozen = node;
+    return frozen;
+}
+
+void FrozenMbpNode::constructVO(std::vector<VOEntry>& vo, std::vector<VertexID>& subgraphVids, const std::map<VertexID, std::string>& serializedVertexInfo, VOEntry::DataType payloadType) const
+{
+    VectorVOSink sink(vo);
+    VOTarget target{subgraphVids.data(), subgraphVids.data() + subgraphVids.size(), [&serializedVertexInfo](const VertexID& vid) -> const std::string&
+    {
+        return serializedVertexInfo.at(vid);
+    }, payloadType, &sink};
+    constructSharedVO(std::vector<VOTarget*>(1, &target));
+    subgraphVids.clear();
+}
+
+void FrozenMbpNode::constructSharedVO(const std::vector<VOTarget*>& targets) const
+{
+    for(VOTarget* target : targets)
+    {
+        target->sink->special('[');
+    }
+    if(isLeaf)
     {
         for(size_t i = 0; i < keys.size(); i++)
         {
-            if(subgraphVids.size() > 0 && keys[i] == subgraphVids.front())
-            {
-                vo.emplace_back(VOEntry(serializedVertexInfo.at(keys[i])));
-                subgraphVids.erase(subgraphVids.begin());
-            }
-            else
+            for(VOTarget* target : targets)
             {
-                vo.emplace_back(VOEntry(getVertexDigest(keys[i]).data(), SHA256_DIGEST_LENGTH));
+                if(target->first != target->last && *target->first == keys[i])
+                {
+                    target->sink->payload(target->payloadOf(keys[i]), target->payloadType);
+                    target->first++;
+                }
+                else
+                {
+                    target->sink->digest(vertexDigests[i].data());
+                }
             }
         }
     }
     else
     {
-        for(size_t i = 0; i < keys.size(); i++)
+        std::vector<VOTarget*> reaching;
+        std::vector<const VertexID*> lasts;
+        for(size_t i = 0; i <= keys.size(); i++)
         {
-            
-            std::vector<VertexID> nodePartVids;
-            while(subgraphVids.size() > 0 && subgraphVids.front() < keys[i])
-            {
-                nodePartVids.emplace_back(subgraphVids.front());
-                subgraphVids.erase(subgraphVids.begin());
-            }
-            if(nodePartVids.size() > 0)
+            // 子图中小于keys[i]的节点属于第i个孩子，其余子图只需要这个孩子的摘要
+            reaching.clear();
+            lasts.clear();
+            for(VOTarget* target : targets)
             {
-                children[i]->constructVO(vo, nodePartVids, serializedVertexInfo);
+                const VertexID* partEnd = i == keys.size() ? target->last : std::lower_bound(target->first, target->last, keys[i]);
+                if(partEnd != target->first)
+                {
+                    reaching.emplace_back(target);
+                    lasts.emplace_back(target->last);
+                    target->last = partEnd;
+                }
+                else
+                {
+                    target->sink->digest(children[i]->digest);
+                }
             }
-            else
+            if(!reaching.empty())
             {
-                unsigned char childDigest[SHA256_DIGEST_LENGTH];
-                children[i]->getDigest(childDigest);
-                vo.emplace_back(VOEntry(childDigest, SHA256_DIGEST_LENGTH));
+                children[i]->constructSharedVO(reaching);
+                for(size_t j = 0; j < reaching.size(); j++)
+                {
+                    reaching[j]->first = reaching[j]->last; // 叶子中不存在的节点与原来一样被跳过
+                    reaching[j]->last = lasts[j];
+                }
             }
         }
-        if(subgraphVids.size() > 0)
-        {
-            children[keys.size()]->constructVO(vo, subgraphVids, serializedVertexInfo);
-        }
-        else
-        {
-            unsigned char childDigest[SHA256_DIGEST_LENGTH];
-            children[keys.size()]->getDigest(childDigest);
-            vo.emplace_back(VOEntry(childDigest, SHA256_DIGEST_LENGTH));
-        }
     }
-    vo.push_back(entryBack);
+    for(VOTarget* target : targets)
+    {
+        target->sink->special(']');
+    }
 }
 
 void MbpNode::printNodeInfo()
@@ -35,6 +35,57 @@ MbpNode* MbpTree::getRoot() const
     return root;
 }
 
+uint MbpTree::getMaxCapacity() const
+{
+    return maxCapacity;
+}
+
+MbpNode* MbpTree::thawTree(std::shared_ptr<const FrozenMbpNode> frozen, MbpNode* parent, MbpNode*& lastLeaf, uint level)
+{
+    if(frozen->isLeaf)
+    {
+        if(frozen->keys.size() != frozen->vertexDigests.size())
+        {
+            std::cerr << "MbpTree Error: leaf has " << frozen->keys.size() << " keys but " << frozen->vertexDigests.size() << " digests" << std::endl;
+            throw std::runtime_error("MbpTree Error: invalid frozen leaf");
+        }
+        depth = std::max(depth, level);
+        lastLeaf = new MbpNode(frozen, parent, lastLeaf);
+        return lastLeaf;
+    }
+    if(frozen->children.size() != frozen->keys.size() + 1)
+    {
+        std::cerr << "MbpTree Error: internal node has " << frozen->keys.size() << " keys but " << frozen->children.size() << " children" << std::endl;
+        throw std::runtime_error("MbpTree Error: invalid frozen internal node");
+    }
+    MbpNode* node = new MbpNode(frozen, parent, nullptr);
+    node->children.reserve(frozen->children.size());
+    for(const std::shared_ptr<const FrozenMbpNode>& child : frozen->children)
+    {
+        node->children.emplace_back(thawTree(child, node, lastLeaf, level + 1));
+    }
+    return node;
+}
+
+void MbpTree::restore(std::shared_ptr<const FrozenMbpNode> frozenRoot)
+{
+    uint oldDepth = depth;
+    depth = 0;
+    MbpNode* lastLeaf = nullptr;
+    MbpNode* newRoot = nullptr;
+    try
+    {
+        newRoot = thawTree(frozenRoot, nullptr, lastLeaf, 0);
+    }
+    catch(...)
+    {
+        depth = oldDepth; // 还原失败时保留原来的树
+        throw;
+    }
+    deleteTree(root);
+    root = newRoot;
+}
+
 MbpNode* MbpTree::findLeaf(uint key) const
 {
     MbpNode* node = root;
@@ -66,10 +117,11 @@ std::array<unsigned char, SHA256_DIGEST_LENGTH> MbpTree::getVertexDigest(const V
 //     }
 // }
 
-void MbpTree::setVertexDigest(const VertexID& vid, const std::array<unsigned char, SHA256_DIGEST_LENGTH>& _digest)
+void MbpTree::setVertexDigest(const VertexID& vid, const unsigned char* _digest)
 {
     MbpNode* leaf = findLeaf(vid);
     leaf->setVertexDigest(vid, _digest); // 如果key存在，则更新value；否则，插入新节点
+    leaf->setFalseDigestComputed();
     // 如果叶节点超出最大容量
     if(leaf->keys.size() > maxCapacity)
     {
@@ -155,6 +207,8 @@ void MbpTree::borrowKeyfromRightLeaf(MbpNode* node, MbpNode* next)
     // next->values.erase(next->values.begin()); // 删除右侧节点的对应的value
     node->vertexDigests.push_back(next->vertexDigests.front());
     next->vertexDigests.erase(next->vertexDigests.begin());
+    node->setFalseDigestComputed();
+    next->setFalseDigestComputed();
     for(int i = 0; i < parent->children.size(); i++)
     {
         if(parent->children[i] == next)
@@ -174,9 +228,11 @@ void MbpTree::borrowKeyfromLeftLeaf(MbpNode* node, MbpNode* prev)
     // prev->values.erase(prev->values.end() - 1);
     node->vertexDigests.insert(node->vertexDigests.begin(), prev->vertexDigests.back());
     prev->vertexDigests.erase(prev->vertexDigests.end() - 1);
+    node->setFalseDigestComputed();
+    prev->setFalseDigestComputed();
     for(int i = 0; i < parent->children.size(); i++)
     {
-        if(parent->children[i] == node);
+        if(parent->children[i] == node)
         {
             parent->keys[i - 1] = node->keys.front(); // 更新父节点的key
             break;
@@ -195,6 +251,7 @@ void MbpTree::mergeNodewithRightLeaf(MbpNode* node, MbpNode* next)
     node->keys.insert(node->keys.end(), next->keys.begin(), next->keys.end()); // 将右侧节点的key合并到当前节点
     // node->values.insert(node->values.end(), next->values.begin(), next->values.end()); // 将右侧节点的value值合并到当前节点
     node->vertexDigests.insert(node->vertexDigests.end(), next->vertexDigests.begin(), next->vertexDigests.end());
+    node->setFalseDigestComputed();
     node->setNext(next->getNext()); // 更新当前节点的next指针
 
     if(node->getNext() != nullptr) // 不是最后一个节点
@@ -221,6 +278,7 @@ void MbpTree::mergeNodewithLeftLeaf(MbpNode* node, MbpNode* prev)
     prev->keys.insert(prev->keys.end(), node->keys.begin(), node->keys.end()); // 将当前节点的key合并到左侧节点
     // prev->values.insert(prev->values.end(), node->values.begin(), node->values.end()); // 将当前节点的value值合并到左侧节点
     prev->vertexDigests.insert(prev->vertexDigests.end(), node->vertexDigests.begin(), node->vertexDigests.end());
+    prev->setFalseDigestComputed();
     prev->setNext(node->getNext()); // 更新左侧节点的next指针
 
     if(prev->getNext() != nullptr)
@@ -250,6 +308,8 @@ void MbpTree::borrowKeyfromRightInternal(int posinParent, MbpNode* node, MbpNode
     node->children.insert(node->children.end(), next->children.front()); // 从右侧节点借用右孩子
     next->children.erase(next->children.begin());
     node->children.back()->setParent(node); // 设置右孩子的父节点为node
+    node->setFalseDigestComputed();
+    next->setFalseDigestComputed();
 }
 
 void MbpTree::borrowKeyfromLeftInternal(int posinParent, MbpNode* node, MbpNode* prev)
@@ -261,6 +321,8 @@ void MbpTree::borrowKeyfromLeftInternal(int posinParent, MbpNode* node, MbpNode*
     node->children.insert(node->children.begin(), prev->children.back()); // 从左侧节点借用左孩子
     prev->children.erase(prev->children.end() - 1);
     node->children.front()->setParent(node); // 设置左孩子的父节点为node
+    node->setFalseDigestComputed();
+    prev->setFalseDigestComputed();
 }
 
 void MbpTree::mergeNodewithRightInternal(int posinParent, MbpNode* node, MbpNode* next)
@@ -275,6 +337,7 @@ void MbpTree::mergeNodewithRightInternal(int posinParent, MbpNode* node, MbpNode
     {
         child->setParent(node); // 设置孩子节点的父节点为node
     }
+    node->setFalseDigestComputed();
 
     delete next; // 删除next节点,防止内存泄漏
 }
@@ -291,6 +354,7 @@ void MbpTree::mergeNodewithLeftInternal(int posinParent, MbpNode* node, MbpNode*
     {
         child->setParent(prev);
     }
+    prev->setFalseDigestComputed();
 
     delete node; // 删除当前节点,防止内存泄漏
 }
@@ -300,6 +364,11 @@ void MbpTree::remove(uint key, MbpNode* node)
     if(node == nullptr)
     {
         node = findLeaf(key);
+        if(!node->hasKey(key)) // key不在树中时不修改树，也不标记摘要
+        {
+            return ;
+        }
+        node->setFalseDigestComputed();
     }
     if(node->isLeafNode())
     {
@@ -320,6 +389,7 @@ void MbpTree::remove(uint key, MbpNode* node)
             {
                 root = root->children.front();
                 root->setParent(nullptr);
+                root->setFalseDigestComputed();
                 depth--;
             }
             return ;
@@ -406,9 +476,15 @@ void MbpTree::remove(uint key, MbpNode* node)
     }
 }
 
-void MbpTree::constructVO(std::vector<VOEntry>& vo, std::vector<VertexID> subgraphVids, const std::map<VertexID, std::string>& serializedVertexInfo)
+void MbpTree::digestCompute()
+{
+    root->digestCompute(); // 根节点总是重新计算，子树中只有被标记的节点会重新计算
+}
+
+std::shared_ptr<const FrozenMbpNode> MbpTree::freeze()
 {
-    root->constructVO(vo, subgraphVids, serializedVertexInfo);
+    digestCompute();
+    return root->freeze();
 }
 
 void MbpTree::printMbpTreeInfo(MbpNode* node, std::string _prefix, bool _last)
@@ -116,7 +116,7 @@ std::shared_ptr<TreeNode> OSTree::insertFront(std::shared_ptr<TreeNode> node, Ve
 {
     if (node == nullptr)
     {
-        std::shared_ptr<TreeNode> newNode(new TreeNode(vid));
+        std::shared_ptr<TreeNode> newNode(new TreeNode(vid, parent));
         node_map[vid] = newNode;
         return newNode;
     }
@@ -146,6 +146,27 @@ std::shared_ptr<TreeNode> OSTree::insertBack(std::shared_ptr<TreeNode> node, Ver
     return balance(node, false);
 }
 
+std::shared_ptr<TreeNode> OSTree::insertAt(std::shared_ptr<TreeNode> node, VertexID vid, uint vRank, std::shared_ptr<TreeNode> parent)
+{
+    if (node == nullptr)
+    {
+        std::shared_ptr<TreeNode> newNode(new TreeNode(vid, parent));
+        node_map[vid] = newNode;
+        return newNode;
+    }
+
+    uint leftSize = node->left ? node->left->size : 0;
+    if(vRank <= leftSize + 1)
+    {
+        node->left = insertAt(node->left, vid, vRank, node);
+    }
+    else
+    {
+        node->right = insertAt(node->right, vid, vRank - leftSize - 1, node);
+    }
+    return rebalance(node);
+}
+
 std::shared_ptr<TreeNode> OSTree::minValueNode(std::shared_ptr<TreeNode> node)
 {
     std::shared_ptr<TreeNode> current = node;
@@ -274,7 +295,7 @@ uint OSTree::rank(std::shared_ptr<TreeNode> node) const
     return vRank;
 }
 
-void OSTree::getVertexes(std::shared_ptr<TreeNode> node, std::vector<VertexID> &vids)
+void OSTree::getVertexes(std::shared_ptr<TreeNode> node, std::vector<VertexID> &vids) const
 {
     if (node == nullptr)
     {
@@ -306,7 +327,7 @@ void OSTree::inOrderTraversal(std::shared_ptr<TreeNode> node) const
     inOrderTraversal(node->right);
 }
 
-std::shared_ptr<TreeNode> OSTree::buildTree(std::vector<VertexID> &vids, int start, int end, std::shared_ptr<TreeNode> parent)
+std::shared_ptr<TreeNode> OSTree::buildTree(const std::vector<VertexID> &vids, int start, int end, std::shared_ptr<TreeNode> parent)
 {
     if(start > end)
     {
@@ -316,7 +337,11 @@ std::shared_ptr<TreeNode> OSTree::buildTree(std::vector<VertexID> &vids, int sta
     int mid = (start + end) / 2;
 
     std::shared_ptr<TreeNode> node = std::make_shared<TreeNode>(vids[mid], parent);
-    node_map[vids[mid]] = node;
+    if(!node_map.emplace(vids[mid], node).second)
+    {
+        std::cerr << "OSTree Error: vertex " << vids[mid] << " already in tree" << std::endl;
+        throw std::runtime_error("OSTree Error: vertex already in tree");
+    }
     node->left = buildTree(vids, start, mid - 1, node);
     node->right = buildTree(vids, mid + 1, end, node);
     updateSize(node);
@@ -325,11 +350,118 @@ std::shared_ptr<TreeNode> OSTree::buildTree(std::vector<VertexID> &vids, int sta
     return node;
 }
 
+std::shared_ptr<TreeNode> OSTree::rebalance(std::shared_ptr<TreeNode> node)
+{
+    node->height = std::max(getHeight(node->left), getHeight(node->right)) + 1;
+    updateSize(node);
+
+    int balanceFactor = getBalanceFactor(node);
+    if(balanceFactor > 1)
+    {
+        if(getBalanceFactor(node->left) < 0)
+        {
+            node->left = leftRotate(node->left);
+        }
+        return rightRotate(node);
+    }
+    if(balanceFactor < -1)
+    {
+        if(getBalanceFactor(node->right) > 0)
+        {
+            node->right = rightRotate(node->right);
+        }
+        return leftRotate(node);
+    }
+    return node;
+}
+
+std::shared_ptr<TreeNode> OSTree::joinRight(std::shared_ptr<TreeNode> left, std::shared_ptr<TreeNode> pivot, std::shared_ptr<TreeNode> right)
+{
+    if(getHeight(left) <= getHeight(right) + 1)
+    {
+        pivot->left = left;
+        pivot->right = right;
+        if(left != nullptr)
+        {
+            left->parent = pivot;
+        }
+        if(right != nullptr)
+        {
+            right->parent = pivot;
+        }
+        pivot->height = std::max(getHeight(left), getHeight(right)) + 1;
+        updateSize(pivot);
+        return pivot;
+    }
+
+    std::shared_ptr<TreeNode> subTree = joinRight(left->right, pivot, right);
+    left->right = subTree;
+    subTree->parent = left;
+    return rebalance(left);
+}
+
+std::shared_ptr<TreeNode> OSTree::joinLeft(std::shared_ptr<TreeNode> left, std::shared_ptr<TreeNode> pivot, std::shared_ptr<TreeNode> right)
+{
+    if(getHeight(right) <= getHeight(left) + 1)
+    {
+        return joinRight(left, pivot, right);
+    }
+
+    std::shared_ptr<TreeNode> subTree = joinLeft(left, pivot, right->left);
+    right->left = subTree;
+    subTree->parent = right;
+    return rebalance(right);
+}
+
+std::shared_ptr<TreeNode> OSTree::join(std::shared_ptr<TreeNode> left, std::shared_ptr<TreeNode> pivot, std::shared_ptr<TreeNode> right)
+{
+    std::shared_ptr<TreeNode> node = getHeight(left) >= getHeight(right) ? joinRight(left, pivot, right) : joinLeft(left, pivot, right);
+    node->parent.reset();
+    return node;
+}
+
 OSTree::OSTree() : root(nullptr) {}
 
-void OSTree::buildTree(std::vector<VertexID> &vids)
+void OSTree::buildTree(const std::vector<VertexID> &vids)
 {
-    root = buildTree(vids, 0, vids.size() - 1);
+    node_map.clear();
+    node_map.reserve(vids.size());
+    root = buildTree(vids, 0, static_cast<int>(vids.size()) - 1);
+}
+
+void OSTree::appendRange(const std::vector<VertexID>& vids)
+{
+    if(vids.empty())
+    {
+        return ;
+    }
+    if(root == nullptr)
+    {
+        buildTree(vids);
+        return ;
+    }
+    // 第一个节点作为合并的枢轴，其余节点先建成平衡子树
+    std::shared_ptr<TreeNode> pivot = buildTree(vids, 0, 0);
+    std::shared_ptr<TreeNode> right = buildTree(vids, 1, static_cast<int>(vids.size()) - 1);
+    root = join(root, pivot, right);
+}
+
+void OSTree::prependRange(const std::vector<VertexID>& vids)
+{
+    if(vids.empty())
+    {
+        return ;
+    }
+    if(root == nullptr)
+    {
+        buildTree(vids);
+        return ;
+    }
+    // 最后一个节点作为合并的枢轴，其余节点先建成平衡子树
+    int last = static_cast<int>(vids.size()) - 1;
+    std::shared_ptr<TreeNode> pivot = buildTree(vids, last, last);
+    std::shared_ptr<TreeNode> left = buildTree(vids, 0, last - 1);
+    root = join(left, pivot, root);
 }
 
 void OSTree::insertFront(const VertexID& vid)
@@ -342,6 +474,16 @@ void OSTree::insertBack(const VertexID& vid)
     root = insertBack(root, vid, nullptr);
 }
 
+void OSTree::insertAfter(const VertexID& anchor, const VertexID& vid)
+{
+    if(node_map.find(vid) != node_map.end())
+    {
+        std::cerr << "OSTree Error: vertex " << vid << " already in tree" << std::endl;
+        throw std::runtime_error("OSTree Error: vertex already in tree");
+    }
+    root = insertAt(root, vid, getRank(anchor) + 1, nullptr);
+}
+
 void OSTree::erase(const VertexID& vid)
 {
     root = erase(root, getRank(vid));
@@ -354,23 +496,24 @@ void OSTree::erase(const VertexID& vid)
     }
 }
 
-uint OSTree::getRank(const VertexID& vid)
+uint OSTree::getRank(const VertexID& vid) const
 { 
     // std::cout << "Get Vertex " << vid << " rank" << std::endl;
-    if(node_map.find(vid) == node_map.end())
+    auto it = node_map.find(vid);
+    if(it == node_map.end())
     {
         std::cerr << "OSTree Error: vertex " << vid << " not found" << std::endl;
         throw std::runtime_error("OSTree Error: vertex not found");
     }
-    if(node_map[vid] == nullptr)
+    if(it->second == nullptr)
     {
         std::cout << "OSTree Warning: vertex " << vid << " not in tree" << std::endl;
     }
-    // std::cout << "Vertex " << vid << " rank is " << rank(node_map[vid]) << std::endl;
-    return rank(node_map[vid]);
+    // std::cout << "Vertex " << vid << " rank is " << rank(it->second) << std::endl;
+    return rank(it->second);
 }
 
-bool OSTree::compare(const VertexID& v1, const VertexID& v2)
+bool OSTree::compare(const VertexID& v1, const VertexID& v2) const
 {
     return getRank(v1) < getRank(v2);
 }
@@ -391,10 +534,10 @@ VertexID OSTree::at(uint index)
     return node->vid;
 }
 
-std::vector<VertexID> OSTree::getVids()
+std::vector<VertexID> OSTree::getVids() const
 {
     std::vector<VertexID> vids;
-    vids.reserve(root->size);
+    vids.reserve(getSize(root));
     getVertexes(root, vids);
     return vids;
 }
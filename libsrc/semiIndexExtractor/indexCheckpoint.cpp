@@ -0,0 +1,486 @@
+#include "semiIndexExtractor/indexCheckpoint.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+IndexCheckpoint::IndexCheckpoint(std::shared_ptr<const IndexSnapshot> _snapshot, const CoreMaintainer& coremaintainer, uint _mbpCapacity)
+    : snapshot(_snapshot), mbpCapacity(_mbpCapacity)
+{
+    if(snapshot == nullptr)
+    {
+        std::cerr << "IndexCheckpoint Error: no published snapshot" << std::endl;
+        throw std::runtime_error("IndexCheckpoint Error: no published snapshot");
+    }
+    if(snapshot->getCoreVersion() != coremaintainer.getVersion())
+    {
+        std::cerr << "IndexCheckpoint Error: snapshot " << snapshot->getVersion() << " does not match the current cores" << std::endl;
+        throw std::runtime_error("IndexCheckpoint Error: snapshot is stale");
+    }
+    vids.reserve(snapshot->getVertexNum());
+    for(size_t key = 0; key < snapshot->chunks.size(); key++)
+    {
+        const SnapshotChunk* chunk = snapshot->chunks[key].get();
+        if(chunk != nullptr)
+        {
+            vids.insert(vids.end(), chunk->vids.begin(), chunk->vids.end());
+        }
+    }
+    coremaintainer.exportState(vids, mcd, degPlus, korders);
+}
+
+uint IndexCheckpoint::getVersion() const
+{
+    return snapshot->getVersion();
+}
+
+const IndexSnapshot& IndexCheckpoint::getSnapshot() const
+{
+    return *snapshot;
+}
+
+void IndexCheckpoint::writeBytes(std::ofstream& out, const void* data, size_t length)
+{
+    out.write((const char*)data, length);
+}
+
+template <typename T>
+void IndexCheckpoint::writeArray(std::ofstream& out, const std::vector<T>& values)
+{
+    uint64_t length = values.size();
+    writeBytes(out, &length, sizeof(length));
+    writeBytes(out, values.data(), values.size() * sizeof(T));
+}
+
+template <typename T, typename F>
+void IndexCheckpoint::writeChunked(std::ofstream& out, const IndexSnapshot& snapshot, uint64_t length, F field)
+{
+    writeBytes(out, &length, sizeof(length));
+    for(size_t key = 0; key < snapshot.chunks.size(); key++)
+    {
+        const SnapshotChunk* chunk = snapshot.chunks[key].get();
+        if(chunk != nullptr)
+        {
+            const std::vector<T>& values = field(*chunk);
+            writeBytes(out, values.data(), values.size() * sizeof(T));
+        }
+    }
+}
+
+void IndexCheckpoint::writeMbpNode(const FrozenMbpNode& node, std::string& buffer, std::ofstream& out)
+{
+    // isLeaf(1) keyNum(4) keys，叶子接着是各个节点的摘要，中间节点接着是孩子数(4)，最后是节点摘要
+    buffer.push_back(node.isLeaf ? 1 : 0);
+    uint keyNum = node.keys.size();
+    buffer.append((const char*)&keyNum, sizeof(keyNum));
+    buffer.append((const char*)node.keys.data(), node.keys.size() * sizeof(uint));
+    if(node.isLeaf)
+    {
+        buffer.append((const char*)node.vertexDigests.data(), node.vertexDigests.size() * SHA256_DIGEST_LENGTH);
+    }
+    else
+    {
+        uint childNum = node.children.size();
+        buffer.append((const char*)&childNum, sizeof(childNum));
+    }
+    buffer.append((const char*)node.digest, SHA256_DIGEST_LENGTH);
+    if(buffer.size() >= CHECKPOINT_BUFFER_SIZE)
+    {
+        writeBytes(out, buffer.data(), buffer.size());
+        buffer.clear();
+    }
+    for(const std::shared_ptr<const FrozenMbpNode>& child : node.children)
+    {
+        writeMbpNode(*child, buffer, out);
+    }
+}
+
+void IndexCheckpoint::write(const std::string& path) const
+{
+    std::string tmpPath = path + ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if(!out.is_open())
+    {
+        std::cerr << "Error: cannot open file " << tmpPath << std::endl;
+        throw std::runtime_error("Error: cannot open file " + tmpPath);
+    }
+
+    const IndexSnapshot& s = *snapshot;
+    bool hasShell = s.shellReady;
+    bool hasMbp = s.mbpRoot != nullptr && mbpCapacity != 0;
+    uint header[4] = {s.version, s.coreVersion, hasMbp ? mbpCapacity : 0, (hasShell ? 1u : 0u) | (hasMbp ? 2u : 0u)};
+    writeBytes(out, CHECKPOINT_MAGIC, std::strlen(CHECKPOINT_MAGIC));
+    writeBytes(out, header, sizeof(header));
+
+    // 节点按编号升序，offsets为全局的CSR偏移，各块的邻居依次相接
+    writeArray(out, vids);
+    writeChunked<uint>(out, s, s.vertexNum, [](const SnapshotChunk& chunk) -> const std::vector<uint>& { return chunk.cores; });
+    std::vector<uint64_t> offsets;
+    offsets.reserve(ChunkedArray<uint>::CHUNK_SIZE + 1);
+    uint64_t offsetNum = s.vertexNum + 1;
+    uint64_t base = 0;
+    writeBytes(out, &offsetNum, sizeof(offsetNum));
+    for(size_t key = 0; key < s.chunks.size(); key++)
+    {
+        const SnapshotChunk* chunk = s.chunks[key].get();
+        if(chunk == nullptr)
+        {
+            continue;
+        }
+        offsets.clear();
+        for(size_t i = 0; i < chunk->vids.size(); i++)
+        {
+            offsets.emplace_back(base + chunk->offsets[i]);
+        }
+        writeBytes(out, offsets.data(), offsets.size() * sizeof(uint64_t));
+        base += chunk->getNeighborNum();
+    }
+    writeBytes(out, &base, sizeof(base));
+    // 压缩的块先解码，检查点中的邻居总是原值
+    std::vector<VertexID> decoded;
+    writeChunked<VertexID>(out, s, s.neighborNum, [&decoded](const SnapshotChunk& chunk) -> const std::vector<VertexID>& {
+        if(!chunk.isPacked())
+        {
+            return chunk.neighbors;
+        }
+        const unsigned char* codes = (const unsigned char*)chunk.codes.data();
+        decoded.clear();
+        for(size_t i = 0; i < chunk.vids.size(); i++)
+        {
+            SnapshotNeighbors neighbors(codes + chunk.codeOffsets[i], codes + chunk.codeOffsets[i + 1], chunk.offsets[i + 1] - chunk.offsets[i]);
+            decoded.insert(decoded.end(), neighbors.begin(), neighbors.end());
+        }
+        return decoded;
+    });
+    writeArray(out, mcd);
+    writeArray(out, degPlus);
+
+    uint64_t levelNum = korders.size();
+    writeBytes(out, &levelNum, sizeof(levelNum));
+    for(const std::pair<uint, std::vector<VertexID>>& korder : korders)
+    {
+        writeBytes(out, &korder.first, sizeof(korder.first));
+        writeArray(out, korder.second);
+    }
+
+    if(hasShell)
+    {
+        // 每个shell node只写出自己的节点，父节点用句柄表示
+        std::vector<FlatShellNode> shellNodes;
+        std::vector<VertexID> shellVertices;
+        shellVertices.reserve(s.vertexNum);
+        for(uint handle = 0; handle < s.shellNodes.size(); handle++)
+        {
+            const FrozenShellNode* node = s.shellNodes[handle].get();
+            if(node == nullptr)
+            {
+                continue;
+            }
+            uint start = shellVertices.size();
+            shellVertices.insert(shellVertices.end(), node->vertices.begin(), node->vertices.end());
+            shellNodes.push_back(FlatShellNode{handle, node->coreLevel, node->id, node->parent, start, (uint)shellVertices.size()});
+        }
+        writeArray(out, shellNodes);
+        writeArray(out, shellVertices);
+    }
+
+    if(hasMbp)
+    {
+        std::string buffer;
+        buffer.reserve(CHECKPOINT_BUFFER_SIZE + 4096);
+        writeMbpNode(*s.mbpRoot, buffer, out);
+        writeBytes(out, buffer.data(), buffer.size());
+    }
+
+    writeBytes(out, CHECKPOINT_MAGIC, std::strlen(CHECKPOINT_MAGIC));
+    out.close();
+    if(out.fail() || !syncFile(tmpPath))
+    {
+        std::remove(tmpPath.c_str());
+        std::cerr << "Error: failed to write checkpoint " << tmpPath << std::endl;
+        throw std::runtime_error("Error: failed to write checkpoint " + tmpPath);
+    }
+    if(std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        std::cerr << "Error: cannot rename " << tmpPath << " to " << path << ": " << std::strerror(errno) << std::endl;
+        throw std::runtime_error("Error: cannot rename checkpoint to " + path);
+    }
+    if(!syncParentDirectory(path))
+    {
+        std::cerr << "Error: cannot sync the directory of " << path << ": " << std::strerror(errno) << std::endl;
+        throw std::runtime_error("Error: cannot sync the directory of " + path);
+    }
+}
+
+void IndexCheckpoint::Cursor::read(void* out, size_t length)
+{
+    if(length > size - pos)
+    {
+        std::cerr << "Error: checkpoint " << filePath << " is truncated at offset " << pos << std::endl;
+        throw std::runtime_error("Error: truncated checkpoint " + filePath);
+    }
+    std::memcpy(out, data + pos, length);
+    pos += length;
+}
+
+template <typename T>
+T IndexCheckpoint::Cursor::readValue()
+{
+    T value;
+    read(&value, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void IndexCheckpoint::Cursor::readArray(std::vector<T>& out)
+{
+    uint64_t length = readValue<uint64_t>();
+    if(length > (size - pos) / sizeof(T))
+    {
+        std::cerr << "Error: checkpoint " << filePath << " is truncated at offset " << pos << std::endl;
+        throw std::runtime_error("Error: truncated checkpoint " + filePath);
+    }
+    out.resize(length);
+    read(out.data(), length * sizeof(T));
+}
+
+std::shared_ptr<const FrozenMbpNode> IndexCheckpoint::readMbpNode(Cursor& cursor, uint level)
+{
+    if(level > MAX_MBP_DEPTH)
+    {
+        std::cerr << "Error: MbpTree in checkpoint " << cursor.filePath << " is deeper than " << MAX_MBP_DEPTH << std::endl;
+        throw std::runtime_error("Error: invalid MbpTree in checkpoint " + cursor.filePath);
+    }
+    std::shared_ptr<FrozenMbpNode> node = std::make_shared<FrozenMbpNode>();
+    node->isLeaf = cursor.readValue<unsigned char>() != 0;
+    uint keyNum = cursor.readValue<uint>();
+    if(keyNum > (cursor.size - cursor.pos) / sizeof(uint))
+    {
+        std::cerr << "Error: checkpoint " << cursor.filePath << " is truncated at offset " << cursor.pos << std::endl;
+        throw std::runtime_error("Error: truncated checkpoint " + cursor.filePath);
+    }
+    node->keys.resize(keyNum);
+    cursor.read(node->keys.data(), keyNum * sizeof(uint));
+    if(node->isLeaf)
+    {
+        if(keyNum > (cursor.size - cursor.pos) / SHA256_DIGEST_LENGTH)
+        {
+            std::cerr << "Error: checkpoint " << cursor.filePath << " is truncated at offset " << cursor.pos << std::endl;
+            throw std::runtime_error("Error: truncated checkpoint " + cursor.filePath);
+        }
+        node->vertexDigests.resize(keyNum);
+        cursor.read(node->vertexDigests.data(), keyNum * SHA256_DIGEST_LENGTH);
+        cursor.read(node->digest, SHA256_DIGEST_LENGTH);
+        return node;
+    }
+    uint childNum = cursor.readValue<uint>();
+    if(childNum != keyNum + 1)
+    {
+        std::cerr << "Error: MbpTree node in checkpoint " << cursor.filePath << " has " << keyNum << " keys but " << childNum << " children" << std::endl;
+        throw std::runtime_error("Error: invalid MbpTree in checkpoint " + cursor.filePath);
+    }
+    cursor.read(node->digest, SHA256_DIGEST_LENGTH);
+    node->children.reserve(childNum);
+    for(uint i = 0; i < childNum; i++)
+    {
+        node->children.emplace_back(readMbpNode(cursor, level + 1));
+    }
+    return node;
+}
+
+uint IndexCheckpoint::restore(const std::string& path, Graph& graph, CoreMaintainer& coremaintainer, ShellTree*& shellTree, MbpTree*& mbptree)
+{
+    if(graph.getVertexNum() != 0)
+    {
+        std::cerr << "Error: checkpoint can only be restored into an empty graph" << std::endl;
+        throw std::runtime_error("Error: checkpoint restored into a non-empty graph");
+    }
+    shellTree = nullptr;
+    mbptree = nullptr;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        std::cerr << "Error: cannot open file " << path << std::endl;
+        throw std::runtime_error("Error: cannot open file " + path);
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        close(fd);
+        std::cerr << "Error: cannot stat file " << path << std::endl;
+        throw std::runtime_error("Error: cannot stat file " + path);
+    }
+    size_t magicLength = std::strlen(CHECKPOINT_MAGIC);
+    size_t size = st.st_size;
+    if(size < magicLength * 2)
+    {
+        close(fd);
+        std::cerr << "Error: " << path << " is not a checkpoint" << std::endl;
+        throw std::runtime_error("Error: not a checkpoint " + path);
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED)
+    {
+        std::cerr << "Error: cannot map file " << path << ": " << std::strerror(errno) << std::endl;
+        throw std::runtime_error("Error: cannot map file " + path);
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    Cursor cursor{(const char*)mapped, size, 0, path};
+
+    uint version = 0;
+    try
+    {
+        if(std::memcmp(cursor.data, CHECKPOINT_MAGIC, magicLength) != 0 || std::memcmp(cursor.data + size - magicLength, CHECKPOINT_MAGIC, magicLength) != 0)
+        {
+            std::cerr << "Error: " << path << " is not a complete checkpoint" << std::endl;
+            throw std::runtime_error("Error: not a checkpoint " + path);
+        }
+        cursor.size -= magicLength; // 文件尾的magic不属于内容
+        cursor.pos = magicLength;
+        uint header[4];
+        cursor.read(header, sizeof(header));
+        version = header[0];
+        uint coreVersion = header[1];
+        uint mbpCapacity = header[2];
+        bool hasShell = (header[3] & 1) != 0;
+        bool hasMbp = (header[3] & 2) != 0;
+
+        std::vector<VertexID> vids, neighbors;
+        std::vector<uint> cores, mcd, degPlus;
+        std::vector<uint64_t> offsets;
+        cursor.readArray(vids);
+        cursor.readArray(cores);
+        cursor.readArray(offsets);
+        cursor.readArray(neighbors);
+        cursor.readArray(mcd);
+        cursor.readArray(degPlus);
+        if(cores.size() != vids.size() || offsets.size() != vids.size() + 1 || offsets.back() != neighbors.size())
+        {
+            std::cerr << "Error: adjacency in checkpoint " << path << " is inconsistent" << std::endl;
+            throw std::runtime_error("Error: invalid checkpoint " + path);
+        }
+
+        std::vector<std::pair<uint, std::vector<VertexID>>> korders(cursor.readValue<uint64_t>());
+        for(std::pair<uint, std::vector<VertexID>>& korder : korders)
+        {
+            korder.first = cursor.readValue<uint>();
+            cursor.readArray(korder.second);
+        }
+
+        std::vector<FlatShellNode> shellNodes;
+        std::vector<VertexID> shellVertices;
+        if(hasShell)
+        {
+            cursor.readArray(shellNodes);
+            cursor.readArray(shellVertices);
+        }
+
+        std::shared_ptr<const FrozenMbpNode> mbpRoot;
+        if(hasMbp)
+        {
+            mbpRoot = readMbpNode(cursor, 0);
+        }
+        if(cursor.pos != cursor.size)
+        {
+            std::cerr << "Error: checkpoint " << path << " has " << cursor.size - cursor.pos << " unexpected bytes" << std::endl;
+            throw std::runtime_error("Error: invalid checkpoint " + path);
+        }
+
+        // 节点摘要保存在MbpTree的叶子中，按编号升序与图中的节点一一对应
+        std::vector<const FrozenMbpNode*> leaves;
+        if(mbpRoot != nullptr)
+        {
+            std::vector<const FrozenMbpNode*> stack(1, mbpRoot.get());
+            while(!stack.empty())
+            {
+                const FrozenMbpNode* node = stack.back();
+                stack.pop_back();
+                if(node->isLeaf)
+                {
+                    leaves.emplace_back(node);
+                    continue;
+                }
+                for(auto it = node->children.rbegin(); it != node->children.rend(); ++it)
+                {
+                    stack.emplace_back(it->get());
+                }
+            }
+        }
+        static const unsigned char emptyDigest[SHA256_DIGEST_LENGTH] = {0};
+        size_t leafIndex = 0, keyIndex = 0;
+        for(size_t i = 0; i < vids.size(); i++)
+        {
+            VertexID vid = vids[i];
+            if(i > 0 && vid <= vids[i - 1])
+            {
+                std::cerr << "Error: vertices in checkpoint " << path << " are not in ascending order at " << vid << std::endl;
+                throw std::runtime_error("Error: invalid checkpoint " + path);
+            }
+            if(offsets[i] > offsets[i + 1] || offsets[i + 1] > neighbors.size())
+            {
+                std::cerr << "Error: adjacency of vertex " << vid << " in checkpoint " << path << " is inconsistent" << std::endl;
+                throw std::runtime_error("Error: invalid checkpoint " + path);
+            }
+            const unsigned char* digest = emptyDigest;
+            if(mbpRoot != nullptr)
+            {
+                while(leafIndex < leaves.size() && keyIndex == leaves[leafIndex]->keys.size())
+                {
+                    leafIndex++;
+                    keyIndex = 0;
+                }
+                if(leafIndex == leaves.size() || leaves[leafIndex]->keys[keyIndex] != vid)
+                {
+                    std::cerr << "Error: vertex " << vid << " in checkpoint " << path << " has no digest in the MbpTree" << std::endl;
+                    throw std::runtime_error("Error: invalid checkpoint " + path);
+                }
+                digest = leaves[leafIndex]->vertexDigests[keyIndex].data();
+                keyIndex++;
+            }
+            graph.restoreVertex(vid, neighbors.data() + offsets[i], neighbors.data() + offsets[i + 1], digest);
+        }
+        for(; leafIndex < leaves.size(); leafIndex++, keyIndex = 0)
+        {
+            if(keyIndex < leaves[leafIndex]->keys.size())
+            {
+                std::cerr << "Error: MbpTree in checkpoint " << path << " has vertex " << leaves[leafIndex]->keys[keyIndex] << " that is not in the graph" << std::endl;
+                throw std::runtime_error("Error: invalid checkpoint " + path);
+            }
+        }
+        graph.buildInvertedIndex();
+        if(mbpRoot == nullptr)
+        {
+            graph.computeVertexDigest();
+        }
+
+        coremaintainer.restoreState(vids, cores, mcd, degPlus, korders, coreVersion);
+
+        if(hasShell)
+        {
+            shellTree = new ShellTree();
+            shellTree->importFlat(shellVertices, shellNodes);
+        }
+        if(mbpRoot != nullptr)
+        {
+            mbptree = new MbpTree(mbpCapacity);
+            mbptree->restore(mbpRoot);
+        }
+    }
+    catch(...)
+    {
+        munmap(mapped, size);
+        delete shellTree;
+        delete mbptree;
+        shellTree = nullptr;
+        mbptree = nullptr;
+        throw;
+    }
+    munmap(mapped, size);
+    return version;
+}
@@ -0,0 +1,269 @@
+#include "semiIndexExtractor/indexSnapshot.h"
+
+IndexSnapshot::IndexSnapshot(uint _version, const Graph& graph, const CoreMaintainer& coremaintainer, const ShellTree* shellTree, std::shared_ptr<const FrozenMbpNode> _mbpRoot,
+                             const IndexSnapshot* previous, const std::vector<VertexID>& changed, const std::vector<uint>& changedNodes)
+    : version(_version), coreVersion(coremaintainer.getVersion()), vertexNum(0), neighborNum(0), shellReady(shellTree != nullptr), mbpRoot(_mbpRoot)
+{
+    if(previous == nullptr)
+    {
+        const VertexMap& nodes = graph.getNodes();
+        VertexMap::const_iterator it = nodes.begin();
+        while(it != nodes.end())
+        {
+            uint key = it->first >> SNAPSHOT_CHUNK_BITS;
+            rebuildChunk(key, graph, coremaintainer, shellTree);
+            uint64_t next = ((uint64_t)key + 1) << SNAPSHOT_CHUNK_BITS;
+            if(next > UINT_MAX)
+            {
+                break;
+            }
+            it = nodes.lower_bound((VertexID)next);
+        }
+        for(uint handle = 0; shellTree != nullptr && handle < shellTree->getHandleNum(); handle++)
+        {
+            std::shared_ptr<const FrozenShellNode> node = shellTree->freezeNode(handle);
+            if(node != nullptr)
+            {
+                shellNodes.set(handle, node);
+            }
+        }
+        return ;
+    }
+
+    if(previous->shellReady != shellReady)
+    {
+        std::cerr << "IndexSnapshot Error: snapshot " << previous->version << " does not have the same shell tree state" << std::endl;
+        throw std::runtime_error("IndexSnapshot Error: previous snapshot cannot be shared");
+    }
+    chunks = previous->chunks;
+    vertexNum = previous->vertexNum;
+    neighborNum = previous->neighborNum;
+    std::vector<uint> keys;
+    keys.reserve(changed.size());
+    for(const VertexID& vid : changed)
+    {
+        keys.emplace_back(vid >> SNAPSHOT_CHUNK_BITS);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    for(const uint& key : keys)
+    {
+        rebuildChunk(key, graph, coremaintainer, shellTree);
+    }
+    if(shellReady)
+    {
+        shellNodes = previous->shellNodes;
+        for(const uint& handle : changedNodes)
+        {
+            std::shared_ptr<const FrozenShellNode> node = shellTree->freezeNode(handle);
+            if(node != nullptr || handle < shellNodes.size())
+            {
+                shellNodes.set(handle, node);
+            }
+        }
+    }
+}
+
+void IndexSnapshot::rebuildChunk(uint key, const Graph& graph, const CoreMaintainer& coremaintainer, const ShellTree* shellTree)
+{
+    const SnapshotChunk* old = chunks[key].get();
+    if(old != nullptr)
+    {
+        vertexNum -= old->vids.size();
+        neighborNum -= old->getNeighborNum();
+    }
+    const VertexMap& nodes = graph.getNodes();
+    uint64_t last = ((uint64_t)key + 1) << SNAPSHOT_CHUNK_BITS;
+    VertexMap::const_iterator it = nodes.lower_bound(key << SNAPSHOT_CHUNK_BITS);
+    if(it == nodes.end() || it->first >= last)
+    {
+        if(old != nullptr)
+        {
+            chunks.set(key, nullptr);
+        }
+        return ;
+    }
+    std::shared_ptr<SnapshotChunk> chunk = std::make_shared<SnapshotChunk>();
+    bool packed = graph.isCompressedAdjacency();
+    uint neighborCount = 0;
+    for(; it != nodes.end() && it->first < last; ++it)
+    {
+        chunk->vids.emplace_back(it->first);
+        chunk->cores.emplace_back(coremaintainer.getCore(it->first));
+        if(shellTree != nullptr)
+        {
+            chunk->shellHandles.emplace_back(shellTree->getHandle(it->first));
+        }
+        chunk->offsets.emplace_back(neighborCount);
+        const NeighborList& vertexNeighbors = it->second.getNeighbors();
+        neighborCount += vertexNeighbors.size();
+        if(!packed)
+        {
+            chunk->neighbors.insert(chunk->neighbors.end(), vertexNeighbors.begin(), vertexNeighbors.end());
+            continue;
+        }
+        chunk->codeOffsets.emplace_back(chunk->codes.size());
+        VertexID prev = 0;
+        for(const VertexID& neighbor : vertexNeighbors)
+        {
+            appendVarint(neighbor - prev, chunk->codes);
+            prev = neighbor;
+        }
+    }
+    chunk->offsets.emplace_back(neighborCount);
+    if(packed)
+    {
+        chunk->codeOffsets.emplace_back(chunk->codes.size());
+        chunk->codes.shrink_to_fit();
+    }
+    vertexNum += chunk->vids.size();
+    neighborNum += chunk->getNeighborNum();
+    chunks.set(key, chunk);
+}
+
+bool IndexSnapshot::locate(const VertexID& vid, const SnapshotChunk*& chunk, uint& index) const
+{
+    chunk = chunks[vid >> SNAPSHOT_CHUNK_BITS].get();
+    if(chunk == nullptr)
+    {
+        return false;
+    }
+    std::vector<VertexID>::const_iterator it = std::lower_bound(chunk->vids.begin(), chunk->vids.end(), vid);
+    if(it == chunk->vids.end() || *it != vid)
+    {
+        return false;
+    }
+    index = it - chunk->vids.begin();
+    return true;
+}
+
+uint IndexSnapshot::getVersion() const
+{
+    return version;
+}
+
+uint IndexSnapshot::getCoreVersion() const
+{
+    return coreVersion;
+}
+
+size_t IndexSnapshot::getVertexNum() const
+{
+    return vertexNum;
+}
+
+bool IndexSnapshot::hasVertex(const VertexID& vid) const
+{
+    const SnapshotChunk* chunk;
+    uint index;
+    return locate(vid, chunk, index);
+}
+
+uint IndexSnapshot::getCore(const VertexID& vid) const
+{
+    const SnapshotChunk* chunk;
+    uint index;
+    if(!locate(vid, chunk, index))
+    {
+        std::cerr << "Vertex " << vid << " not found in snapshot " << version << std::endl;
+        throw std::runtime_error("Vertex not found in snapshot");
+    }
+    return chunk->cores[index];
+}
+
+SnapshotNeighbors IndexSnapshot::getNeighbors(const VertexID& vid) const
+{
+    const SnapshotChunk* chunk;
+    uint index;
+    if(!locate(vid, chunk, index))
+    {
+        return SnapshotNeighbors();
+    }
+    if(chunk->isPacked())
+    {
+        const unsigned char* codes = (const unsigned char*)chunk->codes.data();
+        return SnapshotNeighbors(codes + chunk->codeOffsets[index], codes + chunk->codeOffsets[index + 1], chunk->offsets[index + 1] - chunk->offsets[index]);
+    }
+    const VertexID* base = chunk->neighbors.data();
+    return SnapshotNeighbors(base + chunk->offsets[index], base + chunk->offsets[index + 1]);
+}
+
+bool IndexSnapshot::isShellReady() const
+{
+    return shellReady;
+}
+
+const FrozenShellNode& IndexSnapshot::kcoreNode(const VertexID& queryV, const uint& k) const
+{
+    const SnapshotChunk* chunk;
+    uint index;
+    const FrozenShellNode* node = nullptr;
+    if(shellReady && locate(queryV, chunk, index))
+    {
+        node = shellNodes[chunk->shellHandles[index]].get();
+    }
+    if(node == nullptr)
+    {
+        std::cerr << "Vertex " << queryV << " not found in the shell tree of snapshot " << version << std::endl;
+        throw std::runtime_error("Vertex not found in the shell tree of snapshot");
+    }
+    // 向上找到层级仍不小于k的最高祖先，其子树即为包含queryV的连通k-core
+    while(node->parent != FrozenShellNode::NONE && shellNodes[node->parent]->coreLevel >= k)
+    {
+        node = shellNodes[node->parent].get();
+    }
+    return *node;
+}
+
+void IndexSnapshot::kcoreVertices(const VertexID& queryV, const uint& k, std::vector<VertexID>& vertices) const
+{
+    if(getCore(queryV) < k)
+    {
+        return ;
+    }
+    std::vector<const FrozenShellNode*> stack(1, &kcoreNode(queryV, k));
+    while(!stack.empty())
+    {
+        const FrozenShellNode* node = stack.back();
+        stack.pop_back();
+        vertices.insert(vertices.end(), node->vertices.begin(), node->vertices.end());
+        for(const uint& child : node->children)
+        {
+            stack.emplace_back(shellNodes[child].get());
+        }
+    }
+}
+
+void IndexSnapshot::shellPath(const VertexID& vid, std::set<std::pair<uint, uint>>& path) const
+{
+    const SnapshotChunk* chunk;
+    uint index;
+    if(!shellReady || !locate(vid, chunk, index))
+    {
+        return ;
+    }
+    for(uint cur = chunk->shellHandles[index]; cur != FrozenShellNode::NONE; cur = shellNodes[cur]->parent)
+    {
+        path.emplace(shellNodes[cur]->coreLevel, shellNodes[cur]->id);
+    }
+}
+
+void IndexSnapshot::attachMbpRoot(std::shared_ptr<const FrozenMbpNode> _mbpRoot)
+{
+    mbpRoot = _mbpRoot;
+}
+
+const FrozenMbpNode& IndexSnapshot::getMbpRoot() const
+{
+    if(mbpRoot == nullptr)
+    {
+        std::cerr << "MbpTree is not built." << std::endl;
+        throw std::runtime_error("MbpTree is not built.");
+    }
+    return *mbpRoot;
+}
+
+void IndexSnapshot::getRootDigest(unsigned char* _digest) const
+{
+    memcpy(_digest, getMbpRoot().digest, SHA256_DIGEST_LENGTH);
+}
@@ -0,0 +1,79 @@
+#include "semiIndexExtractor/queryCache.h"
+
+QueryCache::QueryCache(size_t _capacity) : capacity(_capacity), latestVersion(0) {}
+
+bool QueryCache::lookup(const QueryCacheKey& key, uint version, std::shared_ptr<const CachedAnswer>& answer, std::shared_ptr<const CachedVO>& vo)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    std::map<QueryCacheKey, std::list<Entry>::iterator>::iterator it = entries.find(key);
+    if(it == entries.end() || version < it->second->version)
+    {
+        return false;
+    }
+    lru.splice(lru.begin(), lru, it->second);
+    answer = it->second->answer;
+    vo = it->second->vo;
+    return true;
+}
+
+void QueryCache::insert(const QueryCacheKey& key, uint version, std::shared_ptr<const CachedAnswer> answer, std::shared_ptr<const CachedVO> vo)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if(version < latestVersion || capacity == 0)
+    {
+        return ;
+    }
+    std::map<QueryCacheKey, std::list<Entry>::iterator>::iterator it = entries.find(key);
+    if(it != entries.end())
+    {
+        lru.erase(it->second);
+        entries.erase(it);
+    }
+    lru.push_front(Entry{key, version, answer, vo});
+    entries[key] = lru.begin();
+    while(lru.size() > capacity)
+    {
+        entries.erase(lru.back().key);
+        lru.pop_back();
+    }
+}
+
+void QueryCache::updateVO(const QueryCacheKey& key, uint version, std::shared_ptr<const CachedVO> vo)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    std::map<QueryCacheKey, std::list<Entry>::iterator>::iterator it = entries.find(key);
+    if(it == entries.end() || version < latestVersion)
+    {
+        return ;
+    }
+    it->second->vo = vo;
+}
+
+void QueryCache::invalidate(const std::set<std::pair<uint, uint>>& shellNodes, uint version)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    latestVersion = version;
+    for(const std::pair<uint, uint>& node : shellNodes)
+    {
+        std::map<QueryCacheKey, std::list<Entry>::iterator>::iterator it = entries.lower_bound(QueryCacheKey(node.first, node.second, 0));
+        while(it != entries.end() && std::get<0>(it->first) == node.first && std::get<1>(it->first) == node.second)
+        {
+            lru.erase(it->second);
+            it = entries.erase(it);
+        }
+    }
+}
+
+void QueryCache::clear(uint version)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    latestVersion = version;
+    lru.clear();
+    entries.clear();
+}
+
+size_t QueryCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return lru.size();
+}
@@ -0,0 +1,71 @@
+#include "semiIndexExtractor/queryContext.h"
+
+QueryContext::QueryContext() : epoch(0), answerExists(false), snapshotVersion(0) {}
+
+void QueryContext::reset()
+{
+    if(++epoch == 0) // epoch回绕时旧的标记可能重新生效，整体清零一次
+    {
+        std::fill(stamp.begin(), stamp.end(), 0);
+        epoch = 1;
+    }
+    vertices.clear();
+    offsets.clear();
+    adjacency.clear();
+    frontier.clear();
+    degree.clear();
+    answerExists = false;
+    vo.clear();
+    liIndex.clear();
+    liIndexExists.clear();
+}
+
+bool QueryContext::mark(const VertexID& vid)
+{
+    if(vid >= stamp.size())
+    {
+        size_t need = (size_t)vid + 1;
+        size_t grown = need + vid / 2;
+        stamp.resize(grown < need ? need : grown, 0); // 按1.5倍增长，溢出时只扩到vid
+        slot.resize(stamp.size(), 0);
+    }
+    if(stamp[vid] == epoch)
+    {
+        return false;
+    }
+    stamp[vid] = epoch;
+    return true;
+}
+
+bool QueryContext::isMarked(const VertexID& vid) const
+{
+    return vid < stamp.size() && stamp[vid] == epoch;
+}
+
+void QueryContext::unmark(const VertexID& vid)
+{
+    if(vid < stamp.size())
+    {
+        stamp[vid] = epoch - 1;
+    }
+}
+
+uint QueryContext::getVertexNum() const
+{
+    return vertices.size();
+}
+
+uint QueryContext::getNeighborNum(uint index) const
+{
+    return offsets[index + 1] - offsets[index];
+}
+
+const VertexID* QueryContext::neighborsBegin(uint index) const
+{
+    return adjacency.data() + offsets[index];
+}
+
+const VertexID* QueryContext::neighborsEnd(uint index) const
+{
+    return adjacency.data() + offsets[index + 1];
+}
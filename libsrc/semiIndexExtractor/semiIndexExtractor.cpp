@@ -1,10 +1,17 @@
 #include "semiIndexExtractor/semiIndexExtractor.h"
 
-semiIndexExtractor::semiIndexExtractor()
+const VOEntry::DataType semiIndexExtractor::VO_PAYLOAD_TYPE;
+
+semiIndexExtractor::semiIndexExtractor(uint threadNum)
 {
-    answerExists = false;
     mbptree = nullptr;
     shellTree = nullptr;
+    pool = new ThreadPool(threadNum);
+    indexDirty = true;
+    publishedVersion = 0;
+    shellRebuilt = false;
+    snapshotRebuild = false;
+    updateLog = nullptr;
 }
 
 semiIndexExtractor::~semiIndexExtractor()
@@ -17,31 +24,40 @@ semiIndexExtractor::~semiIndexExtractor()
     {
         delete shellTree;
     }
+    if(pool != nullptr)
+    {
+        delete pool;
+    }
+    for(QueryContext* ctx : idleContexts)
+    {
+        delete ctx;
+    }
 }
 
 void semiIndexExtractor::buildMbpTree(const Graph& graph, const uint maxcapacity)
 {
+    indexDirty = true;
     if(mbptree != nullptr)
     {
         delete mbptree;
         mbptree = nullptr;
     }
     mbptree = new MbpTree(maxcapacity);
-    for(const std::pair<uint, Vertex>& nodepair : graph.getNodes())
+    for(const std::pair<const VertexID, Vertex>& nodepair : graph.getNodes())
     {
-        VertexID vid = nodepair.first;
-        mbptree->setVertexDigest(vid, graph.getVertexDigest(vid));
+        mbptree->setVertexDigest(nodepair.first, nodepair.second.getDigest());
     }
     mbptree->getRoot()->digestCompute();
 }
 
 void semiIndexExtractor::mbpTreeDigestCompute()
 {
-    mbptree->getRoot()->digestCompute();
+    mbptree->digestCompute();
 }
 
 void semiIndexExtractor::mbpTreeAddUpdate(const Vertex& src, const Vertex& dst)
 {
+    indexDirty = true;
     if(mbptree == nullptr)
     {
         std::cerr << "MbpTree is not built." << std::endl;
@@ -55,6 +71,7 @@ void semiIndexExtractor::mbpTreeAddUpdate(const Vertex& src, const Vertex& dst)
 
 void semiIndexExtractor::mbpTreeDeleteEdgeUpdate(const Vertex& v)
 {
+    indexDirty = true;
     if(mbptree == nullptr)
     {
         std::cerr << "MbpTree is not built." << std::endl;
@@ -66,6 +83,7 @@ void semiIndexExtractor::mbpTreeDeleteEdgeUpdate(const Vertex& v)
 
 void semiIndexExtractor::mbpTreeDeleteVertexUpdate(const VertexID& vid)
 {
+    indexDirty = true;
     if(mbptree == nullptr)
     {
         std::cerr << "MbpTree is not built." << std::endl;
@@ -74,56 +92,80 @@ void semiIndexExtractor::mbpTreeDeleteVertexUpdate(const VertexID& vid)
     mbptree->remove(vid);
 }
 
-std::map<VertexID, std::string> semiIndexExtractor::serializeGraphInfo(const Graph& graph, const Graph& subgraph, std::vector<VertexID>& subgraphVids)
+void semiIndexExtractor::serializeVertex(const IndexSnapshot& snapshot, const QueryContext& ctx, uint index, std::string& out) const
 {
-    std::map<VertexID, std::string> serializedInfo;
+    VertexID vid = ctx.vertices[index];
+    if(VO_PAYLOAD_TYPE == VOEntry::PACKEDDATA)
+    {
+        SnapshotNeighbors neighbors = snapshot.getNeighbors(vid);
+        encodeVertexPayload(vid, neighbors.size(), neighbors.begin(), neighbors.end(), ctx.neighborsBegin(index), ctx.neighborsEnd(index), out);
+        return ;
+    }
+    unsigned char splitter = '/';
     std::ostringstream oss;
 
-    for(const std::pair<uint, Vertex>& nodepair : subgraph.getNodes())
+    oss << vid;
+    for(const VertexID* it = ctx.neighborsBegin(index); it != ctx.neighborsEnd(index); ++it)
+    {
+        oss << splitter << *it;
+    }
+    oss << '|' << vid;
+    for(const VertexID& neighbor : snapshot.getNeighbors(vid))
     {
-        unsigned char splitter = '/';
-        oss = std::ostringstream();
-        VertexID vid = nodepair.first;
-        const Vertex& subgraphNode = nodepair.second;
-        const Vertex& graphNode = graph.getVertex(vid);
-        const std::vector<VertexID>& subgraphNeighbors = subgraphNode.getNeighbors();
-        const std::vector<VertexID>& graphNeighbors = graphNode.getNeighbors();
+        oss << splitter << neighbor;
+    }
+    out = oss.str();
+}
 
-        subgraphVids.emplace_back(vid);
+std::map<VertexID, std::string> semiIndexExtractor::serializeGraphInfo(const IndexSnapshot& snapshot, const QueryContext& ctx) const
+{
+    std::map<VertexID, std::string> serializedInfo;
+    for(uint i = 0; i < ctx.getVertexNum(); i++)
+    {
+        serializeVertex(snapshot, ctx, i, serializedInfo[ctx.vertices[i]]);
+    }
+    return serializedInfo;
+}
 
-        oss << vid;
-        for(const VertexID& subNeighbor : subgraphNeighbors)
-        {
-            oss << splitter << subNeighbor;
-        }
-        oss << '|' << vid;
-        for(const VertexID& graphNeighbor : graphNeighbors)
+void semiIndexExtractor::streamVO(const IndexSnapshot& snapshot, const QueryContext& ctx, VOSink& sink) const
+{
+    // MbpTree按编号升序访问子图节点，与ctx.vertices的顺序相同，节点信息在用到时才生成
+    uint cursor = 0;
+    std::string payload;
+    VOTarget target{ctx.vertices.data(), ctx.vertices.data() + ctx.vertices.size(), [&](const VertexID& vid) -> const std::string&
+    {
+        while(ctx.vertices[cursor] < vid)
         {
-            oss << splitter << graphNeighbor;
+            cursor++;
         }
+        serializeVertex(snapshot, ctx, cursor, payload);
+        return payload;
+    }, VO_PAYLOAD_TYPE, &sink};
+    snapshot.getMbpRoot().constructSharedVO(std::vector<VOTarget*>(1, &target));
+}
 
-        serializedInfo[vid] = oss.str();
-    }
-    return serializedInfo;
+void semiIndexExtractor::kcoreQueryStream(const IndexSnapshot& snapshot, const VertexID& queryV, const uint& k, QueryContext& ctx, VOSink& sink) const
+{
+    extractCandidates(snapshot, queryV, k, ctx);
+    streamVO(snapshot, ctx, sink);
 }
 
-void semiIndexExtractor::constructVO(const Graph& G, const Graph& subgraph)
+void semiIndexExtractor::constructVO(const IndexSnapshot& snapshot, QueryContext& ctx) const
 {
-    std::vector<VertexID> subgraphVids;
-    subgraphVids.reserve(subgraph.getVertexNum());
-    std::map<VertexID, std::string> serializedInfo = serializeGraphInfo(G, subgraph, subgraphVids);
-    std::cout << "Serialized graph information has been constructed. " << std::endl;
-    if(!vo.empty())
-    {
-        vo.clear();
-    }
-    mbptree->constructVO(vo, subgraphVids, serializedInfo);
-    std::cout << "VO has been constructed." << std::endl;
+    std::map<VertexID, std::string> serializedInfo = serializeGraphInfo(snapshot, ctx);
+    ctx.vo.clear();
+    std::vector<VertexID> subgraphVids(ctx.vertices);
+    snapshot.getMbpRoot().constructVO(ctx.vo, subgraphVids, serializedInfo, VO_PAYLOAD_TYPE);
 }
 
 void semiIndexExtractor::getRootDigest(unsigned char* _digest)
 {
-    if(mbptree != nullptr)
+    std::shared_ptr<const IndexSnapshot> current = getSnapshot();
+    if(current != nullptr)
+    {
+        current->getRootDigest(_digest);
+    }
+    else if(mbptree != nullptr)
     {
         mbptree->getRoot()->getDigest(_digest);
     }
@@ -174,6 +216,23 @@ void semiIndexExtractor::vertify(Graph& subgraph, std::queue<VOEntry>& VO, unsig
                 SHA256_Update(&ctx, subgraphVertexDigest, SHA256_DIGEST_LENGTH);
             }
         }
+        else if(entry.type == VOEntry::PACKEDDATA)
+        {
+            VertexID vid;
+            std::vector<VertexID> neighbors;
+            std::vector<VertexID> subgraphNeighbors;
+            decodeVertexPayload(entry.packedData.bytes, entry.packedData.length, vid, neighbors, subgraphNeighbors);
+            for(const VertexID& neighbor : subgraphNeighbors)
+            {
+                subgraph.addEdge(vid, neighbor, false, false);
+            }
+
+            // 摘要的原像由完整邻居表还原，与文本格式中'|'之后的部分相同
+            std::string graphNodeDataStr = vertexDigestPreimage(vid, neighbors);
+            unsigned char subgraphVertexDigest[SHA256_DIGEST_LENGTH];
+            SHA256((unsigned char*)graphNodeDataStr.c_str(), graphNodeDataStr.size(), subgraphVertexDigest);
+            SHA256_Update(&ctx, subgraphVertexDigest, SHA256_DIGEST_LENGTH);
+        }
         else if(entry.type == VOEntry::DIGEST)
         {
             // std::cout << "VOENTRY_DIGEST: ";
@@ -217,7 +276,12 @@ void semiIndexExtractor::vertify(Graph& subgraph, std::queue<VOEntry>& VO, unsig
     std::cout << std::endl;
 }
 
-size_t semiIndexExtractor::calculateVOSize()
+size_t semiIndexExtractor::calculateVOSize() const
+{
+    return calculateVOSize(queryCtx.vo);
+}
+
+size_t semiIndexExtractor::calculateVOSize(const std::vector<VOEntry>& vo)
 {
     // size_t totalSize = sizeof(vo); // vector 内部结构的占用
     size_t totalSize = 0; // 仅计算 VOEntry 占用的大小
@@ -228,6 +292,10 @@ size_t semiIndexExtractor::calculateVOSize()
         {
             totalSize += std::strlen(entry.nodeData) + 1; // 动态分配的 nodeData 大小
         }
+        else if(entry.type == VOEntry::PACKEDDATA)
+        {
+            totalSize += entry.packedData.length;
+        }
     }
     // std::cout << "Total size of vo:" << std::endl;
     // std::cout << "  Bytes: " << totalSize << " B" << std::endl;
@@ -239,7 +307,7 @@ size_t semiIndexExtractor::calculateVOSize()
 
 const std::vector<VOEntry>& semiIndexExtractor::getVO() const
 {
-    return vo;
+    return queryCtx.vo;
 }
 
 uint semiIndexExtractor::getCore(const VertexID& vid) const
@@ -249,18 +317,38 @@ uint semiIndexExtractor::getCore(const VertexID& vid) const
 
 void semiIndexExtractor::insertCoreUpdate(const Graph& graph, const VertexID& src, const VertexID& dst)
 {
+    indexDirty = true;
     coremaintainer.orderInsert(graph, src, dst);
     // coremaintainer.testOSTree();
 }
 
 void semiIndexExtractor::removeCoreUpdate(const Graph& graph, const VertexID& src, const VertexID& dst)
 {
+    indexDirty = true;
     coremaintainer.orderRemove(graph, src, dst);
 }
 
+void semiIndexExtractor::insertCoreUpdateBatch(Graph& graph, const std::vector<std::pair<VertexID, VertexID>>& edges)
+{
+    indexDirty = true;
+    coremaintainer.batchInsert(graph, edges, *pool);
+}
+
+void semiIndexExtractor::removeCoreUpdateBatch(Graph& graph, const std::vector<std::pair<VertexID, VertexID>>& edges)
+{
+    indexDirty = true;
+    coremaintainer.batchRemove(graph, edges, *pool);
+}
+
 void semiIndexExtractor::coresDecomposition(const Graph& graph)
 {
+    indexDirty = true;
+    snapshotRebuild = true;
     coremaintainer.coresDecomp(graph);
+    if(shellTree != nullptr) // cores整体重新计算后shell tree也要重新构建
+    {
+        buildShellTree(graph);
+    }
     // std::cout << "coremaintainer: Vertex " << 1 << " is in core " << coremaintainer.getCore(1) << std::endl;
     // uint vertexNum = graph.getVertexNum();
     // std::unordered_map<VertexID, VertexID> global2local;
@@ -361,8 +449,8 @@ void semiIndexExtractor::coresDecomposition(const Graph& graph)
 
 VertexID semiIndexExtractor::getLiIndexTop() const
 {
-    std::map<uint, std::list<VertexID>>::const_reverse_iterator it = liIndex.rbegin();
-    if(it == liIndex.rend())
+    std::map<uint, std::list<VertexID>>::const_reverse_iterator it = queryCtx.liIndex.rbegin();
+    if(it == queryCtx.liIndex.rend())
     {
         std::cerr << "LiIndex is empty." << std::endl;
         throw std::out_of_range("LiIndex is empty.");
@@ -372,25 +460,26 @@ VertexID semiIndexExtractor::getLiIndexTop() const
 
 void semiIndexExtractor::liIndexPop()
 {
-    std::map<uint, std::list<VertexID>>::reverse_iterator it = liIndex.rbegin();
-    if(it == liIndex.rend())
+    std::map<uint, std::list<VertexID>>::reverse_iterator it = queryCtx.liIndex.rbegin();
+    if(it == queryCtx.liIndex.rend())
     {
         std::cerr << "LiIndex is empty." << std::endl;
         throw std::out_of_range("LiIndex is empty.");
     }
-    liIndexExists.erase(it->second.front());
+    queryCtx.liIndexExists.erase(it->second.front());
     it->second.pop_front();
     if(it->second.empty())
     {
-        liIndex.erase(it->first);
+        queryCtx.liIndex.erase(it->first);
     }
 }
 
 void semiIndexExtractor::initLiIndex(const VertexID& queryV)
 {
-    liIndex.clear();
-    liIndex[0].push_back(queryV);
-    liIndexExists[queryV] = 0;
+    queryCtx.liIndex.clear();
+    queryCtx.liIndexExists.clear();
+    queryCtx.liIndex[0].push_back(queryV);
+    queryCtx.liIndexExists[queryV] = 0;
 }
 
 void semiIndexExtractor::insertToLiIndex(const Graph& graph, const VertexID& vid, std::unordered_map<VertexID, bool>& visited, const uint& k)
@@ -409,6 +498,8 @@ void semiIndexExtractor::insertToLiIndex(const Graph& graph, const VertexID& vid
         return;
     }
 
+    std::map<uint, std::list<VertexID>>& liIndex = queryCtx.liIndex;
+    std::unordered_map<VertexID, uint>& liIndexExists = queryCtx.liIndexExists;
     for(const VertexID& neighbor : neighbors)
     {
         if(liIndexExists.find(neighbor) == liIndexExists.end()) // 未加入LiIndex
@@ -432,131 +523,953 @@ void semiIndexExtractor::insertToLiIndex(const Graph& graph, const VertexID& vid
 
 bool semiIndexExtractor::isLiIndexEmpty() const
 {
-    return liIndex.empty();
+    return queryCtx.liIndex.empty();
 }
 
-void semiIndexExtractor::candidateGeneration(const Graph& graph, const VertexID& queryV, const uint& k)
+void semiIndexExtractor::candidateGeneration(const IndexSnapshot& snapshot, const VertexID& queryV, const uint& k, QueryContext& ctx) const
 {
-    if(!candVertices.empty())
+    // 从queryV出发BFS，收集core不小于k的连通节点
+    if(snapshot.getCore(queryV) < k)
     {
-        candVertices.clear();
+        return ;
     }
-    std::unordered_set<VertexID> visited;
-    std::unordered_set<VertexID> inQueue;
-    std::queue<VertexID> q;
-
-    // initLiIndex(queryV);
-    q.push(queryV);
-
-    // while(!isLiIndexEmpty())
-    while(!q.empty())
+    std::vector<VertexID>& frontier = ctx.frontier;
+    ctx.mark(queryV);
+    frontier.emplace_back(queryV);
+    for(size_t head = 0; head < frontier.size(); head++)
     {
-        // VertexID currentV = getLiIndexTop();
-        VertexID currentV = q.front();
+        for(const VertexID& neighbor : snapshot.getNeighbors(frontier[head]))
+        {
+            if(snapshot.getCore(neighbor) >= k && ctx.mark(neighbor))
+            {
+                frontier.emplace_back(neighbor);
+            }
+        }
+    }
+    ctx.vertices.assign(frontier.begin(), frontier.end());
+    frontier.clear();
+    buildCandAdjacency(snapshot, ctx);
+    ctx.answerExists = true;
+}
 
-        visited.insert(currentV);
+void semiIndexExtractor::globalExtract(const VertexID& queryV, const uint& k, QueryContext& ctx) const
+{
+    // 在候选子图上剥离度数小于k的节点，剥离后只保留与queryV连通的部分
+    std::vector<VertexID>& vertices = ctx.vertices;
+    std::vector<uint>& offsets = ctx.offsets;
+    std::vector<VertexID>& adjacency = ctx.adjacency;
+    std::vector<uint>& degree = ctx.degree;
+    std::vector<VertexID>& frontier = ctx.frontier;
+    uint n = ctx.getVertexNum();
+    if(n == 0)
+    {
+        return ;
+    }
 
-        // liIndexPop();
-        q.pop();
+    degree.resize(n);
+    for(uint i = 0; i < n; i++)
+    {
+        degree[i] = ctx.getNeighborNum(i);
+        if(degree[i] < k)
+        {
+            ctx.unmark(vertices[i]);
+            frontier.emplace_back(vertices[i]);
+        }
+    }
+    for(size_t head = 0; head < frontier.size(); head++)
+    {
+        uint i = ctx.slot[frontier[head]];
+        for(const VertexID* it = ctx.neighborsBegin(i); it != ctx.neighborsEnd(i); ++it)
+        {
+            if(ctx.isMarked(*it) && --degree[ctx.slot[*it]] < k)
+            {
+                ctx.unmark(*it);
+                frontier.emplace_back(*it);
+            }
+        }
+    }
+    if(!ctx.isMarked(queryV))
+    {
+        ctx.answerExists = false;
+        vertices.clear();
+        offsets.clear();
+        adjacency.clear();
+        return ;
+    }
+    if(frontier.empty())
+    {
+        return ;
+    }
 
-        candGraph.addVertex(currentV, true, false);
-        for(const VertexID& neighbor : graph.getVertexNeighbors(currentV))
+    // 剥离可能使候选子图不再连通，degree置为UINT_MAX表示从queryV可达
+    frontier.clear();
+    frontier.emplace_back(queryV);
+    degree[ctx.slot[queryV]] = UINT_MAX;
+    for(size_t head = 0; head < frontier.size(); head++)
+    {
+        uint i = ctx.slot[frontier[head]];
+        for(const VertexID* it = ctx.neighborsBegin(i); it != ctx.neighborsEnd(i); ++it)
         {
-            if(visited.find(neighbor) != visited.end())
+            if(ctx.isMarked(*it) && degree[ctx.slot[*it]] != UINT_MAX)
             {
-                candGraph.addEdge(currentV, neighbor, true, false);
+                degree[ctx.slot[*it]] = UINT_MAX;
+                frontier.emplace_back(*it);
             }
-            else
+        }
+    }
+    for(uint i = 0; i < n; i++)
+    {
+        if(degree[i] != UINT_MAX)
+        {
+            ctx.unmark(vertices[i]);
+        }
+    }
+
+    // 保留的节点是原节点序列的子序列，原地压缩邻接表
+    uint kept = 0;
+    uint begin = offsets[0];
+    for(uint i = 0; i < n; i++)
+    {
+        uint end = offsets[i + 1];
+        if(ctx.isMarked(vertices[i]))
+        {
+            uint pos = offsets[kept];
+            for(uint j = begin; j < end; j++)
             {
-                if(inQueue.find(neighbor) == inQueue.end() && coremaintainer.getCore(neighbor) >= k)
+                if(ctx.isMarked(adjacency[j]))
                 {
-                    q.push(neighbor);
-                    inQueue.insert(neighbor);
+                    adjacency[pos++] = adjacency[j];
                 }
             }
+            vertices[kept] = vertices[i];
+            ctx.slot[vertices[kept]] = kept;
+            offsets[++kept] = pos;
+        }
+        begin = end;
+    }
+    vertices.resize(kept);
+    offsets.resize(kept + 1);
+    adjacency.resize(offsets[kept]);
+    frontier.clear();
+}
+
+void semiIndexExtractor::buildCandAdjacency(const IndexSnapshot& snapshot, QueryContext& ctx) const
+{
+    std::vector<VertexID>& vertices = ctx.vertices;
+    std::vector<uint>& offsets = ctx.offsets;
+    std::vector<VertexID>& adjacency = ctx.adjacency;
+    std::sort(vertices.begin(), vertices.end());
+    offsets.emplace_back(0);
+    for(uint i = 0; i < vertices.size(); i++)
+    {
+        ctx.slot[vertices[i]] = i;
+        for(const VertexID& neighbor : snapshot.getNeighbors(vertices[i]))
+        {
+            if(ctx.isMarked(neighbor))
+            {
+                adjacency.emplace_back(neighbor);
+            }
         }
-        candVertices.emplace_back(currentV);
+        offsets.emplace_back(adjacency.size());
+    }
+}
 
-        // uint minDegree = std::numeric_limits<uint>::max();
-        // for(const VertexID& v : candVertices)
-        // {
-        //     minDegree = std::min(minDegree, candGraph.getVertexDegree(v));
-        // }
-        // std::cout << "MinDegree : " << minDegree << std::endl;
-        
-        uint minDegree = candGraph.getVertexDegree(candGraph.getMinDegreeVertexID());
-        if(minDegree >= k)
+bool semiIndexExtractor::isShellTreeReady() const
+{
+    return shellTree != nullptr && shellTree->isReady();
+}
+
+void semiIndexExtractor::shellCandidateGeneration(const IndexSnapshot& snapshot, const VertexID& queryV, const uint& k, QueryContext& ctx) const
+{
+    // 连通k-core中节点的core不小于k的邻居必然也在其中
+    snapshot.kcoreVertices(queryV, k, ctx.vertices);
+    if(ctx.vertices.empty())
+    {
+        return ;
+    }
+    for(const VertexID& v : ctx.vertices)
+    {
+        ctx.mark(v);
+    }
+    buildCandAdjacency(snapshot, ctx);
+    ctx.answerExists = true;
+}
+
+void semiIndexExtractor::extractCandidates(const IndexSnapshot& snapshot, const VertexID& queryV, const uint& k, QueryContext& ctx) const
+{
+    ctx.reset();
+    ctx.snapshotVersion = snapshot.getVersion();
+    if(snapshot.isShellReady())
+    {
+        shellCandidateGeneration(snapshot, queryV, k, ctx);
+        return ;
+    }
+
+    // shell tree不存在或还有未修复的删除时，退回BFS生成候选再剥离
+    candidateGeneration(snapshot, queryV, k, ctx);
+    globalExtract(queryV, k, ctx);
+}
+
+Graph semiIndexExtractor::kcoreExtract(const Graph& graph, const VertexID& queryV, const uint& k)
+{
+    publishIndex(graph);
+    extractCandidates(*getSnapshot(), queryV, k, queryCtx);
+    Graph kcoreGraph;
+    for(uint i = 0; i < queryCtx.getVertexNum(); i++)
+    {
+        VertexID v = queryCtx.vertices[i];
+        kcoreGraph.addVertex(v, false, false);
+        for(const VertexID* it = queryCtx.neighborsBegin(i); it != queryCtx.neighborsEnd(i); ++it)
+        {
+            if(*it > v)
+            {
+                kcoreGraph.addEdge(v, *it, false, false);
+            }
+        }
+    }
+    return kcoreGraph;
+}
+
+std::chrono::milliseconds semiIndexExtractor::kcoreExtractByShell(const Graph& graph, const VertexID& queryV, const uint& k)
+{
+    publishIndex(graph);
+    std::shared_ptr<const IndexSnapshot> current = getSnapshot();
+    auto start = std::chrono::high_resolution_clock::now();
+    extractCandidates(*current, queryV, k, queryCtx);
+    auto mid = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(mid - start);
+    if(!queryCtx.answerExists)
+    {
+        std::cout << "The graph does not satisfy k-core property." << std::endl;
+    }
+    std::cout << "query time: " << duration.count() << "ms" << std::endl;
+
+    constructVO(*current, queryCtx);
+    std::cout << "VO has been constructed." << std::endl;
+    auto end = std::chrono::high_resolution_clock::now();
+    duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - mid);
+    std::cout << "VO construction time: " << duration.count() << " ms" << std::endl;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+}
+
+void semiIndexExtractor::publishIndex(const Graph& graph)
+{
+    if(!indexDirty && getSnapshot() != nullptr)
+    {
+        return ;
+    }
+    std::vector<VertexID> changed;
+    std::shared_ptr<IndexSnapshot> prepared = prepareIndex(graph, changed);
+    commitIndex(prepared, changed);
+}
+
+std::shared_ptr<IndexSnapshot> semiIndexExtractor::prepareIndex(const Graph& graph, std::vector<VertexID>& changed)
+{
+    // 上一个快照之后core、邻居或所在shell node改变的节点，以及改变的shell node
+    std::vector<uint> changedNodes;
+    coremaintainer.finishRemove(graph); // 逐条删除的边在这里统一修复shell tree
+    coremaintainer.takeChangedVertices(changed);
+    if(shellTree != nullptr)
+    {
+        shellTree->takeChanges(changedNodes, changed);
+    }
+    const ShellTree* readyTree = isShellTreeReady() ? shellTree : nullptr;
+    const IndexSnapshot* previous = lastPrepared.get();
+    if(snapshotRebuild || (previous != nullptr && previous->isShellReady() != (readyTree != nullptr)))
+    {
+        previous = nullptr;
+    }
+    std::shared_ptr<IndexSnapshot> prepared = std::make_shared<IndexSnapshot>(++publishedVersion, graph, coremaintainer, readyTree, nullptr, previous, changed, changedNodes);
+    lastPrepared = prepared;
+    snapshotRebuild = false;
+    indexDirty = false;
+    return prepared;
+}
+
+void semiIndexExtractor::commitIndex(std::shared_ptr<IndexSnapshot> prepared, const std::vector<VertexID>& changed)
+{
+    if(mbptree != nullptr)
+    {
+        prepared->attachMbpRoot(mbptree->freeze());
+    }
+    std::shared_ptr<const IndexSnapshot> published = prepared;
+    invalidateQueryCache(getSnapshot().get(), *published, changed); // 必须在新版本可见之前完成
+    {
+        // 移出窗口的版本在最后一个持有它的查询结束时释放，只属于它的MbpTree节点随之回收
+        std::lock_guard<std::mutex> lock(snapshotMtx);
+        snapshots.emplace_back(published);
+        while(snapshots.size() > SNAPSHOT_RETAIN_NUM)
+        {
+            snapshots.pop_front();
+        }
+    }
+}
+
+std::shared_ptr<const IndexCheckpoint> semiIndexExtractor::captureCheckpoint(Graph& graph)
+{
+    graph.compactAdjacency(); // 快照和索引都不持有graph中的引用，这时压缩是安全的
+    publishIndex(graph);
+    return std::make_shared<const IndexCheckpoint>(getSnapshot(), coremaintainer, mbptree == nullptr ? 0 : mbptree->getMaxCapacity());
+}
+
+void semiIndexExtractor::restoreCheckpoint(const std::string& path, Graph& graph)
+{
+    ShellTree* restoredShell = nullptr;
+    MbpTree* restoredMbp = nullptr;
+    uint version = IndexCheckpoint::restore(path, graph, coremaintainer, restoredShell, restoredMbp);
+
+    coremaintainer.attachShellTree(nullptr);
+    delete shellTree;
+    delete mbptree;
+    shellTree = restoredShell;
+    mbptree = restoredMbp;
+    coremaintainer.attachShellTree(shellTree);
+    {
+        std::lock_guard<std::mutex> lock(snapshotMtx);
+        snapshots.clear();
+    }
+    // 重新发布检查点中的版本，MbpTree的节点都带着还原时的拷贝，冻结时不需要复制
+    publishedVersion = version - 1;
+    indexDirty = true;
+    shellRebuilt = true;
+    snapshotRebuild = true;
+    publishIndex(graph);
+}
+
+void semiIndexExtractor::attachUpdateLog(UpdateLog* log)
+{
+    updateLog = log;
+}
+
+size_t semiIndexExtractor::replayUpdateLog(Graph& graph, const UpdateLog& log, const std::function<void(const PublishedBatch&)>& onPublished)
+{
+    if(mbptree == nullptr)
+    {
+        std::cerr << "MbpTree is not built." << std::endl;
+        throw std::runtime_error("MbpTree is not built.");
+    }
+    publishIndex(graph); // 先发布当前状态，publishedVersion即为已经包含的最后一个版本
+    size_t recordNum = log.getRecordNum();
+    size_t first = 0;
+    while(first < recordNum && log.getRecordVersion(first) <= publishedVersion)
+    {
+        first++;
+    }
+    if(first == recordNum)
+    {
+        return 0;
+    }
+
+    // 中间版本不会被查询，不必逐批复制快照和重新计算MbpTree内部节点的摘要。
+    // 记录中的批次已经合并并去掉了无效操作，直接进入批量维护；
+    // 删除旧的边时端点常常早已不在图中，只有本批中被移除的节点才从MbpTree删除
+    PublishedBatch info = {1, 0, 0, 0, 0};
+    uint lastVersion = publishedVersion;
+    UpdateBatch batch;
+    PendingPublish pending;
+    std::unordered_set<VertexID> seen;
+    std::vector<VertexID> detached;
+    for(size_t i = first; i < recordNum; i++)
+    {
+        batch.clear();
+        log.readRecord(i, batch);
+        if(batch.version <= lastVersion)
+        {
+            std::cerr << "Replayed batch version " << batch.version << " is not after " << lastVersion << std::endl;
+            throw std::runtime_error("Replayed batch versions must increase");
+        }
+        lastVersion = batch.version;
+        applyBatch(graph, batch, detached);
+        pending.digests.clear();
+        pending.removed.clear();
+        collectBatchDigests(graph, batch, detached, seen, pending);
+        applyBatchDigests(pending);
+        info.updateNum += batch.updateNum;
+        info.insertNum += batch.inserts.size();
+        info.removeNum += batch.removes.size();
+    }
+    publishedVersion = lastVersion - 1;
+    indexDirty = true;
+    publishIndex(graph); // 冻结MbpTree时一次性重新计算所有被标记的内部节点
+    info.version = publishedVersion;
+    if(onPublished)
+    {
+        onPublished(info);
+    }
+    return recordNum - first;
+}
+
+void semiIndexExtractor::applyUpdateStream(Graph& graph, EdgeReader& reader, uint batchNum, bool isInsert, const std::function<void(const PublishedBatch&)>& onPublished)
+{
+    if(batchNum == 0)
+    {
+        std::cerr << "Update batch size must be positive." << std::endl;
+        throw std::runtime_error("Update batch size must be positive.");
+    }
+    runUpdatePipeline(graph, [&reader, batchNum, isInsert](UpdateBatch& batch)
+    {
+        if(reader.isEndOfFile())
+        {
+            return false;
+        }
+        batch.updateNum = reader.readNextEdges(batchNum, isInsert ? batch.inserts : batch.removes);
+        return true;
+    }, false, onPublished);
+}
+
+void semiIndexExtractor::applyMixedUpdateStream(Graph& graph, EdgeReader& reader, uint batchNum, const std::function<void(const PublishedBatch&)>& onPublished)
+{
+    if(batchNum == 0)
+    {
+        std::cerr << "Update batch size must be positive." << std::endl;
+        throw std::runtime_error("Update batch size must be positive.");
+    }
+    // 只在读线程中使用
+    std::vector<EdgeUpdate> updates;
+    UpdateCoalescer coalescer;
+    runUpdatePipeline(graph, [&reader, &updates, &coalescer, batchNum](UpdateBatch& batch)
+    {
+        if(reader.isEndOfFile())
         {
-            std::cout << "Answer exists." << std::endl;
-            answerExists = true;
-            break;
+            return false;
+        }
+        reader.readNextUpdates(batchNum, updates);
+        coalescer.coalesce(updates, batch);
+        return true;
+    }, true, onPublished);
+}
+
+void semiIndexExtractor::dropNoOpUpdates(const Graph& graph, std::vector<std::pair<VertexID, VertexID>>& edges, bool isInsert) const
+{
+    size_t kept = 0;
+    for(const std::pair<VertexID, VertexID>& edge : edges)
+    {
+        if(graph.hasEdge(edge.first, edge.second) != isInsert)
+        {
+            edges[kept++] = edge;
+        }
+    }
+    edges.resize(kept);
+}
+
+void semiIndexExtractor::applyBatch(Graph& graph, const UpdateBatch& batch, std::vector<VertexID>& detached)
+{
+    detached.clear();
+    if(!batch.removes.empty())
+    {
+        removeCoreUpdateBatch(graph, batch.removes);
+        coremaintainer.takeDetachedVertices(detached);
+        std::sort(detached.begin(), detached.end());
+    }
+    if(!batch.inserts.empty())
+    {
+        insertCoreUpdateBatch(graph, batch.inserts);
+    }
+}
+
+void semiIndexExtractor::collectBatchDigests(const Graph& graph, const UpdateBatch& batch, const std::vector<VertexID>& detached, std::unordered_set<VertexID>& seen, PendingPublish& pending) const
+{
+    // 按端点第一次出现的顺序写入MbpTree，新节点的插入顺序决定树的形状，与逐条更新时相同
+    seen.clear();
+    for(const std::vector<std::pair<VertexID, VertexID>>* edges : {&batch.removes, &batch.inserts})
+    {
+        for(const std::pair<VertexID, VertexID>& edge : *edges)
+        {
+            for(const VertexID& vid : {edge.first, edge.second})
+            {
+                if(!seen.insert(vid).second)
+                {
+                    continue;
+                }
+                const Vertex* vertex = graph.findVertex(vid);
+                if(vertex != nullptr)
+                {
+                    pending.digests.emplace_back();
+                    pending.digests.back().first = vid;
+                    std::memcpy(pending.digests.back().second.data(), vertex->getDigest(), SHA256_DIGEST_LENGTH);
+                }
+                else if(std::binary_search(detached.begin(), detached.end(), vid))
+                {
+                    pending.removed.emplace_back(vid);
+                }
+            }
         }
+    }
+}
 
-        // 批量更新LiIndex
-        // insertToLiIndex(graph, currentV, visited, k);
-        // std::cout << "CurrentV : " << currentV << ": "<<std::endl;
-        // printLiIndex();
+void semiIndexExtractor::applyBatchDigests(const PendingPublish& pending)
+{
+    for(const VertexID& vid : pending.removed)
+    {
+        mbptree->remove(vid);
+    }
+    for(const std::pair<VertexID, std::array<unsigned char, SHA256_DIGEST_LENGTH>>& vertexDigest : pending.digests)
+    {
+        mbptree->setVertexDigest(vertexDigest.first, vertexDigest.second.data());
     }
 }
 
-void semiIndexExtractor::globalExtract(const VertexID& queryV, const uint& k)
+void semiIndexExtractor::runUpdatePipeline(Graph& graph, const std::function<bool(UpdateBatch&)>& readBatch, bool dropNoOps, const std::function<void(const PublishedBatch&)>& onPublished)
 {
-    VertexID minDegreeV;
-    uint deg;
-    bool satisfyKcore = false;
-    Graph kcoreG;
-    // candGraph.printGraphInfoSimple();
-    while(true)
+    if(mbptree == nullptr)
     {
-        minDegreeV = candGraph.getMinDegreeVertexID();
-        deg = candGraph.getVertexDegree(minDegreeV);
-        if(deg < k)
+        std::cerr << "MbpTree is not built." << std::endl;
+        throw std::runtime_error("MbpTree is not built.");
+    }
+
+    /*
+     * 三个阶段通过有界队列连接，任一阶段处理不过来时上游阻塞：
+     * 读线程   ：解析并合并第i+1批，缓冲区用完后由调用线程还回来，保留容量重复使用；
+     * 调用线程 ：把第i批应用到graph、cores和shell tree，记录端点的新摘要并复制出快照；
+     * 摘要线程 ：用第i-1批的摘要更新MbpTree，重新计算内部节点摘要后发布。
+     * 关联了updateLog时，调用线程在应用之前把这一批追加到日志，摘要线程发布之前等待其落盘。
+     * graph、coremaintainer和shellTree只由调用线程访问，mbptree和快照窗口只由摘要线程访问。
+     */
+    BoundedQueue<UpdateBatch> readQueue(UPDATE_PIPELINE_DEPTH);
+    BoundedQueue<UpdateBatch> freeQueue(UPDATE_PIPELINE_DEPTH + 1);
+    BoundedQueue<PendingPublish> publishQueue(UPDATE_PIPELINE_DEPTH);
+    for(uint i = 0; i < UPDATE_PIPELINE_DEPTH + 1; i++)
+    {
+        freeQueue.push(UpdateBatch());
+    }
+    std::exception_ptr readerError, applyError, hasherError;
+    UpdateLog* log = updateLog;
+
+    std::thread readerThread([&]()
+    {
+        try
         {
-            if(minDegreeV == queryV)
+            UpdateBatch batch;
+            while(freeQueue.pop(batch))
+            {
+                batch.clear();
+                if(!readBatch(batch) || !readQueue.push(std::move(batch)))
+                {
+                    break;
+                }
+            }
+        }
+        catch(...)
+        {
+            readerError = std::current_exception();
+        }
+        readQueue.close();
+    });
+
+    std::thread hasherThread([&]()
+    {
+        try
+        {
+            PendingPublish pending;
+            size_t round = 0;
+            while(publishQueue.pop(pending))
+            {
+                applyBatchDigests(pending);
+                mbptree->digestCompute();
+                if(pending.logSeq != 0)
+                {
+                    log->sync(pending.logSeq); // 这一批落盘之后才能让客户端看到其根摘要
+                }
+                pending.info.round = ++round;
+                pending.info.version = pending.snapshot->getVersion();
+                commitIndex(std::move(pending.snapshot), pending.changed);
+                if(onPublished)
+                {
+                    onPublished(pending.info);
+                }
+            }
+        }
+        catch(...)
+        {
+            hasherError = std::current_exception();
+        }
+        publishQueue.close(); // 摘要线程出错时让调用线程停下
+    });
+
+    try
+    {
+        UpdateBatch batch;
+        std::unordered_set<VertexID> seen;
+        std::vector<VertexID> detached;
+        while(readQueue.pop(batch))
+        {
+            if(dropNoOps) // 插入已有的边、删除不存在的边不会改变图，不必进入核心维护和摘要计算
+            {
+                dropNoOpUpdates(graph, batch.removes, false);
+                dropNoOpUpdates(graph, batch.inserts, true);
+            }
+            uint64_t logSeq = 0;
+            if(log != nullptr) // 先写日志再修改索引，prepareIndex会把这一批发布为publishedVersion + 1
+            {
+                logSeq = log->append(publishedVersion + 1, batch);
+            }
+            applyBatch(graph, batch, detached);
+
+            PendingPublish pending;
+            pending.logSeq = logSeq;
+            pending.info.updateNum = batch.updateNum;
+            pending.info.insertNum = batch.inserts.size();
+            pending.info.removeNum = batch.removes.size();
+            collectBatchDigests(graph, batch, detached, seen, pending);
+            pending.snapshot = prepareIndex(graph, pending.changed);
+            freeQueue.push(std::move(batch));
+            if(!publishQueue.push(std::move(pending)))
             {
                 break;
             }
-            candGraph.removeVertex(minDegreeV, true, false);
         }
-        else
+    }
+    catch(...)
+    {
+        applyError = std::current_exception();
+    }
+    readQueue.close();
+    freeQueue.close();
+    publishQueue.close(); // 摘要线程处理完已经排队的批后退出
+    readerThread.join();
+    hasherThread.join();
+
+    for(const std::exception_ptr& error : {applyError, readerError, hasherError})
+    {
+        if(error)
         {
-            satisfyKcore = true;
-            break;
+            std::rethrow_exception(error);
         }
     }
-    if(!satisfyKcore)
+}
+
+std::shared_ptr<const IndexSnapshot> semiIndexExtractor::getSnapshot() const
+{
+    std::lock_guard<std::mutex> lock(snapshotMtx);
+    if(snapshots.empty())
     {
-        std::cout << "The graph does not satisfy k-core property." << std::endl;
+        return nullptr;
     }
+    return snapshots.back();
 }
 
-Graph semiIndexExtractor::kcoreExtract(const Graph& graph, const VertexID& queryV, const uint& k)
+std::shared_ptr<const IndexSnapshot> semiIndexExtractor::getSnapshot(uint version) const
+{
+    std::lock_guard<std::mutex> lock(snapshotMtx);
+    for(const std::shared_ptr<const IndexSnapshot>& retained : snapshots)
+    {
+        if(retained->getVersion() == version)
+        {
+            return retained;
+        }
+    }
+    return nullptr;
+}
+
+void semiIndexExtractor::invalidateQueryCache(const IndexSnapshot* previous, const IndexSnapshot& published, const std::vector<VertexID>& changed)
+{
+    if(shellRebuilt || previous == nullptr || !previous->isShellReady() || !published.isShellReady())
+    {
+        queryCache.clear(published.getVersion());
+        shellRebuilt = false;
+        return ;
+    }
+    // 改变的节点在新旧两棵树中所在的shell node及其祖先，覆盖了所有包含它的连通k-core
+    std::set<std::pair<uint, uint>> touchedNodes;
+    for(const VertexID& vid : changed)
+    {
+        previous->shellPath(vid, touchedNodes);
+        published.shellPath(vid, touchedNodes);
+    }
+    queryCache.invalidate(touchedNodes, published.getVersion());
+}
+
+bool semiIndexExtractor::getRootDigest(uint version, unsigned char* _digest) const
+{
+    std::shared_ptr<const IndexSnapshot> retained = getSnapshot(version);
+    if(retained == nullptr)
+    {
+        return false;
+    }
+    retained->getRootDigest(_digest);
+    return true;
+}
+
+QueryContext* semiIndexExtractor::acquireContext()
 {
-    if(!answerExists)
     {
-        answerExists = false;
+        std::lock_guard<std::mutex> lock(contextMtx);
+        if(!idleContexts.empty())
+        {
+            QueryContext* ctx = idleContexts.back();
+            idleContexts.pop_back();
+            return ctx;
+        }
     }
+    return new QueryContext();
+}
 
-    candidateGeneration(graph, queryV, k);
+void semiIndexExtractor::releaseContext(QueryContext* ctx)
+{
+    std::lock_guard<std::mutex> lock(contextMtx);
+    idleContexts.emplace_back(ctx);
+}
+
+void semiIndexExtractor::kcoreQuery(const IndexSnapshot& snapshot, const VertexID& queryV, const uint& k, QueryContext& ctx) const
+{
+    if(!snapshot.isShellReady() || snapshot.getCore(queryV) < k)
+    {
+        extractCandidates(snapshot, queryV, k, ctx);
+        constructVO(snapshot, ctx);
+        return ;
+    }
 
-    if(!answerExists)
+    // 同一连通k-core中的查询结果相同，按其顶层shell node缓存
+    const FrozenShellNode& top = snapshot.kcoreNode(queryV, k);
+    QueryCacheKey key(top.coreLevel, top.id, k);
+    std::shared_ptr<const CachedAnswer> answer;
+    std::shared_ptr<const CachedVO> cachedVO;
+    if(queryCache.lookup(key, snapshot.getVersion(), answer, cachedVO))
     {
-        candGraph.buildInvertedIndex();
-        globalExtract(queryV, k);
+        loadCachedAnswer(snapshot, key, *answer, cachedVO, ctx);
+        return ;
     }
 
-    // constructVO(graph, candGraph);
-    return candGraph;
+    extractCandidates(snapshot, queryV, k, ctx);
+    std::shared_ptr<CachedAnswer> freshAnswer = std::make_shared<CachedAnswer>();
+    freshAnswer->vertices = ctx.vertices;
+    freshAnswer->offsets = ctx.offsets;
+    freshAnswer->adjacency = ctx.adjacency;
+    freshAnswer->serializedInfo = serializeGraphInfo(snapshot, ctx);
+    std::shared_ptr<CachedVO> freshVO = std::make_shared<CachedVO>();
+    snapshot.getRootDigest(freshVO->rootDigest);
+    std::vector<VertexID> subgraphVids(ctx.vertices);
+    snapshot.getMbpRoot().constructVO(freshVO->vo, subgraphVids, freshAnswer->serializedInfo, VO_PAYLOAD_TYPE);
+    ctx.vo.reserve(freshVO->vo.size());
+    for(const VOEntry& entry : freshVO->vo)
+    {
+        ctx.vo.emplace_back(entry);
+    }
+    queryCache.insert(key, snapshot.getVersion(), freshAnswer, freshVO);
 }
 
-std::chrono::milliseconds semiIndexExtractor::kcoreExtractByShell(const Graph& graph, const VertexID& queryV, const uint& k)
+void semiIndexExtractor::loadCachedAnswer(const IndexSnapshot& snapshot, const QueryCacheKey& key, const CachedAnswer& answer, std::shared_ptr<const CachedVO> cachedVO, QueryContext& ctx) const
 {
-    auto start = std::chrono::high_resolution_clock::now();
-    constructVO(graph, candGraph);
-    auto end = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    std::cout << "VO construction time: " << duration.count() << " ms" << std::endl;
-    return shellTree->query(graph, queryV, coremaintainer.getCore(queryV), k) + duration;
+    ctx.reset();
+    ctx.snapshotVersion = snapshot.getVersion();
+    ctx.vertices = answer.vertices;
+    ctx.offsets = answer.offsets;
+    ctx.adjacency = answer.adjacency;
+    ctx.answerExists = true;
+
+    unsigned char rootDigest[SHA256_DIGEST_LENGTH];
+    snapshot.getRootDigest(rootDigest);
+    if(cachedVO == nullptr || memcmp(cachedVO->rootDigest, rootDigest, SHA256_DIGEST_LENGTH) != 0)
+    {
+        // 结果子图没有变化但其他分量的更新改变了MbpTree，只按当前的根重新构造VO
+        std::shared_ptr<CachedVO> rebuilt = std::make_shared<CachedVO>();
+        memcpy(rebuilt->rootDigest, rootDigest, SHA256_DIGEST_LENGTH);
+        std::vector<VertexID> subgraphVids(answer.vertices);
+        snapshot.getMbpRoot().constructVO(rebuilt->vo, subgraphVids, answer.serializedInfo, VO_PAYLOAD_TYPE);
+        queryCache.updateVO(key, snapshot.getVersion(), rebuilt);
+        cachedVO = rebuilt;
+    }
+    ctx.vo.reserve(cachedVO->vo.size());
+    for(const VOEntry& entry : cachedVO->vo)
+    {
+        ctx.vo.emplace_back(entry);
+    }
+}
+
+void semiIndexExtractor::kcoreQueryBatch(std::shared_ptr<const IndexSnapshot> snapshot, const std::vector<VertexID>& queries, const uint& k, const std::function<void(size_t, const QueryContext&)>& onResult)
+{
+    if(snapshot == nullptr)
+    {
+        std::cerr << "No index snapshot has been published." << std::endl;
+        throw std::runtime_error("No index snapshot has been published.");
+    }
+    pool->parallelFor(queries.size(), [&](size_t i)
+    {
+        QueryContext* ctx = acquireContext();
+        kcoreQuery(*snapshot, queries[i], k, *ctx);
+        onResult(i, *ctx);
+        releaseContext(ctx);
+    });
+}
+
+void semiIndexExtractor::kcoreQueryGroups(std::shared_ptr<const IndexSnapshot> snapshot, const std::vector<std::pair<VertexID, uint>>& queries, const std::function<void(size_t, const QueryContext&)>& onResult)
+{
+    if(snapshot == nullptr)
+    {
+        std::cerr << "No index snapshot has been published." << std::endl;
+        throw std::runtime_error("No index snapshot has been published.");
+    }
+
+    struct QueryGroup
+    {
+        std::vector<size_t> members; // queries下标
+        std::set<uint> ks;
+        std::shared_ptr<const CachedAnswer> answer;
+        std::shared_ptr<const CachedVO> vo;
+    };
+
+    // 连通k-core由其顶层shell node决定，不同k落在同一节点的查询结果也相同
+    std::map<std::pair<uint, uint>, QueryGroup> groupOf;
+    std::vector<size_t> singles; // 结果为空或shell tree不可用的查询，单独执行
+    for(size_t i = 0; i < queries.size(); i++)
+    {
+        if(snapshot->isShellReady() && snapshot->getCore(queries[i].first) >= queries[i].second)
+        {
+            const FrozenShellNode& top = snapshot->kcoreNode(queries[i].first, queries[i].second);
+            QueryGroup& group = groupOf[std::make_pair(top.coreLevel, top.id)];
+            group.members.emplace_back(i);
+            group.ks.emplace(queries[i].second);
+        }
+        else
+        {
+            singles.emplace_back(i);
+        }
+    }
+    std::vector<std::pair<uint, uint>> nodes;
+    std::vector<QueryGroup*> groups;
+    for(std::pair<const std::pair<uint, uint>, QueryGroup>& p : groupOf)
+    {
+        nodes.emplace_back(p.first);
+        groups.emplace_back(&p.second);
+        for(const uint& k : p.second.ks)
+        {
+            if(queryCache.lookup(QueryCacheKey(p.first.first, p.first.second, k), snapshot->getVersion(), p.second.answer, p.second.vo))
+            {
+                break;
+            }
+        }
+    }
+
+    // 缓存中没有的分量并行提取
+    pool->parallelFor(groups.size(), [&](size_t g)
+    {
+        if(groups[g]->answer != nullptr)
+        {
+            return ;
+        }
+        const std::pair<VertexID, uint>& rep = queries[groups[g]->members.front()];
+        QueryContext* ctx = acquireContext();
+        extractCandidates(*snapshot, rep.first, rep.second, *ctx);
+        std::shared_ptr<CachedAnswer> freshAnswer = std::make_shared<CachedAnswer>();
+        freshAnswer->vertices = ctx->vertices;
+        freshAnswer->offsets = ctx->offsets;
+        freshAnswer->adjacency = ctx->adjacency;
+        freshAnswer->serializedInfo = serializeGraphInfo(*snapshot, *ctx);
+        groups[g]->answer = freshAnswer;
+        releaseContext(ctx);
+    });
+
+    // 没有VO或VO对应旧根的分量共用一次MbpTree遍历
+    unsigned char rootDigest[SHA256_DIGEST_LENGTH];
+    snapshot->getRootDigest(rootDigest);
+    std::vector<std::shared_ptr<CachedVO>> builtVOs(groups.size());
+    std::vector<VOTarget> targets;
+    std::deque<VectorVOSink> sinks;
+    targets.reserve(groups.size());
+    for(size_t g = 0; g < groups.size(); g++)
+    {
+        if(groups[g]->vo != nullptr && memcmp(groups[g]->vo->rootDigest, rootDigest, SHA256_DIGEST_LENGTH) == 0)
+        {
+            continue;
+        }
+        builtVOs[g] = std::make_shared<CachedVO>();
+        memcpy(builtVOs[g]->rootDigest, rootDigest, SHA256_DIGEST_LENGTH);
+        const std::vector<VertexID>& vertices = groups[g]->answer->vertices;
+        const std::map<VertexID, std::string>& serializedInfo = groups[g]->answer->serializedInfo;
+        sinks.emplace_back(builtVOs[g]->vo);
+        targets.emplace_back(VOTarget{vertices.data(), vertices.data() + vertices.size(), [&serializedInfo](const VertexID& vid) -> const std::string&
+        {
+            return serializedInfo.at(vid);
+        }, VO_PAYLOAD_TYPE, &sinks.back()});
+    }
+    if(!targets.empty())
+    {
+        std::vector<VOTarget*> targetPtrs;
+        for(VOTarget& target : targets)
+        {
+            targetPtrs.emplace_back(&target);
+        }
+        snapshot->getMbpRoot().constructSharedVO(targetPtrs);
+    }
+    for(size_t g = 0; g < groups.size(); g++)
+    {
+        if(builtVOs[g] == nullptr)
+        {
+            continue;
+        }
+        groups[g]->vo = builtVOs[g];
+        for(const uint& k : groups[g]->ks)
+        {
+            queryCache.insert(QueryCacheKey(nodes[g].first, nodes[g].second, k), snapshot->getVersion(), groups[g]->answer, groups[g]->vo);
+        }
+    }
+
+    pool->parallelFor(groups.size() + singles.size(), [&](size_t j)
+    {
+        QueryContext* ctx = acquireContext();
+        if(j < groups.size())
+        {
+            QueryCacheKey key(nodes[j].first, nodes[j].second, *groups[j]->ks.begin());
+            loadCachedAnswer(*snapshot, key, *groups[j]->answer, groups[j]->vo, *ctx);
+            for(const size_t& i : groups[j]->members)
+            {
+                onResult(i, *ctx);
+            }
+        }
+        else
+        {
+            size_t i = singles[j - groups.size()];
+            kcoreQuery(*snapshot, queries[i].first, queries[i].second, *ctx);
+            onResult(i, *ctx);
+        }
+        releaseContext(ctx);
+    });
+}
+
+void semiIndexExtractor::kcoreMultiProof(const IndexSnapshot& snapshot, const std::vector<std::pair<VertexID, uint>>& queries, MultiProof& proof, QueryContext& ctx) const
+{
+    proof.communities.clear();
+    proof.communityOf.assign(queries.size(), 0);
+    std::map<std::pair<uint, uint>, uint> communityOfNode; // 落在同一shell node的查询结果相同
+    for(size_t i = 0; i < queries.size(); i++)
+    {
+        std::pair<uint, uint> node(FrozenShellNode::NONE, FrozenShellNode::NONE);
+        if(snapshot.isShellReady() && snapshot.getCore(queries[i].first) >= queries[i].second)
+        {
+            const FrozenShellNode& top = snapshot.kcoreNode(queries[i].first, queries[i].second);
+            node = std::make_pair(top.coreLevel, top.id);
+            std::map<std::pair<uint, uint>, uint>::iterator it = communityOfNode.find(node);
+            if(it != communityOfNode.end())
+            {
+                proof.communityOf[i] = it->second;
+                continue;
+            }
+        }
+        extractCandidates(snapshot, queries[i].first, queries[i].second, ctx);
+        proof.communityOf[i] = proof.communities.size();
+        if(node.first != FrozenShellNode::NONE)
+        {
+            communityOfNode[node] = proof.communities.size();
+        }
+        proof.communities.emplace_back(ctx.vertices);
+    }
+
+    // 并集子图中每个节点的邻居是它在并集中的全部邻居，包含了它在每个结果子图中的邻居
+    ctx.reset();
+    ctx.snapshotVersion = snapshot.getVersion();
+    for(const std::vector<VertexID>& community : proof.communities)
+    {
+        for(const VertexID& vid : community)
+        {
+            if(ctx.mark(vid))
+            {
+                ctx.vertices.emplace_back(vid);
+            }
+        }
+    }
+    buildCandAdjacency(snapshot, ctx);
+    ctx.answerExists = !ctx.vertices.empty();
+    constructVO(snapshot, ctx);
 }
 
 // Graph semiIndexExtractor::kcoreExtractByShell(const Graph& graph, const VertexID& queryV, const uint& k)
@@ -566,20 +1479,25 @@ std::chrono::milliseconds semiIndexExtractor::kcoreExtractByShell(const Graph& g
 //     return candGraph;
 // }
 
-const Graph& semiIndexExtractor::getCandGraph() const
+const QueryContext& semiIndexExtractor::getQueryContext() const
 {
-    return candGraph;
+    return queryCtx;
 }
 
 void semiIndexExtractor::buildShellTree(const Graph& graph)
 {
+    indexDirty = true;
+    shellRebuilt = true;
+    snapshotRebuild = true;
     if(shellTree != nullptr)
     {
+        coremaintainer.attachShellTree(nullptr);
         delete shellTree;
         shellTree = nullptr;
     }
     shellTree = new ShellTree();
     shellTree->buildTree(graph, coremaintainer.getCoresSet());
+    coremaintainer.attachShellTree(shellTree); // 之后的核心维护会同步修复shell tree，不需要重新构建
 }
 
 void semiIndexExtractor::getTestData(const Graph& graph)
@@ -679,6 +1597,7 @@ void semiIndexExtractor::getTestData(const Graph& graph)
 
 void semiIndexExtractor::printVO() const
 {
+    const std::vector<VOEntry>& vo = queryCtx.vo;
     for(size_t i = 0; i < vo.size(); i++)
     {
         vo[i].printVOEntry();
@@ -692,12 +1611,12 @@ void semiIndexExtractor::printVO() const
 
 void semiIndexExtractor::printLiIndex() const
 {
-    if(liIndex.empty())
+    if(queryCtx.liIndex.empty())
     {
         std::cout << "LiIndex is empty." << std::endl;
         return;
     }
-    for (const auto& pair : liIndex)
+    for (const auto& pair : queryCtx.liIndex)
     {
         std::cout << "Key: " << pair.first << ", Values: ";
         for (const auto& value : pair.second)
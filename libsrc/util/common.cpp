@@ -1,5 +1,9 @@
 #include "util/common.h"
 
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
 
 cmdOptions parseCmdLineArgs(int argc, char* argv[])
 {
@@ -9,12 +13,19 @@ cmdOptions parseCmdLineArgs(int argc, char* argv[])
     parser.add<std::string>("filename", 'f', "Graph data file path", true);
     parser.add<std::string>("addFilename", 'a', "Graph data file path for adding edges", false);
     parser.add<std::string>("deleteFilename", 'd', "Graph data file path for deleting edges", false);
+    parser.add<std::string>("updateFilename", 'u', "Update log file path with +/- op codes for mixed insert/delete batches", false);
+    parser.add<std::string>("checkpointFilename", 's', "Write an index checkpoint to this path after the insert phase", false);
+    parser.add<std::string>("restoreFilename", 'r', "Restore the graph and index from this checkpoint instead of building them", false);
+    parser.add<std::string>("updateLogFilename", 'w', "Write-ahead log of applied update batches, replayed after restoring a checkpoint", false);
     parser.add<std::string>("experimentFilePath", 'e', "record experiment result file path", false);
     parser.add<VertexID>("query", 'q', "Query vertex ID", false);
     parser.add<uint>("k", 'k', "kmax of k-core subgraph", false);
     parser.add<uint>("khop", 'h', "k-hop neighborhood of query vertex", false, 6);
     parser.add<uint>("maxcapacity", 'c', "Maximum capacity of the Mbptree", false, 16);
     parser.add<std::string>("queryFile", 'Q', "File containing query information", false);
+    parser.add<uint>("threads", 't', "Number of worker threads (0 for hardware concurrency)", false, 0);
+    parser.add("compressAdjacency", 'z', "Store large neighbor lists delta+varint compressed");
+    parser.add<std::string>("vertexOrder", 'o', "Local vertex numbering for core decomposition and shell tree building", false, "id", cmdline::oneof<std::string>("id", "degree", "rcm"));
 
 
     parser.parse_check(argc, argv);
@@ -23,11 +34,18 @@ cmdOptions parseCmdLineArgs(int argc, char* argv[])
     options.filename = parser.get<std::string>("filename");
     options.addFilename = parser.get<std::string>("addFilename");
     options.deleteFilename = parser.get<std::string>("deleteFilename");
+    options.updateFilename = parser.get<std::string>("updateFilename");
+    options.checkpointFilename = parser.get<std::string>("checkpointFilename");
+    options.restoreFilename = parser.get<std::string>("restoreFilename");
+    options.updateLogFilename = parser.get<std::string>("updateLogFilename");
     options.experimentFilePath = parser.get<std::string>("experimentFilePath");
     options.query = parser.get<VertexID>("query");
     options.k = parser.get<uint>("k");
     options.khop = parser.get<uint>("khop");
     options.maxcapacity = parser.get<uint>("maxcapacity");
+    options.threadNum = parser.get<uint>("threads");
+    options.compressAdjacency = parser.exist("compressAdjacency");
+    options.vertexOrder = parser.get<std::string>("vertexOrder");
     if(parser.exist("queryFile"))
     {
         std::ifstream inFile(parser.get<std::string>("queryFile"));
@@ -60,10 +78,15 @@ cmdOptions parseCmdLineArgs(int argc, char* argv[])
         std::cout << "file path: "<< options.filename << std::endl;
         std::cout << "add file path: "<< options.addFilename << std::endl;
         std::cout << "delete file path: "<< options.deleteFilename << std::endl;
+        std::cout << "update file path: "<< options.updateFilename << std::endl;
+        std::cout << "checkpoint file path: "<< options.checkpointFilename << std::endl;
+        std::cout << "restore file path: "<< options.restoreFilename << std::endl;
+        std::cout << "update log file path: "<< options.updateLogFilename << std::endl;
         std::cout << "query vertex: "<< options.query << std::endl;
         std::cout << "k: " << options.k << std::endl;
         std::cout << "khop: " << options.khop << std::endl;
         std::cout << "max capacity: " << options.maxcapacity << std::endl;
+        std::cout << "threads: " << options.threadNum << std::endl;
         std::cout << PRINT_SEPARATOR << std::endl;
     }
 
@@ -114,3 +137,107 @@ std::queue<VOEntry> convertVectorToQueue(const std::vector<VOEntry>& VO)
     return queue;
 }
 
+
+void appendVarint(uint64_t value, std::string& out)
+{
+    while(value >= 0x80)
+    {
+        out.push_back((char)((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+uint64_t readVarint(const unsigned char*& cur, const unsigned char* end)
+{
+    uint64_t value = 0;
+    for(uint shift = 0; shift < 64; shift += 7)
+    {
+        if(cur == end)
+        {
+            std::cerr << "Varint Error: payload ends inside a varint" << std::endl;
+            throw std::runtime_error("Varint Error: payload ends inside a varint");
+        }
+        unsigned char byte = *cur++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+    std::cerr << "Varint Error: varint is too long" << std::endl;
+    throw std::runtime_error("Varint Error: varint is too long");
+}
+
+void decodeVertexPayload(const unsigned char* bytes, size_t length, VertexID& vid, std::vector<VertexID>& neighbors, std::vector<VertexID>& subgraphNeighbors)
+{
+    const unsigned char* cur = bytes;
+    const unsigned char* end = bytes + length;
+    vid = readVarint(cur, end);
+    uint64_t degree = readVarint(cur, end);
+    if(degree > length * 8)
+    {
+        std::cerr << "Payload Error: degree " << degree << " does not fit in " << length << " bytes" << std::endl;
+        throw std::runtime_error("Payload Error: invalid degree");
+    }
+    neighbors.clear();
+    subgraphNeighbors.clear();
+    VertexID prev = 0;
+    for(uint64_t i = 0; i < degree; i++)
+    {
+        prev += readVarint(cur, end);
+        neighbors.emplace_back(prev);
+    }
+    if((size_t)(end - cur) != (degree + 7) / 8)
+    {
+        std::cerr << "Payload Error: bitmap of vertex " << vid << " has a wrong length" << std::endl;
+        throw std::runtime_error("Payload Error: wrong bitmap length");
+    }
+    for(uint64_t i = 0; i < degree; i++)
+    {
+        if(cur[i / 8] & (1 << (i % 8)))
+        {
+            subgraphNeighbors.emplace_back(neighbors[i]);
+        }
+    }
+}
+
+std::string vertexDigestPreimage(const VertexID& vid, const std::vector<VertexID>& neighbors)
+{
+    std::ostringstream oss;
+    unsigned char splitter = '/';
+    oss << vid;
+    for(const VertexID& neighbor : neighbors)
+    {
+        oss << splitter << neighbor;
+    }
+    return oss.str();
+}
+
+bool syncFile(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        return false;
+    }
+    int ret;
+    while((ret = fsync(fd)) != 0 && errno == EINTR);
+    close(fd);
+    return ret == 0;
+}
+
+bool syncParentDirectory(const std::string& path)
+{
+    size_t slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if(fd < 0)
+    {
+        return false;
+    }
+    int ret;
+    while((ret = fsync(fd)) != 0 && errno == EINTR);
+    close(fd);
+    return ret == 0;
+}
@@ -1,6 +1,14 @@
 #include "util/edgeReader.h"
+#include "util/common.h"
 
-EdgeReader::EdgeReader(const std::string& _filePath)
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+EdgeReader::EdgeReader(const std::string& _filePath) : data(nullptr), size(0), pos(0), format(TEXT), endOfFile(true)
 {
     if(!_filePath.empty())
     {
@@ -10,58 +18,268 @@ EdgeReader::EdgeReader(const std::string& _filePath)
 
 EdgeReader::~EdgeReader()
 {
-    if(file.is_open())
+    closeFile();
+}
+
+void EdgeReader::closeFile()
+{
+    if(data != nullptr)
     {
-        file.close();
+        munmap((void*)data, size);
+        data = nullptr;
     }
+    size = 0;
+    pos = 0;
 }
 
 void EdgeReader::setFilePath(const std::string& _filePath)
 {
+    closeFile();
     filePath = _filePath;
-    endOfFile =false;
-    file.open(filePath);
-    if(!file.is_open())
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if(fd < 0)
     {
         std::cerr << "Error: cannot open file " << filePath << std::endl;
         throw std::runtime_error("Error: cannot open file " + filePath);
     }
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        close(fd);
+        std::cerr << "Error: cannot stat file " << filePath << std::endl;
+        throw std::runtime_error("Error: cannot stat file " + filePath);
+    }
+    size = st.st_size;
+    if(size > 0)
+    {
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapped == MAP_FAILED)
+        {
+            close(fd);
+            size = 0;
+            std::cerr << "Error: cannot map file " << filePath << ": " << std::strerror(errno) << std::endl;
+            throw std::runtime_error("Error: cannot map file " + filePath);
+        }
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        data = (const char*)mapped;
+    }
+    close(fd);
+
+    format = TEXT;
+    pos = 0;
+    if(size >= std::strlen(EDGE_BINARY_MAGIC) && std::memcmp(data, EDGE_BINARY_MAGIC, std::strlen(EDGE_BINARY_MAGIC)) == 0)
+    {
+        format = BINARY_EDGES;
+        pos = std::strlen(EDGE_BINARY_MAGIC);
+    }
+    else if(size >= std::strlen(UPDATE_BINARY_MAGIC) && std::memcmp(data, UPDATE_BINARY_MAGIC, std::strlen(UPDATE_BINARY_MAGIC)) == 0)
+    {
+        format = BINARY_UPDATES;
+        pos = std::strlen(UPDATE_BINARY_MAGIC);
+    }
+    endOfFile = pos >= size;
 }
 
-std::vector<std::pair<VertexID, VertexID>> EdgeReader::readNextEdges(const uint& num)
+bool EdgeReader::parseTextEdge(VertexID& src, VertexID& dst, bool& isInsert)
+{
+    VertexID* fields[2] = {&src, &dst};
+    while(true)
+    {
+        // 跳过空白和空行
+        while(pos < size && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\r' || data[pos] == '\n'))
+        {
+            pos++;
+        }
+        if(pos >= size)
+        {
+            return false;
+        }
+        size_t lineStart = pos;
+        isInsert = true;
+        if(data[pos] == '+' || data[pos] == '-')
+        {
+            isInsert = data[pos] == '+';
+            pos++;
+        }
+        for(uint f = 0; f < 2; f++)
+        {
+            while(pos < size && (data[pos] == ' ' || data[pos] == '\t'))
+            {
+                pos++;
+            }
+            uint64_t value = 0;
+            size_t digitStart = pos;
+            while(pos < size && (unsigned char)(data[pos] - '0') < 10)
+            {
+                value = value * 10 + (data[pos] - '0');
+                pos++;
+            }
+            if(pos == digitStart || value > UINT_MAX)
+            {
+                size_t lineEnd = lineStart;
+                while(lineEnd < size && data[lineEnd] != '\n')
+                {
+                    lineEnd++;
+                }
+                std::cerr << "Error: Invalid input format: " << std::string(data + lineStart, lineEnd - lineStart) << std::endl;
+                throw std::runtime_error("Invalid input format in file " + filePath);
+            }
+            *fields[f] = value;
+        }
+        // 与原来按行读取一致，忽略行内剩余的内容
+        while(pos < size && data[pos] != '\n')
+        {
+            pos++;
+        }
+        return true;
+    }
+}
+
+bool EdgeReader::parseBinaryEdge(VertexID& src, VertexID& dst, bool& isInsert)
 {
+    if(pos >= size)
+    {
+        return false;
+    }
+    const unsigned char* cur = (const unsigned char*)data + pos;
+    const unsigned char* end = (const unsigned char*)data + size;
+    uint64_t srcValue = readVarint(cur, end);
+    uint64_t dstValue = readVarint(cur, end);
+    isInsert = true;
+    if(format == BINARY_UPDATES)
+    {
+        isInsert = (srcValue & 1) == 0;
+        srcValue >>= 1;
+    }
+    if(srcValue > UINT_MAX || dstValue > UINT_MAX)
+    {
+        std::cerr << "Error: vertex id out of range at offset " << pos << " in " << filePath << std::endl;
+        throw std::runtime_error("Invalid binary edge in file " + filePath);
+    }
+    src = srcValue;
+    dst = dstValue;
+    pos = cur - (const unsigned char*)data;
+    return true;
+}
+
+bool EdgeReader::parseNext(VertexID& src, VertexID& dst, bool& isInsert)
+{
+    return format == TEXT ? parseTextEdge(src, dst, isInsert) : parseBinaryEdge(src, dst, isInsert);
+}
+
+void EdgeReader::finishBatch()
+{
+    // 剩下的只有空白时也视为读完，避免下一次调用返回空的一批
+    if(format == TEXT)
+    {
+        while(pos < size && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\r' || data[pos] == '\n'))
+        {
+            pos++;
+        }
+    }
+    endOfFile = pos >= size;
+}
+
+uint EdgeReader::readNextEdges(const uint& num, std::vector<std::pair<VertexID, VertexID>>& edges)
+{
+    edges.clear();
     if(endOfFile || num == 0)
     {
         std::cout << "File end reached or no more edges to read" << std::endl;
-        return {};
+        return 0;
     }
 
-    std::vector<std::pair<VertexID, VertexID>> edges;
-    std::string line;
-    uint linesRead = 0;
-
-    while(std::getline(file, line) && linesRead < num)
+    VertexID src, dst;
+    bool isInsert;
+    while(edges.size() < num && parseNext(src, dst, isInsert))
     {
-        std::istringstream iss(line);
-        VertexID src, dst;
-        if(!(iss >> src >> dst))
+        if(!isInsert)
         {
-            std::cerr<<"Error: Invalid input format: "<<line<<std::endl;
-            throw std::runtime_error("Invalid input format in file " + filePath);
+            std::cerr << "Error: " << filePath << " contains deletions, read it with readNextUpdates" << std::endl;
+            throw std::runtime_error("Unexpected deletion in edge file " + filePath);
         }
         edges.emplace_back(src, dst);
-        linesRead++;
     }
+    finishBatch();
+    return edges.size();
+}
 
-    if(file.eof())
+uint EdgeReader::readNextUpdates(const uint& num, std::vector<EdgeUpdate>& updates)
+{
+    updates.clear();
+    if(endOfFile || num == 0)
+    {
+        std::cout << "File end reached or no more edges to read" << std::endl;
+        return 0;
+    }
+
+    EdgeUpdate update;
+    while(updates.size() < num && parseNext(update.src, update.dst, update.isInsert))
     {
-        endOfFile = true;
+        updates.emplace_back(update);
     }
+    finishBatch();
+    return updates.size();
+}
 
+std::vector<std::pair<VertexID, VertexID>> EdgeReader::readNextEdges(const uint& num)
+{
+    std::vector<std::pair<VertexID, VertexID>> edges;
+    readNextEdges(num, edges);
     return edges;
 }
 
 bool EdgeReader::isEndOfFile() const
 {
     return endOfFile;
-}
\ No newline at end of file
+}
+
+void EdgeReader::convertToBinary(const std::string& textPath, const std::string& binaryPath)
+{
+    EdgeReader reader(textPath);
+    std::ofstream out(binaryPath, std::ios::binary | std::ios::trunc);
+    if(!out.is_open())
+    {
+        std::cerr << "Error: cannot open file " << binaryPath << std::endl;
+        throw std::runtime_error("Error: cannot open file " + binaryPath);
+    }
+    out.write(EDGE_BINARY_MAGIC, std::strlen(EDGE_BINARY_MAGIC));
+    std::vector<std::pair<VertexID, VertexID>> edges;
+    std::string buffer;
+    while(!reader.isEndOfFile())
+    {
+        reader.readNextEdges(1 << 16, edges);
+        buffer.clear();
+        for(const std::pair<VertexID, VertexID>& edge : edges)
+        {
+            appendVarint(edge.first, buffer);
+            appendVarint(edge.second, buffer);
+        }
+        out.write(buffer.data(), buffer.size());
+    }
+}
+
+void EdgeReader::convertUpdatesToBinary(const std::string& textPath, const std::string& binaryPath)
+{
+    EdgeReader reader(textPath);
+    std::ofstream out(binaryPath, std::ios::binary | std::ios::trunc);
+    if(!out.is_open())
+    {
+        std::cerr << "Error: cannot open file " << binaryPath << std::endl;
+        throw std::runtime_error("Error: cannot open file " + binaryPath);
+    }
+    out.write(UPDATE_BINARY_MAGIC, std::strlen(UPDATE_BINARY_MAGIC));
+    std::vector<EdgeUpdate> updates;
+    std::string buffer;
+    while(!reader.isEndOfFile())
+    {
+        reader.readNextUpdates(1 << 16, updates);
+        buffer.clear();
+        for(const EdgeUpdate& update : updates)
+        {
+            appendVarint(((uint64_t)update.src << 1) | (update.isInsert ? 0 : 1), buffer);
+            appendVarint(update.dst, buffer);
+        }
+        out.write(buffer.data(), buffer.size());
+    }
+}
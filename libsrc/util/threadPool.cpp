@@ -0,0 +1,206 @@
+#include "util/threadPool.h"
+
+ThreadPool::ThreadPool(uint threadNum) : queuedTasks(0), unfinishedTasks(0), nextQueue(0), stop(false)
+{
+    if(threadNum == 0)
+    {
+        threadNum = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for(uint i = 0; i < threadNum; i++)
+    {
+        queues.emplace_back(new WorkerQueue());
+    }
+    for(uint i = 0; i < threadNum; i++)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(waitMtx);
+        stop = true;
+    }
+    taskCv.notify_all();
+    for(std::thread& worker : workers)
+    {
+        if(worker.joinable())
+        {
+            worker.join();
+        }
+    }
+}
+
+uint ThreadPool::size() const
+{
+    return workers.size();
+}
+
+bool ThreadPool::popTask(size_t queueIndex, std::function<void()>& task)
+{
+    size_t queueNum = queues.size();
+    {
+        WorkerQueue& own = *queues[queueIndex % queueNum];
+        std::lock_guard<std::mutex> lock(own.mtx);
+        if(!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            --queuedTasks;
+            return true;
+        }
+    }
+    for(size_t i = 1; i < queueNum; i++)
+    {
+        WorkerQueue& victim = *queues[(queueIndex + i) % queueNum];
+        std::lock_guard<std::mutex> lock(victim.mtx);
+        if(!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --queuedTasks;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::finishTask()
+{
+    if(--unfinishedTasks == 0)
+    {
+        std::lock_guard<std::mutex> lock(waitMtx);
+        doneCv.notify_all();
+    }
+}
+
+void ThreadPool::workerLoop(size_t queueIndex)
+{
+    std::function<void()> task;
+    while(true)
+    {
+        if(popTask(queueIndex, task))
+        {
+            task();
+            task = nullptr;
+            finishTask();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(waitMtx);
+        taskCv.wait(lock, [this]{ return stop || queuedTasks > 0; });
+        if(stop && queuedTasks == 0)
+        {
+            return ;
+        }
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    size_t queueIndex = nextQueue++ % queues.size();
+    ++unfinishedTasks;
+    {
+        // 先计数再入队，任务被其他线程取走时queuedTasks不会先于递增被递减
+        std::lock_guard<std::mutex> lock(waitMtx);
+        ++queuedTasks;
+    }
+    {
+        WorkerQueue& queue = *queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mtx);
+        queue.tasks.emplace_back(std::move(task));
+    }
+    taskCv.notify_one();
+}
+
+bool ThreadPool::runPendingTask()
+{
+    std::function<void()> task;
+    if(!popTask(nextQueue.load(), task))
+    {
+        return false;
+    }
+    task();
+    finishTask();
+    return true;
+}
+
+void ThreadPool::wait()
+{
+    while(unfinishedTasks > 0)
+    {
+        if(runPendingTask())
+        {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(waitMtx);
+        doneCv.wait(lock, [this]{ return unfinishedTasks == 0 || queuedTasks > 0; });
+    }
+}
+
+void ThreadPool::parallelFor(size_t num, const std::function<void(size_t)>& func)
+{
+    if(num == 0)
+    {
+        return ;
+    }
+    if(num == 1 || workers.size() <= 1)
+    {
+        for(size_t i = 0; i < num; i++)
+        {
+            func(i);
+        }
+        return ;
+    }
+
+    // 每个调用使用自己的计数器，多个调用者可以同时共享同一个线程池
+    size_t chunkNum = std::min(num, workers.size() * 4);
+    size_t chunkSize = (num + chunkNum - 1) / chunkNum;
+    chunkNum = (num + chunkSize - 1) / chunkSize;
+    std::shared_ptr<std::atomic<size_t>> remaining = std::make_shared<std::atomic<size_t>>(chunkNum);
+    std::mutex errorMtx;
+    std::exception_ptr firstError; // 第一个抛出的异常，所有块结束后在调用线程重新抛出
+    for(size_t chunk = 0; chunk < chunkNum; chunk++)
+    {
+        size_t begin = chunk * chunkSize;
+        size_t end = std::min(num, begin + chunkSize);
+        submit([&func, &errorMtx, &firstError, remaining, begin, end, this]()
+        {
+            try
+            {
+                for(size_t i = begin; i < end; i++)
+                {
+                    func(i);
+                }
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(errorMtx);
+                if(firstError == nullptr)
+                {
+                    firstError = std::current_exception();
+                }
+            }
+            if(--(*remaining) == 0)
+            {
+                std::lock_guard<std::mutex> lock(waitMtx);
+                doneCv.notify_all();
+            }
+        });
+    }
+
+    while(*remaining > 0)
+    {
+        if(runPendingTask())
+        {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(waitMtx);
+        doneCv.wait(lock, [this, &remaining]{ return *remaining == 0 || queuedTasks > 0; });
+    }
+    if(firstError != nullptr)
+    {
+        std::rethrow_exception(firstError);
+    }
+}
@@ -0,0 +1,43 @@
+#include "util/updateCoalescer.h"
+
+void UpdateBatch::clear()
+{
+    inserts.clear();
+    removes.clear();
+    updateNum = 0;
+    version = 0;
+}
+
+void UpdateCoalescer::coalesce(const std::vector<EdgeUpdate>& updates, UpdateBatch& batch)
+{
+    batch.clear();
+    batch.updateNum = updates.size();
+    slotOf.clear();
+    ops.clear();
+    for(const EdgeUpdate& update : updates)
+    {
+        VertexID low = std::min(update.src, update.dst);
+        VertexID high = std::max(update.src, update.dst);
+        uint64_t key = ((uint64_t)low << 32) | high;
+        std::pair<std::unordered_map<uint64_t, size_t>::iterator, bool> inserted = slotOf.emplace(key, ops.size());
+        if(inserted.second)
+        {
+            ops.emplace_back(update);
+        }
+        else
+        {
+            ops[inserted.first->second].isInsert = update.isInsert;
+        }
+    }
+    for(const EdgeUpdate& op : ops)
+    {
+        if(op.isInsert)
+        {
+            batch.inserts.emplace_back(op.src, op.dst);
+        }
+        else
+        {
+            batch.removes.emplace_back(op.src, op.dst);
+        }
+    }
+}
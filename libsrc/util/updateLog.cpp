@@ -0,0 +1,324 @@
+#include "util/updateLog.h"
+#include "util/common.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/sha.h>
+
+const uint UpdateLog::HEADER_LENGTH;
+const uint UpdateLog::CHECKSUM_LENGTH;
+
+UpdateLog::UpdateLog(const std::string& _filePath) : filePath(_filePath), fd(-1), fileSize(0), appendedSeq(0), syncedSeq(0)
+{
+    openFile();
+}
+
+UpdateLog::~UpdateLog()
+{
+    if(fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+void UpdateLog::writeAt(const char* data, size_t length, uint64_t offset) const
+{
+    while(length > 0)
+    {
+        ssize_t written = pwrite(fd, data, length, offset);
+        if(written < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "Error: cannot write update log " << filePath << ": " << std::strerror(errno) << std::endl;
+            throw std::runtime_error("Error: cannot write update log " + filePath);
+        }
+        data += written;
+        length -= written;
+        offset += written;
+    }
+}
+
+bool UpdateLog::readAt(char* data, size_t length, uint64_t offset) const
+{
+    while(length > 0)
+    {
+        ssize_t readNum = pread(fd, data, length, offset);
+        if(readNum < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "Error: cannot read update log " << filePath << ": " << std::strerror(errno) << std::endl;
+            throw std::runtime_error("Error: cannot read update log " + filePath);
+        }
+        if(readNum == 0)
+        {
+            return false;
+        }
+        data += readNum;
+        length -= readNum;
+        offset += readNum;
+    }
+    return true;
+}
+
+void UpdateLog::computeChecksum(const char* data, size_t length, unsigned char* checksum)
+{
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    SHA256((const unsigned char*)data, length, digest);
+    std::memcpy(checksum, digest, CHECKSUM_LENGTH);
+}
+
+void UpdateLog::openFile()
+{
+    fd = open(filePath.c_str(), O_RDWR | O_CREAT, 0644);
+    if(fd < 0)
+    {
+        std::cerr << "Error: cannot open file " << filePath << std::endl;
+        throw std::runtime_error("Error: cannot open file " + filePath);
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        std::cerr << "Error: cannot stat file " << filePath << std::endl;
+        throw std::runtime_error("Error: cannot stat file " + filePath);
+    }
+    uint64_t size = st.st_size;
+    size_t magicLength = std::strlen(UPDATE_LOG_MAGIC);
+    records.clear();
+    if(size < magicLength)
+    {
+        // 新文件，或者连文件头都没有写完
+        if(ftruncate(fd, 0) != 0)
+        {
+            std::cerr << "Error: cannot truncate update log " << filePath << std::endl;
+            throw std::runtime_error("Error: cannot truncate update log " + filePath);
+        }
+        writeAt(UPDATE_LOG_MAGIC, magicLength, 0);
+        fdatasync(fd);
+        syncParentDirectory(filePath); // 新建的日志文件的目录项也要落盘
+        fileSize = magicLength;
+        return ;
+    }
+    std::string magic(magicLength, '\0');
+    readAt(&magic[0], magicLength, 0);
+    if(magic != UPDATE_LOG_MAGIC)
+    {
+        std::cerr << "Error: " << filePath << " is not an update log" << std::endl;
+        throw std::runtime_error("Error: not an update log " + filePath);
+    }
+
+    uint64_t offset = magicLength;
+    std::string data;
+    unsigned char checksum[CHECKSUM_LENGTH];
+    while(offset < size)
+    {
+        uint header[3];
+        if(size - offset < HEADER_LENGTH + CHECKSUM_LENGTH || !readAt((char*)header, HEADER_LENGTH, offset))
+        {
+            break;
+        }
+        uint64_t recordLength = (uint64_t)HEADER_LENGTH + header[0] + CHECKSUM_LENGTH;
+        if(recordLength > size - offset)
+        {
+            break;
+        }
+        data.resize(recordLength);
+        if(!readAt(&data[0], recordLength, offset))
+        {
+            break;
+        }
+        computeChecksum(data.data(), HEADER_LENGTH + header[0], checksum);
+        if(std::memcmp(checksum, data.data() + HEADER_LENGTH + header[0], CHECKSUM_LENGTH) != 0 || (!records.empty() && header[1] <= records.back().version))
+        {
+            break;
+        }
+        records.push_back(Record{header[1], offset + HEADER_LENGTH, header[0], header[2]});
+        offset += recordLength;
+    }
+    if(offset < size)
+    {
+        // 崩溃时写了一半的记录，其批次没有发布过，丢弃即可
+        std::cerr << "UpdateLog: dropping " << size - offset << " bytes of incomplete records at the end of " << filePath << std::endl;
+        if(ftruncate(fd, offset) != 0)
+        {
+            std::cerr << "Error: cannot truncate update log " << filePath << std::endl;
+            throw std::runtime_error("Error: cannot truncate update log " + filePath);
+        }
+        fdatasync(fd);
+    }
+    fileSize = offset;
+}
+
+uint64_t UpdateLog::append(uint version, const UpdateBatch& batch)
+{
+    std::lock_guard<std::mutex> lock(appendMtx);
+    if(!records.empty() && version <= records.back().version)
+    {
+        std::cerr << "Error: update log version " << version << " is not after " << records.back().version << std::endl;
+        throw std::runtime_error("Error: update log versions must increase");
+    }
+    buffer.assign(HEADER_LENGTH, '\0');
+    for(const std::pair<VertexID, VertexID>& edge : batch.removes)
+    {
+        appendVarint(((uint64_t)edge.first << 1) | 1, buffer);
+        appendVarint(edge.second, buffer);
+    }
+    for(const std::pair<VertexID, VertexID>& edge : batch.inserts)
+    {
+        appendVarint((uint64_t)edge.first << 1, buffer);
+        appendVarint(edge.second, buffer);
+    }
+    uint header[3] = {(uint)(buffer.size() - HEADER_LENGTH), version, (uint)batch.updateNum};
+    std::memcpy(&buffer[0], header, HEADER_LENGTH);
+    unsigned char checksum[CHECKSUM_LENGTH];
+    computeChecksum(buffer.data(), buffer.size(), checksum);
+    buffer.append((const char*)checksum, CHECKSUM_LENGTH);
+
+    writeAt(buffer.data(), buffer.size(), fileSize);
+    records.push_back(Record{version, fileSize + HEADER_LENGTH, header[0], header[2]});
+    fileSize += buffer.size();
+    return ++appendedSeq;
+}
+
+void UpdateLog::sync(uint64_t seq)
+{
+    std::lock_guard<std::mutex> lock(syncMtx);
+    if(syncedSeq >= seq)
+    {
+        return ; // 前一次fdatasync已经覆盖
+    }
+    uint64_t target;
+    {
+        std::lock_guard<std::mutex> appendLock(appendMtx);
+        target = appendedSeq;
+    }
+    if(fdatasync(fd) != 0)
+    {
+        std::cerr << "Error: cannot sync update log " << filePath << ": " << std::strerror(errno) << std::endl;
+        throw std::runtime_error("Error: cannot sync update log " + filePath);
+    }
+    syncedSeq = target;
+}
+
+size_t UpdateLog::getRecordNum() const
+{
+    std::lock_guard<std::mutex> lock(appendMtx);
+    return records.size();
+}
+
+uint UpdateLog::getRecordVersion(size_t index) const
+{
+    std::lock_guard<std::mutex> lock(appendMtx);
+    return records.at(index).version;
+}
+
+void UpdateLog::readRecord(size_t index, UpdateBatch& batch) const
+{
+    Record record;
+    {
+        std::lock_guard<std::mutex> lock(appendMtx);
+        record = records.at(index);
+    }
+    std::string payload(record.payloadLength, '\0');
+    if(!readAt(&payload[0], payload.size(), record.offset))
+    {
+        std::cerr << "Error: update log " << filePath << " is shorter than its records" << std::endl;
+        throw std::runtime_error("Error: truncated update log " + filePath);
+    }
+    batch.clear();
+    batch.version = record.version;
+    batch.updateNum = record.updateNum;
+    const unsigned char* cur = (const unsigned char*)payload.data();
+    const unsigned char* end = cur + payload.size();
+    while(cur < end)
+    {
+        uint64_t src = readVarint(cur, end);
+        uint64_t dst = readVarint(cur, end);
+        std::vector<std::pair<VertexID, VertexID>>& edges = (src & 1) ? batch.removes : batch.inserts;
+        edges.emplace_back(src >> 1, dst);
+    }
+}
+
+void UpdateLog::discardThrough(uint version)
+{
+    std::lock_guard<std::mutex> syncLock(syncMtx);
+    std::lock_guard<std::mutex> lock(appendMtx);
+    size_t first = 0;
+    while(first < records.size() && records[first].version <= version)
+    {
+        first++;
+    }
+    if(first == 0)
+    {
+        return ;
+    }
+    size_t magicLength = std::strlen(UPDATE_LOG_MAGIC);
+    if(first == records.size())
+    {
+        if(ftruncate(fd, magicLength) != 0)
+        {
+            std::cerr << "Error: cannot truncate update log " << filePath << std::endl;
+            throw std::runtime_error("Error: cannot truncate update log " + filePath);
+        }
+        fdatasync(fd);
+        records.clear();
+        fileSize = magicLength;
+        syncedSeq = appendedSeq;
+        return ;
+    }
+
+    // 保留的记录复制到新文件，落盘后替换原文件，中途崩溃时原文件仍然完整
+    std::string tmpPath = filePath + ".tmp";
+    int tmpFd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(tmpFd < 0)
+    {
+        std::cerr << "Error: cannot open file " << tmpPath << std::endl;
+        throw std::runtime_error("Error: cannot open file " + tmpPath);
+    }
+    std::string chunk(UPDATE_LOG_MAGIC);
+    uint64_t offset = records[first].offset - HEADER_LENGTH;
+    bool ok = true;
+    while(ok && !chunk.empty())
+    {
+        for(size_t done = 0; ok && done < chunk.size(); )
+        {
+            ssize_t written = write(tmpFd, chunk.data() + done, chunk.size() - done);
+            if(written < 0 && errno != EINTR)
+            {
+                ok = false;
+            }
+            else if(written > 0)
+            {
+                done += written;
+            }
+        }
+        chunk.resize(std::min<uint64_t>(1 << 20, fileSize - offset));
+        ok = ok && readAt(&chunk[0], chunk.size(), offset);
+        offset += chunk.size();
+    }
+    ok = ok && fdatasync(tmpFd) == 0;
+    close(tmpFd);
+    if(!ok || std::rename(tmpPath.c_str(), filePath.c_str()) != 0)
+    {
+        std::remove(tmpPath.c_str());
+        std::cerr << "Error: cannot rewrite update log " << filePath << std::endl;
+        throw std::runtime_error("Error: cannot rewrite update log " + filePath);
+    }
+    if(!syncParentDirectory(filePath)) // 否则掉电后目录项可能仍指向旧日志
+    {
+        std::cerr << "Error: cannot sync the directory of " << filePath << ": " << std::strerror(errno) << std::endl;
+        throw std::runtime_error("Error: cannot sync the directory of " + filePath);
+    }
+    close(fd);
+    openFile();
+    syncedSeq = appendedSeq;
+}
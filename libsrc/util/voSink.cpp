@@ -0,0 +1,238 @@
+#include "util/voSink.h"
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+VectorVOSink::VectorVOSink(std::vector<VOEntry>& _vo) : vo(_vo) {}
+
+void VectorVOSink::special(char specialChar)
+{
+    vo.emplace_back(specialChar);
+}
+
+void VectorVOSink::digest(const unsigned char* digest)
+{
+    vo.emplace_back(digest, SHA256_DIGEST_LENGTH);
+}
+
+void VectorVOSink::payload(const std::string& payload, VOEntry::DataType type)
+{
+    vo.emplace_back(payload, type);
+}
+
+ByteVOSink::ByteVOSink(std::function<void(const char*, size_t)> _write) : write(_write), bytesWritten(0)
+{
+    buffer.reserve(VO_SINK_BUFFER_SIZE);
+}
+
+ByteVOSink::~ByteVOSink()
+{
+    try
+    {
+        flush();
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << "ByteVOSink: " << e.what() << std::endl;
+    }
+}
+
+void ByteVOSink::append(const char* data, size_t length)
+{
+    buffer.append(data, length);
+    if(buffer.size() >= VO_SINK_BUFFER_SIZE)
+    {
+        flush();
+    }
+}
+
+void ByteVOSink::special(char specialChar)
+{
+    append(&specialChar, 1);
+}
+
+void ByteVOSink::digest(const unsigned char* digest)
+{
+    char tag = 'D';
+    append(&tag, 1);
+    append((const char*)digest, SHA256_DIGEST_LENGTH);
+}
+
+void ByteVOSink::payload(const std::string& payload, VOEntry::DataType type)
+{
+    std::string header(1, type == VOEntry::PACKEDDATA ? 'P' : 'N');
+    appendVarint(payload.size(), header);
+    append(header.data(), header.size());
+    append(payload.data(), payload.size());
+}
+
+void ByteVOSink::flush()
+{
+    if(buffer.empty())
+    {
+        return ;
+    }
+    write(buffer.data(), buffer.size());
+    bytesWritten += buffer.size();
+    buffer.clear();
+}
+
+size_t ByteVOSink::getBytesWritten() const
+{
+    return bytesWritten;
+}
+
+FdVOSink::FdVOSink(int fd) : ByteVOSink([fd](const char* data, size_t length)
+{
+    while(length > 0)
+    {
+        ssize_t n = ::write(fd, data, length);
+        if(n < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "FdVOSink: write failed: " << std::strerror(errno) << std::endl;
+            throw std::runtime_error("FdVOSink: write failed");
+        }
+        data += n;
+        length -= n;
+    }
+}) {}
+
+VOStreamVerifier::VOStreamVerifier(std::function<void(const VertexID&, const VertexID&)> _onEdge) : onEdge(_onEdge), finished(false) {}
+
+void VOStreamVerifier::feed(const char* data, size_t length)
+{
+    pending.append(data, length);
+    size_t pos = 0;
+    while(pos < pending.size())
+    {
+        size_t used = consume((const unsigned char*)pending.data() + pos, pending.size() - pos);
+        if(used == 0)
+        {
+            break;
+        }
+        pos += used;
+    }
+    pending.erase(0, pos);
+}
+
+size_t VOStreamVerifier::consume(const unsigned char* data, size_t length)
+{
+    if(finished)
+    {
+        std::cerr << "VOStreamVerifier Error: data after the root node" << std::endl;
+        throw std::runtime_error("VOStreamVerifier Error: data after the root node");
+    }
+    unsigned char tag = data[0];
+    if(tag == '[')
+    {
+        levels.emplace_back();
+        SHA256_Init(&levels.back());
+        return 1;
+    }
+    if(levels.empty())
+    {
+        std::cerr << "VOStreamVerifier Error: VO does not start with '['" << std::endl;
+        throw std::runtime_error("VOStreamVerifier Error: VO does not start with '['");
+    }
+    if(tag == ']')
+    {
+        unsigned char nodeDigest[SHA256_DIGEST_LENGTH];
+        SHA256_Final(nodeDigest, &levels.back());
+        levels.pop_back();
+        if(levels.empty())
+        {
+            memcpy(rootDigest, nodeDigest, SHA256_DIGEST_LENGTH);
+            finished = true;
+        }
+        else
+        {
+            SHA256_Update(&levels.back(), nodeDigest, SHA256_DIGEST_LENGTH);
+        }
+        return 1;
+    }
+    if(tag == 'D')
+    {
+        if(length < 1 + SHA256_DIGEST_LENGTH)
+        {
+            return 0;
+        }
+        SHA256_Update(&levels.back(), data + 1, SHA256_DIGEST_LENGTH);
+        return 1 + SHA256_DIGEST_LENGTH;
+    }
+    if(tag == 'N' || tag == 'P')
+    {
+        // 长度的varint本身也可能还不完整
+        const unsigned char* cur = data + 1;
+        const unsigned char* end = data + length;
+        size_t varintLength = 0;
+        while(cur + varintLength < end && (cur[varintLength] & 0x80))
+        {
+            varintLength++;
+        }
+        if(cur + varintLength >= end)
+        {
+            return 0;
+        }
+        uint64_t payloadLength = readVarint(cur, end);
+        if((uint64_t)(end - cur) < payloadLength)
+        {
+            return 0;
+        }
+        addVertex(std::string((const char*)cur, payloadLength), tag == 'P' ? VOEntry::PACKEDDATA : VOEntry::NODEDATA);
+        return cur + payloadLength - data;
+    }
+    std::cerr << "VOStreamVerifier Error: unknown tag " << (int)tag << std::endl;
+    throw std::runtime_error("VOStreamVerifier Error: unknown tag");
+}
+
+void VOStreamVerifier::addVertex(const std::string& payload, VOEntry::DataType type)
+{
+    VertexID vid;
+    std::vector<VertexID> subgraphNeighbors;
+    std::string graphNodeDataStr;
+    if(type == VOEntry::PACKEDDATA)
+    {
+        std::vector<VertexID> neighbors;
+        decodeVertexPayload((const unsigned char*)payload.data(), payload.size(), vid, neighbors, subgraphNeighbors);
+        graphNodeDataStr = vertexDigestPreimage(vid, neighbors);
+    }
+    else
+    {
+        std::pair<std::string, std::string> infoPair = splitStringtoTwoParts(payload, "|");
+        std::vector<VertexID> subvertexInfo;
+        splitString(infoPair.first, "/", subvertexInfo);
+        vid = subvertexInfo[0];
+        subgraphNeighbors.assign(subvertexInfo.begin() + 1, subvertexInfo.end());
+        graphNodeDataStr = infoPair.second;
+    }
+    if(onEdge)
+    {
+        for(const VertexID& neighbor : subgraphNeighbors)
+        {
+            onEdge(vid, neighbor);
+        }
+    }
+    unsigned char vertexDigest[SHA256_DIGEST_LENGTH];
+    SHA256((const unsigned char*)graphNodeDataStr.c_str(), graphNodeDataStr.size(), vertexDigest);
+    SHA256_Update(&levels.back(), vertexDigest, SHA256_DIGEST_LENGTH);
+}
+
+bool VOStreamVerifier::isFinished() const
+{
+    return finished;
+}
+
+void VOStreamVerifier::getDigest(unsigned char* _digest) const
+{
+    if(!finished)
+    {
+        std::cerr << "VOStreamVerifier Error: VO is incomplete" << std::endl;
+        throw std::runtime_error("VOStreamVerifier Error: VO is incomplete");
+    }
+    memcpy(_digest, rootDigest, SHA256_DIGEST_LENGTH);
+}
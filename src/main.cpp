@@ -7,6 +7,7 @@
 
 const int addBatchNum = 10000;
 const int delBatchNum = 10000;
+const int updateBatchNum = 10000;
 const int queryNum = 10;
 
 int main(int argc, char* argv[])
@@ -21,75 +22,143 @@ int main(int argc, char* argv[])
     }
 
     Graph graph;
-    semiIndexExtractor extractor;
+    graph.setCompressedAdjacency(options.compressAdjacency);
+    graph.setVertexOrder(options.vertexOrder == "degree" ? Graph::DEGREE_ORDER : options.vertexOrder == "rcm" ? Graph::RCM_ORDER : Graph::ID_ORDER);
+    semiIndexExtractor extractor(options.threadNum);
     EdgeReader addEdgeReader(options.addFilename);
     EdgeReader delEdgeReader(options.deleteFilename);
 
-    // 图加载
-    graph.loadGraphfromFile(options.filename);
-    std::cout << "Graph Vertex Num : " << graph.getVertexNum() << std::endl;
+    std::unique_ptr<UpdateLog> updateLog;
+    if(!options.updateLogFilename.empty())
+    {
+        updateLog.reset(new UpdateLog(options.updateLogFilename));
+    }
 
-    // MbpTree构建
     auto start = std::chrono::high_resolution_clock::now();
-    extractor.buildMbpTree(graph, options.maxcapacity);
-    auto end = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    std::cout << "Tree building Time taken: " << duration.count() << " ms" << std::endl << std::endl;
+    auto end = start;
+    auto duration = std::chrono::milliseconds(0);
+    if(!options.restoreFilename.empty())
+    {
+        // 从检查点恢复图、cores、k-order、shell tree和MbpTree，不重新计算摘要也不重新分解
+        extractor.restoreCheckpoint(options.restoreFilename, graph);
+        end = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        std::cout << "Graph Vertex Num : " << graph.getVertexNum() << std::endl;
+        std::cout << "Checkpoint restoring Time taken: " << duration.count() << " ms, version " << extractor.getSnapshot()->getVersion() << std::endl << std::endl;
+        dataFile << "Checkpoint restoring Time taken: " << duration.count() << " ms" << std::endl << std::endl;
 
-    // core decomposition
-    start = std::chrono::high_resolution_clock::now();
-    extractor.coresDecomposition(graph);
-    // extractor.buildShellTree(graph);
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    std::cout << "Core Decomposition Time taken: " << duration.count() << " ms" << std::endl << std::endl;
+        // 检查点之后已经应用过的批次从日志中重放
+        if(updateLog != nullptr)
+        {
+            start = std::chrono::high_resolution_clock::now();
+            size_t replayed = extractor.replayUpdateLog(graph, *updateLog, nullptr);
+            end = std::chrono::high_resolution_clock::now();
+            duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            std::cout << "Update log replaying [" << replayed << "] batches Time taken: " << duration.count() << " ms, version " << extractor.getSnapshot()->getVersion() << std::endl << std::endl;
+            dataFile << "Update log replaying [" << replayed << "] batches Time taken: " << duration.count() << " ms" << std::endl << std::endl;
+        }
+    }
+    else
+    {
+        // 图加载
+        graph.loadGraphfromFile(options.filename);
+        std::cout << "Graph Vertex Num : " << graph.getVertexNum() << std::endl;
+        std::cout << "Adjacency memory : " << graph.getAdjacencyBytes() / 1024 << " KB" << (options.compressAdjacency ? " (compressed)" : "") << std::endl;
+
+        // MbpTree构建
+        start = std::chrono::high_resolution_clock::now();
+        extractor.buildMbpTree(graph, options.maxcapacity);
+        end = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        std::cout << "Tree building Time taken: " << duration.count() << " ms" << std::endl << std::endl;
+
+        // core decomposition
+        start = std::chrono::high_resolution_clock::now();
+        extractor.coresDecomposition(graph);
+        // extractor.buildShellTree(graph);
+        end = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        std::cout << "Core Decomposition Time taken: " << duration.count() << " ms" << std::endl << std::endl;
+
+        // shell tree只在初始时构建一次，之后随核心维护增量修复
+        start = std::chrono::high_resolution_clock::now();
+        extractor.buildShellTree(graph);
+        end = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        std::cout << "Shell Tree building Time taken: " << duration.count() << " ms" << std::endl << std::endl;
+        dataFile << "Shell Tree building Time taken: " << duration.count() << " ms" << std::endl << std::endl;
+
+        if(updateLog != nullptr)
+        {
+            updateLog->discardThrough(UINT_MAX); // 从源文件重新构建，日志中是之前运行的批次
+        }
+    }
+    extractor.attachUpdateLog(updateLog.get());
 
     size_t cnt = 0;
     auto maxAddDuration = std::chrono::milliseconds(0);
     auto minAddDuration = std::chrono::milliseconds(1000000000);
     auto totalAddDuration = std::chrono::milliseconds(0);
-    while(!addEdgeReader.isEndOfFile())
+    size_t addEdgeNum = 0;
+    // 流水线应用更新，两次发布之间的间隔即为这一批的耗时
+    start = std::chrono::high_resolution_clock::now();
+    extractor.applyUpdateStream(graph, addEdgeReader, addBatchNum, true, [&](const PublishedBatch& published)
     {
-        std::cout << ++cnt << "th round of updating edges : " << std::endl;
-        std::vector<std::pair<VertexID, VertexID>> addEdges = addEdgeReader.readNextEdges(addBatchNum);
-        start = std::chrono::high_resolution_clock::now();
-        for(auto edge : addEdges)
-        {
-            VertexID srcVid = edge.first;
-            VertexID dstVid = edge.second;
-            graph.addEdge(srcVid, dstVid, true, true);
-            extractor.mbpTreeAddUpdate(graph.getVertex(srcVid), graph.getVertex(dstVid));
-            extractor.insertCoreUpdate(graph, srcVid, dstVid);
-        }
-        // extractor.buildShellTree(graph); // 可以增删结束后统一计算
-        extractor.mbpTreeDigestCompute();
         end = std::chrono::high_resolution_clock::now();
         duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-        std::cout << "Add [" << addEdges.size() << "] Edges Time taken: " << duration.count() << " ms" << std::endl << std::endl;
+        start = end;
+        cnt = published.round;
+        addEdgeNum += published.updateNum;
+        std::cout << published.round << "th round of updating edges : " << std::endl;
+        std::cout << "Add [" << published.updateNum << "] Edges Time taken: " << duration.count() << " ms, published version " << published.version << std::endl << std::endl;
         maxAddDuration = std::max(maxAddDuration, duration);
         minAddDuration = std::min(minAddDuration, duration);
         totalAddDuration += duration;
-    }
+    });
     std::cout << "Add Edges Max Time taken: " << maxAddDuration.count() << " ms" << std::endl;
     std::cout << "Add Edges Min Time taken: " << minAddDuration.count() << " ms" << std::endl;
     std::cout << "Add Edges Total Time taken: " << totalAddDuration.count() << " ms" << std::endl;
-    std::cout << "Add Edges Avg Time taken: " << totalAddDuration.count() / cnt << " ms" << std::endl << std::endl;
+    std::cout << "Add Edges Avg Time taken: " << totalAddDuration.count() / std::max<size_t>(cnt, 1) << " ms" << std::endl;
+    std::cout << "Add Edges Throughput: " << addEdgeNum * 1000 / std::max<long long>(totalAddDuration.count(), 1) << " edges/s" << std::endl << std::endl;
 
     dataFile << "Add " << addBatchNum << "*" << cnt << " Edges Data: " << std::endl;
     dataFile << "   Max Time taken: " << maxAddDuration.count() << " ms" << std::endl;
     dataFile << "   Min Time taken: " << minAddDuration.count() << " ms" << std::endl;
     dataFile << "   Total Time taken: " << totalAddDuration.count() << " ms" << std::endl;
-    dataFile << "   Avg Time taken: " << totalAddDuration.count() / cnt << " ms" << std::endl << std::endl;
-
-    // 开始query
-    extractor.coresDecomposition(graph);
-    start = std::chrono::high_resolution_clock::now();
-    extractor.buildShellTree(graph);
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    std::cout << "Shell Tree building Time taken: " << duration.count() << " ms" << std::endl << std::endl;
-    dataFile << "Shell Tree building Time taken: " << duration.count() << " ms" << std::endl << std::endl;
+    dataFile << "   Avg Time taken: " << totalAddDuration.count() / std::max<size_t>(cnt, 1) << " ms" << std::endl;
+    dataFile << "   Throughput: " << addEdgeNum * 1000 / std::max<long long>(totalAddDuration.count(), 1) << " edges/s" << std::endl << std::endl;
+
+    // 检查点在后台线程写出，与下面的查询同时进行
+    std::thread checkpointWriter;
+    uint checkpointVersion = 0;
+    bool checkpointWritten = false;
+    if(!options.checkpointFilename.empty())
+    {
+        start = std::chrono::high_resolution_clock::now();
+        std::shared_ptr<const IndexCheckpoint> checkpoint = extractor.captureCheckpoint(graph);
+        end = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        std::cout << "Checkpoint capturing Time taken: " << duration.count() << " ms, version " << checkpoint->getVersion() << std::endl;
+        std::cout << "Adjacency memory after compaction: " << graph.getReservedBytes() / (1 << 20) << " MB" << std::endl << std::endl;
+        checkpointVersion = checkpoint->getVersion();
+        checkpointWriter = std::thread([checkpoint, &options, &checkpointWritten]()
+        {
+            try
+            {
+                auto writeStart = std::chrono::high_resolution_clock::now();
+                checkpoint->write(options.checkpointFilename);
+                auto writeDuration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - writeStart);
+                std::cout << "Checkpoint " << options.checkpointFilename << " written in background: " << writeDuration.count() << " ms" << std::endl;
+                checkpointWritten = true;
+            }
+            catch(const std::exception& e)
+            {
+                std::cerr << "Checkpoint writer: " << e.what() << std::endl;
+            }
+        });
+    }
 
+    // 开始query，shell tree在边更新过程中已经同步维护
     for(const std::pair<uint, std::vector<VertexID>>& p : options.queryMap)
     {
         uint queryK = p.first;
@@ -121,8 +190,8 @@ int main(int argc, char* argv[])
             }
             std::cout << "Query K = " << queryK << ", number = " << ++num << std::endl;
             // k-core子图提取
-            Graph kcoreGraph = extractor.kcoreExtract(graph, q, queryK);
             duration = extractor.kcoreExtractByShell(graph, q, queryK);
+            const QueryContext& kcoreResult = extractor.getQueryContext();
             std::cout << "Computation Time taken: " << duration.count() << " ms" << std::endl << std::endl;
             kcoreExtractMaxTime = std::max(kcoreExtractMaxTime, duration);
             kcoreExtractMinTime = std::min(kcoreExtractMinTime, duration);
@@ -150,12 +219,20 @@ int main(int argc, char* argv[])
             resultMinVOSize = std::min(resultMinVOSize, (double)voSize);
             resultAvgVOSize += (double)voSize / (double)queryNum;
 
-            resultMaxVNum = std::max(resultMaxVNum, kcoreGraph.getVertexNum());
-            resultMinVNum = std::min(resultMinVNum, kcoreGraph.getVertexNum());
-            resultAvgVNum += kcoreGraph.getVertexNum() / (double)queryNum;
-            std::cout << "Result Graph Vertex Num : " << kcoreGraph.getVertexNum() << std::endl;
+            resultMaxVNum = std::max(resultMaxVNum, kcoreResult.getVertexNum());
+            resultMinVNum = std::min(resultMinVNum, kcoreResult.getVertexNum());
+            resultAvgVNum += kcoreResult.getVertexNum() / (double)queryNum;
+            std::cout << "Result Graph Vertex Num : " << kcoreResult.getVertexNum() << std::endl;
             std::cout << std::endl;
         }
+
+        // 同一组查询在线程池上并发执行，各线程使用自己的QueryContext
+        std::vector<VertexID> batchQuerys(querys.begin(), querys.begin() + std::min<size_t>(querys.size(), queryNum));
+        start = std::chrono::high_resolution_clock::now();
+        extractor.kcoreQueryBatch(extractor.getSnapshot(), batchQuerys, queryK, [](size_t, const QueryContext&){});
+        end = std::chrono::high_resolution_clock::now();
+        auto batchDuration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
         std::cout << "Query k = " << queryK << " : " << std::endl;
         std::cout << "  Kcore Extract Max Time taken: " << kcoreExtractMaxTime.count() << " ms" << std::endl;
         std::cout << "  Kcore Extract Min Time taken: " << kcoreExtractMinTime.count() << " ms" << std::endl;
@@ -169,6 +246,7 @@ int main(int argc, char* argv[])
         std::cout << "  Result Graph Max Vertex Num : " << resultMaxVNum << std::endl;
         std::cout << "  Result Graph Min Vertex Num : " << resultMinVNum << std::endl;
         std::cout << "  Result Graph Avg Vertex Num : " << resultAvgVNum << std::endl;
+        std::cout << "  Concurrent Query [" << batchQuerys.size() << "] Time taken: " << batchDuration.count() << " ms" << std::endl;
         std::cout << std::endl;
 
         dataFile << "Query " << queryK << " Data: " << std::endl;
@@ -184,62 +262,135 @@ int main(int argc, char* argv[])
         dataFile << "  Result Graph Max Vertex Num : " << resultMaxVNum << std::endl;
         dataFile << "  Result Graph Min Vertex Num : " << resultMinVNum << std::endl;
         dataFile << "  Result Graph Avg Vertex Num : " << resultAvgVNum << std::endl;
+        dataFile << "  Concurrent Query [" << batchQuerys.size() << "] Time taken: " << batchDuration.count() << " ms" << std::endl;
         dataFile << std::endl;
     }
 
+    // 全部k的查询一起提交，落在同一连通分量的查询只提取一次并共用VO
+    std::vector<std::pair<VertexID, uint>> groupQuerys;
+    for(const std::pair<const uint, std::vector<VertexID>>& p : options.queryMap)
+    {
+        for(const VertexID& queryV : p.second)
+        {
+            groupQuerys.emplace_back(queryV, p.first);
+        }
+    }
+    if(!groupQuerys.empty())
+    {
+        start = std::chrono::high_resolution_clock::now();
+        extractor.kcoreQueryGroups(extractor.getSnapshot(), groupQuerys, [](size_t, const QueryContext&){});
+        end = std::chrono::high_resolution_clock::now();
+        auto groupDuration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        std::cout << "Grouped Query [" << groupQuerys.size() << "] Time taken: " << groupDuration.count() << " ms" << std::endl << std::endl;
+        dataFile << "Grouped Query [" << groupQuerys.size() << "] Time taken: " << groupDuration.count() << " ms" << std::endl << std::endl;
+
+        // 同一批查询的合并证明：一份VO覆盖所有结果子图的并集
+        QueryContext multiCtx;
+        MultiProof proof;
+        start = std::chrono::high_resolution_clock::now();
+        extractor.kcoreMultiProof(*extractor.getSnapshot(), groupQuerys, proof, multiCtx);
+        end = std::chrono::high_resolution_clock::now();
+        auto multiDuration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        Graph unionGraph;
+        unsigned char multiDigest[SHA256_DIGEST_LENGTH];
+        std::queue<VOEntry> multiVO = convertVectorToQueue(multiCtx.vo);
+        extractor.vertify(unionGraph, multiVO, multiDigest);
+        size_t multiVOSize = semiIndexExtractor::calculateVOSize(multiCtx.vo);
+        std::cout << "Multi Proof [" << groupQuerys.size() << "] Communities: " << proof.communities.size() << " Union Vertex Num: " << multiCtx.getVertexNum() << std::endl;
+        std::cout << "  Time taken: " << multiDuration.count() << " ms VO Size: " << multiVOSize / (1024.0 * 1024.0) << " MB" << std::endl << std::endl;
+        dataFile << "Multi Proof [" << groupQuerys.size() << "] Communities: " << proof.communities.size() << " Union Vertex Num: " << multiCtx.getVertexNum() << std::endl;
+        dataFile << "  Time taken: " << multiDuration.count() << " ms VO Size: " << multiVOSize << "B | " << multiVOSize / (1024.0 * 1024.0) << " MB" << std::endl << std::endl;
+
+        // 流式VO：字节边生成边交给验证方，双方都不保存完整的VO
+        QueryContext streamCtx;
+        size_t streamEdgeNum = 0;
+        VOStreamVerifier streamVerifier([&streamEdgeNum](const VertexID&, const VertexID&){ streamEdgeNum++; });
+        ByteVOSink streamSink([&streamVerifier](const char* data, size_t length){ streamVerifier.feed(data, length); });
+        start = std::chrono::high_resolution_clock::now();
+        extractor.kcoreQueryStream(*extractor.getSnapshot(), groupQuerys.front().first, groupQuerys.front().second, streamCtx, streamSink);
+        streamSink.flush();
+        end = std::chrono::high_resolution_clock::now();
+        auto streamDuration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        unsigned char streamDigest[SHA256_DIGEST_LENGTH];
+        unsigned char streamRootDigest[SHA256_DIGEST_LENGTH];
+        streamVerifier.getDigest(streamDigest);
+        extractor.getRootDigest(streamRootDigest);
+        bool streamVerified = memcmp(streamDigest, streamRootDigest, SHA256_DIGEST_LENGTH) == 0;
+        std::cout << "Streamed VO : " << streamSink.getBytesWritten() << " B, " << streamEdgeNum / 2 << " edges, " << (streamVerified ? "verified" : "NOT verified") << ", " << streamDuration.count() << " ms" << std::endl << std::endl;
+        dataFile << "Streamed VO : " << streamSink.getBytesWritten() << " B, " << streamEdgeNum / 2 << " edges, " << (streamVerified ? "verified" : "NOT verified") << ", " << streamDuration.count() << " ms" << std::endl << std::endl;
+    }
+
+
+    if(checkpointWriter.joinable())
+    {
+        checkpointWriter.join();
+    }
+    if(checkpointWritten && updateLog != nullptr)
+    {
+        updateLog->discardThrough(checkpointVersion); // 检查点已经包含的批次不再需要重放
+    }
 
     cnt = 0;
     auto maxDelDuration = std::chrono::milliseconds(0);
     auto minDelDuration = std::chrono::milliseconds(1000000000);
     auto totalDelDuration = std::chrono::milliseconds(0);
-    while(!addEdgeReader.isEndOfFile() || !delEdgeReader.isEndOfFile())
+    size_t delEdgeNum = 0;
+    start = std::chrono::high_resolution_clock::now();
+    extractor.applyUpdateStream(graph, delEdgeReader, delBatchNum, false, [&](const PublishedBatch& published)
     {
-        std::cout << ++cnt << "th round of delete edges : " << std::endl;
-        std::vector<std::pair<VertexID, VertexID>> delEdges = delEdgeReader.readNextEdges(delBatchNum);
-        start = std::chrono::high_resolution_clock::now();
-        for(auto edge : delEdges)
-        {
-            VertexID srcVid = edge.first;
-            VertexID dstVid = edge.second;
-            graph.removeEdge(srcVid, dstVid, true, true);
-            bool srcExists = graph.hasVertex(srcVid);
-            bool dstExists = graph.hasVertex(dstVid);
-            if(!srcExists)
-            {
-                extractor.mbpTreeDeleteVertexUpdate(srcVid);
-            }
-            else
-            {
-                extractor.mbpTreeDeleteEdgeUpdate(graph.getVertex(srcVid));
-            }
-            if(!dstExists)
-            {
-                extractor.mbpTreeDeleteVertexUpdate(dstVid);
-            }
-            else
-            {
-                extractor.mbpTreeDeleteEdgeUpdate(graph.getVertex(dstVid));
-            }
-            extractor.removeCoreUpdate(graph, srcVid, dstVid);
-        }
-        extractor.mbpTreeDigestCompute();
         end = std::chrono::high_resolution_clock::now();
         duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-        std::cout << "Delete [" << delEdges.size() << "] Edges Time taken: " << duration.count() << " ms" << std::endl << std::endl;
+        start = end;
+        cnt = published.round;
+        delEdgeNum += published.updateNum;
+        std::cout << published.round << "th round of delete edges : " << std::endl;
+        std::cout << "Delete [" << published.updateNum << "] Edges Time taken: " << duration.count() << " ms, published version " << published.version << std::endl << std::endl;
         maxDelDuration = std::max(maxDelDuration, duration);
         minDelDuration = std::min(minDelDuration, duration);
         totalDelDuration += duration;
-    }
+    });
     std::cout << "Delete Edges Max Time taken: " << maxDelDuration.count() << " ms" << std::endl;
     std::cout << "Delete Edges Min Time taken: " << minDelDuration.count() << " ms" << std::endl;
     std::cout << "Delete Edges Total Time taken: " << totalDelDuration.count() << " ms" << std::endl;
-    std::cout << "Delete Edges Avg Time taken: " << totalDelDuration.count() / cnt << " ms" << std::endl << std::endl;
+    std::cout << "Delete Edges Avg Time taken: " << totalDelDuration.count() / std::max<size_t>(cnt, 1) << " ms" << std::endl;
+    std::cout << "Delete Edges Throughput: " << delEdgeNum * 1000 / std::max<long long>(totalDelDuration.count(), 1) << " edges/s" << std::endl << std::endl;
 
     dataFile << "Delete " << delBatchNum << "*" << cnt << " Edges Data: " << std::endl;
     dataFile << "   Max Time taken: " << maxDelDuration.count() << " ms" << std::endl;
     dataFile << "   Min Time taken: " << minDelDuration.count() << " ms" << std::endl;
     dataFile << "   Total Time taken: " << totalDelDuration.count() << " ms" << std::endl;
-    dataFile << "   Avg Time taken: " << totalDelDuration.count() / cnt << " ms" << std::endl << std::endl;
+    dataFile << "   Avg Time taken: " << totalDelDuration.count() / std::max<size_t>(cnt, 1) << " ms" << std::endl;
+    dataFile << "   Throughput: " << delEdgeNum * 1000 / std::max<long long>(totalDelDuration.count(), 1) << " edges/s" << std::endl << std::endl;
+
+    // 插入和删除交错的更新日志，每批合并后再应用
+    if(!options.updateFilename.empty())
+    {
+        EdgeReader updateReader(options.updateFilename);
+        cnt = 0;
+        size_t updateNum = 0, appliedNum = 0;
+        auto totalUpdateDuration = std::chrono::milliseconds(0);
+        start = std::chrono::high_resolution_clock::now();
+        extractor.applyMixedUpdateStream(graph, updateReader, updateBatchNum, [&](const PublishedBatch& published)
+        {
+            end = std::chrono::high_resolution_clock::now();
+            duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            start = end;
+            cnt = published.round;
+            updateNum += published.updateNum;
+            appliedNum += published.insertNum + published.removeNum;
+            std::cout << published.round << "th round of mixed updates : " << std::endl;
+            std::cout << "Update [" << published.updateNum << "] -> " << published.insertNum << " inserts, " << published.removeNum << " removes, Time taken: " << duration.count() << " ms, published version " << published.version << std::endl << std::endl;
+            totalUpdateDuration += duration;
+        });
+        std::cout << "Mixed Updates Total Time taken: " << totalUpdateDuration.count() << " ms" << std::endl;
+        std::cout << "Mixed Updates Applied after coalescing: " << appliedNum << " / " << updateNum << std::endl;
+        std::cout << "Mixed Updates Throughput: " << updateNum * 1000 / std::max<long long>(totalUpdateDuration.count(), 1) << " updates/s" << std::endl << std::endl;
+
+        dataFile << "Mixed Update " << updateBatchNum << "*" << cnt << " Data: " << std::endl;
+        dataFile << "   Total Time taken: " << totalUpdateDuration.count() << " ms" << std::endl;
+        dataFile << "   Applied after coalescing: " << appliedNum << " / " << updateNum << std::endl;
+        dataFile << "   Throughput: " << updateNum * 1000 / std::max<long long>(totalUpdateDuration.count(), 1) << " updates/s" << std::endl << std::endl;
+    }
 
     dataFile.close();
     return 0;